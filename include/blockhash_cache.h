@@ -0,0 +1,42 @@
+/*****************************************************************************************
+ * Blockhash Cache
+ *
+ * Keeps a recent blockhash ready for the transaction builders so a submit does not have
+ * to wait for getLatestBlockhash(). The cache is refreshed from the network task while it
+ * is idle and tracks the age of the hash against the ~60-90s validity window. The hash is
+ * kept decoded, ready to be patched into a transaction template.
+ *
+ *****************************************************************************************/
+
+#ifndef BLOCKHASH_CACHE_H
+#define BLOCKHASH_CACHE_H
+
+#include <Arduino.h>
+
+/*****************************************************************************************
+* Configuration
+*****************************************************************************************/
+#ifndef BLOCKHASH_REFRESH_MS
+#define BLOCKHASH_REFRESH_MS 20000      // Refresh the cached hash this long after fetching it
+#endif
+#ifndef BLOCKHASH_MAX_AGE_MS
+#define BLOCKHASH_MAX_AGE_MS 45000      // Never hand out a hash older than this (valid ~60s)
+#endif
+#ifndef BLOCKHASH_RETRY_MS
+#define BLOCKHASH_RETRY_MS 5000         // Wait this long before retrying a failed refresh
+#endif
+
+/*****************************************************************************************
+* Function Declarations
+*****************************************************************************************/
+void blockhashCacheBegin();
+bool blockhashCacheGet(uint8_t* blockhash);
+bool blockhashCacheRefresh();
+void blockhashCacheService();
+void blockhashCacheInvalidate();
+unsigned long blockhashCacheMsUntilRefresh();
+unsigned long blockhashCacheAgeMs();
+uint32_t blockhashCacheHits();
+uint32_t blockhashCacheMisses();
+
+#endif
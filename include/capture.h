@@ -0,0 +1,50 @@
+/*****************************************************************************************
+ * Capture
+ *
+ * Raw signal capture for offline analysis. While active, every block the loop reads from
+ * the sampler is streamed with its band-passed counterpart, either over USB-CDC (through
+ * the logger's binary records) or as UDP datagrams. The loop only copies the block into
+ * a hand-off buffer; all I/O happens in other tasks, so sampling timing is unchanged.
+ *
+ * Frames are laid out as in capture_format.h. Gaps in sequence mean frames were dropped
+ * because the transport fell behind.
+ *
+ *****************************************************************************************/
+
+#ifndef CAPTURE_H
+#define CAPTURE_H
+
+#include <Arduino.h>
+#include "capture_format.h"
+
+/*****************************************************************************************
+* Configuration
+*****************************************************************************************/
+#define CAPTURE_USB 0                   // Logger binary records (tag CAPTURE_TAG)
+#define CAPTURE_UDP 1                   // Datagrams to CAPTURE_UDP_HOST:CAPTURE_UDP_PORT
+
+#ifndef CAPTURE_TRANSPORT
+#define CAPTURE_TRANSPORT CAPTURE_USB
+#endif
+#ifndef CAPTURE_UDP_HOST
+#define CAPTURE_UDP_HOST "192.168.1.100"
+#endif
+#ifndef CAPTURE_UDP_PORT
+#define CAPTURE_UDP_PORT 5005
+#endif
+#define CAPTURE_QUEUE_LENGTH 8          // UDP frames waiting for the capture task
+
+#define CAPTURE_TASK_CORE 0
+#define CAPTURE_TASK_PRIORITY 1
+#define CAPTURE_TASK_STACK_SIZE 3072
+
+/*****************************************************************************************
+* Function Declarations
+*****************************************************************************************/
+bool captureStart();
+void captureStop();
+bool captureActive();
+void captureBlock(const uint16_t* raw, const int32_t* filtered, size_t count, uint32_t firstIndex);
+uint32_t captureDropped();
+
+#endif
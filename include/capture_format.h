@@ -0,0 +1,34 @@
+/*****************************************************************************************
+ * Capture Format
+ *
+ * Wire format of raw signal capture frames, shared by the firmware and the host-side trace
+ * replay. Kept free of Arduino headers so recorded captures can be decoded on the host.
+ *
+ * Frame: CaptureHeader, uint16_t raw[count], int32_t filtered[count] (little endian).
+ * Over USB every frame is a logger binary record: CAPTURE_RECORD_SYNC, CAPTURE_TAG,
+ * u16 frame length, frame. Over UDP every datagram is one frame.
+ *
+ *****************************************************************************************/
+
+#ifndef CAPTURE_FORMAT_H
+#define CAPTURE_FORMAT_H
+
+#include <stdint.h>
+
+/*****************************************************************************************
+* Configuration
+*****************************************************************************************/
+#define CAPTURE_MAX_SAMPLES 64          // Samples per frame (at most one loop read block)
+#define CAPTURE_TAG 0x02                // logBinary() tag of capture frames
+#define CAPTURE_RECORD_SYNC 0xA5        // LOG_BINARY_SYNC, first byte of a logger binary record
+#define CAPTURE_VERSION 1
+
+struct __attribute__((packed)) CaptureHeader {
+  uint8_t version;
+  uint8_t flags;                        // Reserved
+  uint16_t count;                       // Samples in this frame
+  uint32_t sequence;                    // Frame counter since capture start
+  uint32_t firstIndex;                  // Sampler index of the first sample
+};
+
+#endif
@@ -0,0 +1,36 @@
+/*****************************************************************************************
+ * Display Renderer
+ *
+ * Asynchronous, dirty-region SSD1306 transfer. The loop draws into the Adafruit_SSD1306
+ * buffer as before and hands the finished frame over with rendererCommit(); a display
+ * task compares it with what the panel shows and sends only the changed column range of
+ * each page over I2C.
+ *
+ *****************************************************************************************/
+
+#ifndef DISPLAY_RENDERER_H
+#define DISPLAY_RENDERER_H
+
+#include <Arduino.h>
+#include <Adafruit_SSD1306.h>
+
+/*****************************************************************************************
+* Configuration
+*****************************************************************************************/
+#ifndef DISPLAY_I2C_CLOCK_HZ
+#define DISPLAY_I2C_CLOCK_HZ 400000     // SSD1306 fast mode (many panels also run at 1MHz)
+#endif
+#define DISPLAY_I2C_CHUNK 64            // Data bytes per I2C transaction (Wire buffer is 128)
+
+#define DISPLAY_TASK_CORE 0             // Keep I2C off the sampling core
+#define DISPLAY_TASK_PRIORITY 2         // Above the network task so TLS work does not stall it
+#define DISPLAY_TASK_STACK_SIZE 3072
+
+/*****************************************************************************************
+* Function Declarations
+*****************************************************************************************/
+bool rendererBegin(Adafruit_SSD1306* display, uint8_t address);
+void rendererCommit();
+uint32_t rendererBytesSent();
+
+#endif
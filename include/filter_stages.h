@@ -0,0 +1,201 @@
+/*****************************************************************************************
+ * Filter Stages
+ *
+ * Header-only building blocks for the peak detection pipeline. Window lengths, thresholds,
+ * weights and limits are template parameters, so every deployment picks its pipeline at
+ * compile time: loops over N are unrolled, divisions by constants become multiplies and
+ * there are no virtual calls or runtime configuration.
+ *
+ *   MovingAverage<N>             - running mean over the last N values (circular history)
+ *   RiseDetector<K>              - fires once when a signal has risen more than K steps
+ *   EnvelopeTracker<S>           - running min/max that decay towards the signal (2^-S per step)
+ *   AdaptiveThreshold<S, T, R>   - fires when a signal crosses T% of its envelope, re-arms below R%
+ *   IntervalAverager<N, W...>    - weighted mean of the last N intervals, newest first
+ *   RangeGate<Min, Max>          - accepts values strictly between Min and Max
+ *
+ *****************************************************************************************/
+
+#ifndef FILTER_STAGES_H
+#define FILTER_STAGES_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*****************************************************************************************
+* Class: Moving Average
+*
+* Description: Mean of the last N values. Keeps a running sum, so an update costs one add
+*              and one subtract regardless of N
+*****************************************************************************************/
+template <size_t N>
+class MovingAverage {
+  static_assert(N > 0, "MovingAverage needs at least one value");
+
+public:
+  int32_t update(int32_t value) {
+    sum += value - history[index];
+    history[index] = value;
+    index = (index + 1 == N) ? 0 : index + 1;
+    return sum / (int32_t)N;
+  }
+
+private:
+  int32_t history[N] = {};
+  int32_t sum = 0;
+  size_t index = 0;
+};
+
+/*****************************************************************************************
+* Class: Rise Detector
+*
+* Description: Counts consecutive increasing values and reports a peak once the count
+*              exceeds K. A non-increasing value re-arms the detector
+*****************************************************************************************/
+template <uint32_t K>
+class RiseDetector {
+public:
+  bool update(int32_t value) {
+    bool peak = false;
+    if (value > previous) {
+      riseCount++;
+      if (!rising && riseCount > K) {
+        rising = true;
+        peak = true;
+      }
+    } else {
+      rising = false;
+      riseCount = 0;
+    }
+    previous = value;
+    return peak;
+  }
+
+private:
+  int32_t previous = 0;
+  uint32_t riseCount = 0;
+  bool rising = false;
+};
+
+/*****************************************************************************************
+* Class: Envelope Tracker
+*
+* Description: Running minimum and maximum of a signal. A new extreme is taken at once,
+*              otherwise both decay towards the signal by 2^-S per value, so the envelope
+*              follows an amplitude that shrinks within about 2^S values. level() places a
+*              threshold at a fixed fraction of the current range
+*****************************************************************************************/
+template <uint32_t S>
+class EnvelopeTracker {
+  static_assert(S > 0 && S < 31, "EnvelopeTracker decay shift out of range");
+
+public:
+  void update(int32_t value) {
+    if (!started) {
+      maximum = minimum = value;
+      started = true;
+      return;
+    }
+    maximum = value > maximum ? value : maximum - ((maximum - value) >> S);
+    minimum = value < minimum ? value : minimum + ((value - minimum) >> S);
+  }
+
+  int32_t range() const {
+    return maximum - minimum;
+  }
+
+  int32_t level(uint32_t percent) const {
+    return minimum + (int32_t)(((int64_t)range() * percent) / 100);
+  }
+
+private:
+  int32_t maximum = 0;
+  int32_t minimum = 0;
+  bool started = false;
+};
+
+/*****************************************************************************************
+* Class: Adaptive Threshold
+*
+* Description: Fires once when the signal rises through T percent of its envelope and
+*              re-arms when it falls below R percent (R < T). The gap between the two is
+*              the hysteresis that keeps noise around the threshold from firing twice
+*****************************************************************************************/
+template <uint32_t S, uint32_t T, uint32_t R>
+class AdaptiveThreshold {
+  static_assert(R < T && T <= 100, "AdaptiveThreshold needs release < trigger <= 100");
+
+public:
+  bool update(int32_t value) {
+    envelope.update(value);
+    if (armed && value >= envelope.level(T)) {
+      armed = false;
+      return true;
+    }
+    if (!armed && value < envelope.level(R)) {
+      armed = true;
+    }
+    return false;
+  }
+
+  int32_t range() const {
+    return envelope.range();
+  }
+
+private:
+  EnvelopeTracker<S> envelope;
+  bool armed = false;
+};
+
+/*****************************************************************************************
+* Class: Interval Averager
+*
+* Description: Weighted mean of the last N intervals. Weights are integers applied newest
+*              first and normalised by their sum, e.g. <3, 4, 3, 3> for 0.4/0.3/0.3
+*****************************************************************************************/
+template <size_t N, uint32_t... Weights>
+class IntervalAverager {
+  static_assert(N > 0 && sizeof...(Weights) == N, "IntervalAverager needs one weight per interval");
+
+  static constexpr uint32_t weights[N] = {Weights...};
+  static constexpr uint32_t weightSum = (Weights + ...);
+  static_assert(weightSum > 0, "IntervalAverager weights must not all be zero");
+
+public:
+  explicit IntervalAverager(uint32_t initialInterval) {
+    for (size_t i = 0; i < N; i++) {
+      intervals[i] = initialInterval;
+    }
+  }
+
+  uint32_t update(uint32_t interval) {
+    for (size_t i = N - 1; i > 0; i--) {
+      intervals[i] = intervals[i - 1];
+    }
+    intervals[0] = interval;
+
+    uint32_t weighted = 0;
+    for (size_t i = 0; i < N; i++) {
+      weighted += weights[i] * intervals[i];
+    }
+    return weighted / weightSum;
+  }
+
+private:
+  uint32_t intervals[N];
+};
+
+/*****************************************************************************************
+* Class: Range Gate
+*
+* Description: Accepts values strictly between Min and Max
+*****************************************************************************************/
+template <uint32_t Min, uint32_t Max>
+struct RangeGate {
+  static_assert(Min < Max, "RangeGate needs Min < Max");
+
+  static constexpr bool accepts(uint32_t value) {
+    return value > Min && value < Max;
+  }
+};
+
+#endif
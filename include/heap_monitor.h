@@ -0,0 +1,25 @@
+/*****************************************************************************************
+ * Heap Monitor
+ *
+ * Snapshots of the default heap taken around a unit of periodic work (one network cycle),
+ * used to confirm that the steady-state hot path does not allocate.
+ *
+ *****************************************************************************************/
+
+#ifndef HEAP_MONITOR_H
+#define HEAP_MONITOR_H
+
+#include <Arduino.h>
+
+struct HeapSnapshot {
+  size_t freeBytes;
+  size_t allocatedBlocks;
+};
+
+/*****************************************************************************************
+* Function Declarations
+*****************************************************************************************/
+HeapSnapshot heapSnapshot();
+void printHeapReport(const char* label, const HeapSnapshot& before);
+
+#endif
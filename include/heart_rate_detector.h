@@ -0,0 +1,72 @@
+/*****************************************************************************************
+ * Heart Rate Detector
+ *
+ * Peak detection and BPM calculation on the band-passed signal, decimated to one value
+ * per HEART_RATE_WINDOW_MS, with a threshold that adapts to the pulse amplitude. Every
+ * sampler channel is detected independently. Works on sample indices rather than millis(),
+ * so it has no Arduino dependency and can be fed recorded traces on the host.
+ *
+ *****************************************************************************************/
+
+#ifndef HEART_RATE_DETECTOR_H
+#define HEART_RATE_DETECTOR_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "sampler_config.h"
+#include "signal_filter.h"
+
+/*****************************************************************************************
+* Configuration
+*****************************************************************************************/
+#ifndef HEART_RATE_CHANNEL
+#define HEART_RATE_CHANNEL 0            // Sampler channel feeding the quality index and the uploads
+#endif
+#ifndef HEART_RATE_SAMPLE_SIZE
+#define HEART_RATE_SAMPLE_SIZE 4        // Small rolling average for peak detection
+#endif
+#ifndef HEART_RATE_ENVELOPE_SHIFT
+#define HEART_RATE_ENVELOPE_SHIFT 5     // Envelope decays 2^-5 per window (~0.6s), follows baseline wander
+#endif
+#ifndef HEART_RATE_TRIGGER_PERCENT
+#define HEART_RATE_TRIGGER_PERCENT 60   // Upstroke through this share of the envelope is a beat
+#endif
+#ifndef HEART_RATE_RELEASE_PERCENT
+#define HEART_RATE_RELEASE_PERCENT 30   // Threshold re-arms once the signal falls below this share
+#endif
+#ifndef HEART_RATE_MIN_AMPLITUDE
+#define HEART_RATE_MIN_AMPLITUDE (2 << FILTER_Q_BITS)  // Smaller envelope (2 ADC counts): no pulse
+#endif
+#ifndef HEART_RATE_BEAT_COUNT
+#define HEART_RATE_BEAT_COUNT 3         // Beat intervals in the weighted average
+#define HEART_RATE_BEAT_WEIGHTS 4, 3, 3 // Newest first (0.4, 0.3, 0.3)
+#endif
+#ifndef HEART_RATE_MIN_BEAT_MS
+#define HEART_RATE_MIN_BEAT_MS 300      // 200 BPM
+#endif
+#ifndef HEART_RATE_MAX_BEAT_MS
+#define HEART_RATE_MAX_BEAT_MS 2000     // 30 BPM
+#endif
+#ifndef HEART_RATE_EARLY_PERCENT
+#define HEART_RATE_EARLY_PERCENT 60     // Interval below this share of the average: doubled beat
+#endif
+#ifndef HEART_RATE_LATE_PERCENT
+#define HEART_RATE_LATE_PERCENT 170     // Interval above this share of the average: missed beat
+#endif
+#ifndef HEART_RATE_OUTLIER_LIMIT
+#define HEART_RATE_OUTLIER_LIMIT 3      // Outliers in a row after which the new rhythm is accepted
+#endif
+#define HEART_RATE_WINDOW_MS 20         // Peak detection step (filtered signal decimated to 50Hz)
+#define HEART_RATE_WINDOW_SAMPLES (SAMPLE_RATE_HZ * HEART_RATE_WINDOW_MS / 1000)
+
+/*****************************************************************************************
+* Function Declarations
+*****************************************************************************************/
+void detectorReset();
+void detectorGap();
+bool detectorUpdate(uint32_t channel, int32_t filtered, uint32_t sampleIndex);
+float detectorHeartRate(uint32_t channel);
+uint32_t detectorBeatCount(uint32_t channel);
+uint32_t detectorLastInterval(uint32_t channel);
+
+#endif
@@ -0,0 +1,33 @@
+/*****************************************************************************************
+ * Heart Rate Reading
+ *
+ * A heart rate reading queued for upload, shared by the loop, the network task and the
+ * offline store: the window mean plus a fixed-size summary of the beats since the previous
+ * reading (see heart_rate_window.h).
+ *
+ *****************************************************************************************/
+
+#ifndef HEART_RATE_READING_H
+#define HEART_RATE_READING_H
+
+#include <stdint.h>
+
+#define READING_TIMESTAMP_UNKNOWN 0     // Reading was taken during a previous boot
+
+struct HeartRateSummary {
+  uint16_t beatCount;                   // Accepted beats in the window
+  uint16_t stdDevCentiBpm;              // Standard deviation of the beat rate (0.01 BPM)
+  uint16_t rmssdMs;                     // RMSSD of successive beat intervals (HRV)
+  uint16_t highSeconds;                 // Time spent above WINDOW_HIGH_HEART_RATE
+  uint8_t minBpm;
+  uint8_t maxBpm;
+  uint8_t quality;                      // Signal quality index 0-100
+};
+
+struct HeartRateReading {
+  float heartRate;                      // Mean BPM of the window
+  unsigned long timestampMs;            // millis() when taken, or READING_TIMESTAMP_UNKNOWN
+  HeartRateSummary summary;
+};
+
+#endif
@@ -0,0 +1,36 @@
+/*****************************************************************************************
+ * Heart Rate Window
+ *
+ * Incremental aggregate of the accepted beats between two uploads, so a reading carries
+ * the whole window instead of the instantaneous value at send time. Each beat updates it
+ * in O(1) with no history: min/max, mean and variance of the beat rate (Welford), RMSSD
+ * of successive intervals and the time spent above WINDOW_HIGH_HEART_RATE, the rate the
+ * on-chain points logic counts.
+ *
+ * No Arduino dependency, so recorded traces can be aggregated on the host.
+ *
+ *****************************************************************************************/
+
+#ifndef HEART_RATE_WINDOW_H
+#define HEART_RATE_WINDOW_H
+
+#include <stdint.h>
+#include "heart_rate_reading.h"
+
+/*****************************************************************************************
+* Configuration
+*****************************************************************************************/
+#ifndef WINDOW_HIGH_HEART_RATE
+#define WINDOW_HIGH_HEART_RATE 100      // BPM above which beats count as high (points threshold)
+#endif
+
+/*****************************************************************************************
+* Function Declarations
+*****************************************************************************************/
+void windowReset();
+void windowAddBeat(uint32_t intervalMs);
+void windowGap();
+float windowMeanHeartRate();
+void windowSummarize(uint8_t quality, HeartRateSummary* summary);
+
+#endif
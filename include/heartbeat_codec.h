@@ -0,0 +1,50 @@
+/*****************************************************************************************
+ * Heartbeat Codec
+ *
+ * Versioned compact encoding of heart rate readings for log_heartbeat_compact. Rates are
+ * quantized to a byte (or 0.1 BPM in two bytes), timestamps are delta-encoded as
+ * zig-zag varints of the age in seconds (readings a minute apart take one byte), the
+ * window summary is varint-coded and the quality becomes one bit per reading.
+ *
+ * Format (version 1):
+ *   u8 version, u8 flags, varint count, count entries, quality bitmap (FLAG_QUALITY)
+ *   entry: rate (u8 BPM, or u16 0.1 BPM with FLAG_FINE_RATE), varint time code,
+ *          summary (FLAG_SUMMARY): varint beats, std dev, RMSSD, high seconds,
+ *          zig-zag varint min and max relative to the rate (whole BPM)
+ *   time code: 0 unknown (earlier boot), else 1 + zig-zag(age - age of the previous
+ *              timed entry), the first timed entry relative to 0
+ *
+ * Pure functions of their inputs, with a decoder, so payloads can be checked off-device.
+ *
+ *****************************************************************************************/
+
+#ifndef HEARTBEAT_CODEC_H
+#define HEARTBEAT_CODEC_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "heart_rate_reading.h"
+
+/*****************************************************************************************
+* Configuration
+*****************************************************************************************/
+#define HEARTBEAT_CODEC_VERSION 1
+#define HEARTBEAT_CODEC_FLAG_FINE_RATE 0x01  // u16 rate in 0.1 BPM instead of u8 BPM
+#define HEARTBEAT_CODEC_FLAG_SUMMARY 0x02    // Entries carry the window summary
+#define HEARTBEAT_CODEC_FLAG_QUALITY 0x04    // Bitmap of readings with good signal quality
+#define HEARTBEAT_CODEC_HEADER_SIZE 2        // Version and flags
+#define HEARTBEAT_CODEC_MIN_ENTRY_SIZE 2     // u8 rate and a one-byte time code
+#ifndef HEARTBEAT_CODEC_GOOD_QUALITY
+#define HEARTBEAT_CODEC_GOOD_QUALITY 80      // Quality index setting the reading's bit
+#endif
+
+/*****************************************************************************************
+* Function Declarations
+*****************************************************************************************/
+size_t heartbeatCodecFit(const HeartRateReading* readings, size_t count, uint8_t flags, size_t capacity);
+size_t heartbeatCodecEncode(const HeartRateReading* readings, size_t count, unsigned long nowMs, uint8_t flags,
+                            uint8_t* output, size_t capacity);
+bool heartbeatCodecDecode(const uint8_t* input, size_t length, unsigned long nowMs,
+                          HeartRateReading* readings, size_t maxReadings, size_t* count, uint8_t* flags);
+
+#endif
@@ -0,0 +1,35 @@
+/*****************************************************************************************
+ * Heartbeat Payload
+ *
+ * Instruction data encoders for log_heartbeat. Pure functions of their inputs (the
+ * current time is passed in), so transaction building can be exercised off-device.
+ *
+ *****************************************************************************************/
+
+#ifndef HEARTBEAT_PAYLOAD_H
+#define HEARTBEAT_PAYLOAD_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "heart_rate_reading.h"
+#include "heartbeat_codec.h"
+
+/*****************************************************************************************
+* Configuration
+*****************************************************************************************/
+#define HEARTBEAT_SINGLE_SIZE 4         // f32 heart rate
+#define HEARTBEAT_PACKED_ENTRY_SIZE 8   // u32 age (ms) + f32 heart rate
+#define HEARTBEAT_PACKED_SIZE(count) (sizeof(uint32_t) + (count) * HEARTBEAT_PACKED_ENTRY_SIZE)
+#define HEARTBEAT_COMPACT_PREFIX_SIZE 4 // u32 length of the Vec<u8>
+#define HEARTBEAT_SUMMARY_SIZE 15       // f32 mean, u16 beats/std dev/RMSSD/high time, u8 min/max/quality
+
+/*****************************************************************************************
+* Function Declarations
+*****************************************************************************************/
+size_t heartbeatPayloadSingle(const HeartRateReading* readings, size_t count, uint8_t* payload);
+size_t heartbeatPayloadSummary(const HeartRateReading* readings, size_t count, uint8_t* payload);
+size_t heartbeatPayloadPacked(const HeartRateReading* readings, size_t count, unsigned long nowMs, uint8_t* payload);
+size_t heartbeatPayloadCompact(const HeartRateReading* readings, size_t count, unsigned long nowMs, uint8_t flags,
+                               uint8_t* payload, size_t payloadSize);
+
+#endif
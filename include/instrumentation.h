@@ -0,0 +1,74 @@
+/*****************************************************************************************
+ * Instrumentation
+ *
+ * Per-stage latency histograms and event counters for finding where the cycle budget goes
+ * in the field. Stages are timed with the CPU cycle counter (tasks are pinned, so start and
+ * stop read the same core's counter) and binned in power-of-two microsecond buckets.
+ *
+ *   uint32_t start = instrumentStart();
+ *   ...
+ *   instrumentStop(STAGE_SIGN, start);
+ *
+ *****************************************************************************************/
+
+#ifndef INSTRUMENTATION_H
+#define INSTRUMENTATION_H
+
+#include <Arduino.h>
+
+/*****************************************************************************************
+* Configuration
+*****************************************************************************************/
+#ifndef INSTRUMENTATION_ENABLED
+#define INSTRUMENTATION_ENABLED 1
+#endif
+#ifndef INSTRUMENT_TELEMETRY_MS
+#define INSTRUMENT_TELEMETRY_MS 0       // Period of binary telemetry records (0 = off)
+#endif
+#define INSTRUMENT_BUCKETS 24           // Bucket b holds durations below 2^b us (last: above)
+#define INSTRUMENT_TELEMETRY_TAG 0x01   // logBinary() tag of telemetry records
+
+enum InstrumentStage {
+  STAGE_ADC_WINDOW,                     // Sampler: one DMA frame into the ring buffer
+  STAGE_FILTER,                         // Loop: band-pass filter over one block
+  STAGE_PEAK_DETECT,                    // Loop: peak detection on one window
+  STAGE_DISPLAY_FLUSH,                  // Display task: one frame to the panel
+  STAGE_BLOCKHASH_FETCH,                // Network task: getLatestBlockhash
+  STAGE_SIGN,                           // Network task: Ed25519 signature
+  STAGE_SERIALIZE,                      // Network task: blockhash patch and base64 encode
+  STAGE_RPC_SUBMIT,                     // Network task: sendTransaction
+  STAGE_COUNT
+};
+
+enum InstrumentCounter {
+  COUNTER_ADC_POOL_OVERFLOWS,           // ADC driver pool full (conversions lost)
+  COUNTER_LOOP_DEADLINE_MISSES,         // Heart rate update ran a full period late
+  COUNTER_TX_FAILURES,                  // Transactions that were not accepted
+  COUNTER_RPC_RETRIES,                  // RPC calls repeated on a new connection
+  COUNTER_UPLOAD_RETRIES,               // Batches uploaded again after a failure
+  COUNTER_TX_DROPPED,                   // Accepted transactions that never landed (resent)
+  COUNTER_RPC_FAILOVERS,                // RPC calls sent to another endpoint
+  COUNTER_TX_RATE_LIMITED,              // Transactions rejected by the program's rate limit (resent)
+  COUNTER_COUNT
+};
+
+/*****************************************************************************************
+* Function Declarations
+*****************************************************************************************/
+#if INSTRUMENTATION_ENABLED
+static inline uint32_t instrumentStart() {
+  return ESP.getCycleCount();
+}
+void instrumentStop(InstrumentStage stage, uint32_t startCycles);
+void instrumentCount(InstrumentCounter counter);
+void instrumentPrint();
+void instrumentService();
+#else
+static inline uint32_t instrumentStart() { return 0; }
+static inline void instrumentStop(InstrumentStage stage, uint32_t startCycles) {}
+static inline void instrumentCount(InstrumentCounter counter) {}
+static inline void instrumentPrint() {}
+static inline void instrumentService() {}
+#endif
+
+#endif
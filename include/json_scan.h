@@ -0,0 +1,35 @@
+/*****************************************************************************************
+ * JSON Scan
+ *
+ * Zero-copy lookup of single values in a JSON-RPC response. Instead of building a document
+ * of the whole response, a path such as "result.value.blockhash" is followed through the
+ * text and only the addressed value is located; everything else is skipped without being
+ * stored. Numeric path segments index arrays. Needs no memory beyond the response itself.
+ *
+ * Pure functions of their inputs, so parsing can be exercised off-device.
+ *
+ *****************************************************************************************/
+
+#ifndef JSON_SCAN_H
+#define JSON_SCAN_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+struct JsonValue {
+  const char* start;                    // First character of the value
+  size_t length;                        // Length of its text (strings including the quotes)
+};
+
+/*****************************************************************************************
+* Function Declarations
+*****************************************************************************************/
+bool jsonFind(const char* json, const char* path, JsonValue* value);
+bool jsonFindIn(const JsonValue& container, const char* path, JsonValue* value);
+size_t jsonArrayLength(const JsonValue& array);
+bool jsonIsNull(const JsonValue& value);
+bool jsonIsString(const JsonValue& value, const char* expected);
+bool jsonCopyString(const JsonValue& value, char* output, size_t outputSize);
+bool jsonGetUint64(const JsonValue& value, uint64_t* output);
+
+#endif
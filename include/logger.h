@@ -0,0 +1,76 @@
+/*****************************************************************************************
+ * Logger
+ *
+ * Non-blocking serial logging. Messages are formatted by the caller into a ring buffer and
+ * written to Serial by a low-priority task, so a slow or undrained USB CDC port never
+ * stalls the loop or the network task. Levels are resolved at compile time: calls above
+ * LOG_LEVEL expand to nothing, arguments included.
+ *
+ *****************************************************************************************/
+
+#ifndef LOGGER_H
+#define LOGGER_H
+
+#include <Arduino.h>
+
+/*****************************************************************************************
+* Configuration
+*****************************************************************************************/
+#define LOG_LEVEL_NONE 0
+#define LOG_LEVEL_ERROR 1               // Failures
+#define LOG_LEVEL_INFO 2                // Status and results
+#define LOG_LEVEL_DEBUG 3               // Per-reading output and statistics
+
+#ifndef LOG_LEVEL
+#define LOG_LEVEL LOG_LEVEL_DEBUG       // Release builds: -DLOG_LEVEL=LOG_LEVEL_INFO
+#endif
+#ifndef LOG_BINARY
+#define LOG_BINARY 0                    // 1 to enable binary records (signal dumps)
+#endif
+
+#ifndef LOG_BUFFER_SIZE
+#define LOG_BUFFER_SIZE 4096            // Ring buffer size in bytes (power of two)
+#endif
+#define LOG_LINE_SIZE 192               // Longest formatted message
+#define LOG_BINARY_SYNC 0xA5            // First byte of a binary record
+
+#define LOG_TASK_CORE 0
+#define LOG_TASK_PRIORITY 0             // Idle priority: only runs when nothing else does
+#define LOG_TASK_STACK_SIZE 2048
+
+/*****************************************************************************************
+* Log Macros
+*****************************************************************************************/
+#if LOG_LEVEL >= LOG_LEVEL_ERROR
+#define LOG_ERROR(...) logPrintf(__VA_ARGS__)
+#else
+#define LOG_ERROR(...) ((void)0)
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_INFO
+#define LOG_INFO(...) logPrintf(__VA_ARGS__)
+#else
+#define LOG_INFO(...) ((void)0)
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_DEBUG
+#define LOG_DEBUG(...) logPrintf(__VA_ARGS__)
+#else
+#define LOG_DEBUG(...) ((void)0)
+#endif
+
+#if LOG_BINARY
+#define LOG_RECORD(tag, data, length) logBinary(tag, data, length)
+#else
+#define LOG_RECORD(tag, data, length) ((void)0)
+#endif
+
+/*****************************************************************************************
+* Function Declarations
+*****************************************************************************************/
+bool logBegin();
+void logPrintf(const char* format, ...) __attribute__((format(printf, 1, 2)));
+bool logBinary(uint8_t tag, const void* data, uint16_t length);
+uint32_t logDropped();
+
+#endif
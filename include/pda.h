@@ -0,0 +1,35 @@
+/*****************************************************************************************
+ * Program Derived Addresses
+ *
+ * Solana PDA derivation for first provisioning: the bump search hashes
+ * seeds || bump || program id || "ProgramDerivedAddress" with SHA-256 through mbedTLS
+ * (SHA hardware accelerator) from one stack buffer, patching only the bump byte between
+ * attempts, and accepts the first hash that is not an Ed25519 curve point.
+ *
+ *****************************************************************************************/
+
+#ifndef PDA_H
+#define PDA_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*****************************************************************************************
+* Configuration
+*****************************************************************************************/
+#define PDA_MAX_SEEDS 16                // Solana runtime limits
+#define PDA_MAX_SEED_LENGTH 32
+
+struct PdaSeed {
+  const uint8_t* data;
+  size_t length;
+};
+
+/*****************************************************************************************
+* Function Declarations
+*****************************************************************************************/
+bool pdaFind(const PdaSeed* seeds, size_t seedCount, const uint8_t* programId,
+             uint8_t* address, uint8_t* bump);
+bool pdaOnCurve(const uint8_t* point);
+
+#endif
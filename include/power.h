@@ -0,0 +1,35 @@
+/*****************************************************************************************
+ * Power
+ *
+ * Radio duty-cycling around uploads. Between uploads WiFi stays in max modem sleep (or is
+ * switched off entirely when POWER_RADIO_OFF_BETWEEN_UPLOADS is set, which suits large
+ * batches); the network task brings it up only for the duration of an upload. A hold
+ * (UDP capture) keeps the radio up and out of power save until it is released.
+ *
+ *****************************************************************************************/
+
+#ifndef POWER_H
+#define POWER_H
+
+#include <Arduino.h>
+
+/*****************************************************************************************
+* Configuration
+*****************************************************************************************/
+#ifndef POWER_RADIO_OFF_BETWEEN_UPLOADS
+#define POWER_RADIO_OFF_BETWEEN_UPLOADS 0   // 1: WiFi off between uploads, 0: modem sleep
+#endif
+#ifndef POWER_RECONNECT_TIMEOUT_MS
+#define POWER_RECONNECT_TIMEOUT_MS 10000
+#endif
+
+/*****************************************************************************************
+* Function Declarations
+*****************************************************************************************/
+void powerBegin();
+bool powerRadioUp();
+void powerRadioDown();
+bool powerRadioIdleAvailable();
+void powerRadioHold(bool hold);
+
+#endif
@@ -0,0 +1,36 @@
+/*****************************************************************************************
+ * Reading Store
+ *
+ * Persistent store-and-forward queue of heart rate readings in a raw flash partition, so
+ * readings survive failed uploads, WiFi outages and reboots until they are on-chain.
+ *
+ *****************************************************************************************/
+
+#ifndef READING_STORE_H
+#define READING_STORE_H
+
+#include <Arduino.h>
+#include "heart_rate_reading.h"
+
+/*****************************************************************************************
+* Configuration
+*****************************************************************************************/
+#define STORE_PARTITION_LABEL "hrlog"   // Data partition from partitions.csv
+#define STORE_SECTOR_SIZE 4096
+#define STORE_HEADER_SIZE 16
+#define STORE_RECORD_SIZE 32
+#define STORE_RECORDS_PER_SECTOR ((STORE_SECTOR_SIZE - STORE_HEADER_SIZE) / STORE_RECORD_SIZE)
+
+/*****************************************************************************************
+* Function Declarations
+*****************************************************************************************/
+bool storeBegin();
+bool storeAppend(const HeartRateReading& reading);
+size_t storePeek(HeartRateReading* readings, size_t maxReadings);
+uint32_t storeReservePeeked();
+void storeConsumeReserved(uint32_t slots);
+uint32_t storePending();
+uint32_t storeReserved();
+uint32_t storeDropped();
+
+#endif
@@ -0,0 +1,47 @@
+/*****************************************************************************************
+ * Rewards
+ *
+ * Points-aware mint_reward scheduler. The accumulated points are read straight from the
+ * HeartBeat account with a getAccountInfo data slice (8 bytes instead of the account),
+ * at most every REWARDS_CHECK_MS, and a mint is only requested once they reach
+ * REWARDS_MIN_POINTS so the fee is not spent on a handful of points. A requested mint
+ * is merged into the next log_heartbeat transaction when it fits. While the RPC WebSocket
+ * is connected the points are pushed on every change and not polled.
+ *
+ *****************************************************************************************/
+
+#ifndef REWARDS_H
+#define REWARDS_H
+
+#include <Arduino.h>
+
+/*****************************************************************************************
+* Configuration
+*****************************************************************************************/
+#ifndef REWARDS_CHECK_MS
+#define REWARDS_CHECK_MS 600000         // Points check interval (10 minutes)
+#endif
+#ifndef REWARDS_RETRY_MS
+#define REWARDS_RETRY_MS 60000          // Wait after a failed points check
+#endif
+#ifndef REWARDS_MIN_POINTS
+#define REWARDS_MIN_POINTS 1000         // Mint once the points are worth a transaction fee
+#endif
+
+// Points field (u64, little-endian) of the HeartBeat account: discriminator (8), owner (32),
+// heart rate buffer (10 x f32), buffer index (u8). Must match the deployed program
+#ifndef HEARTBEAT_POINTS_OFFSET
+#define HEARTBEAT_POINTS_OFFSET 81
+#endif
+
+/*****************************************************************************************
+* Function Declarations
+*****************************************************************************************/
+void rewardsBegin(const uint8_t* accountAddress);
+void rewardsService();
+bool rewardsMintDue();
+void rewardsMintSent();
+uint64_t rewardsPoints();
+unsigned long rewardsMsUntilCheck();
+
+#endif
@@ -0,0 +1,86 @@
+/*****************************************************************************************
+ * RPC Client
+ *
+ * Keep-alive JSON-RPC client for the Solana endpoints. A TLS connection is opened once and
+ * reused by every request, and re-established transparently when the link drops. With
+ * several endpoints configured, requests go to the fastest healthy one and fail over to
+ * the others; rate limited endpoints are backed off. Handshake and request times are
+ * tracked separately. Requests and responses live in fixed buffers.
+ *
+ *****************************************************************************************/
+
+#ifndef RPC_CLIENT_H
+#define RPC_CLIENT_H
+
+#include <Arduino.h>
+#include "tx_template.h"
+#include "json_scan.h"
+
+/*****************************************************************************************
+* Configuration
+*****************************************************************************************/
+#ifndef RPC_TIMEOUT_MS
+#define RPC_TIMEOUT_MS 10000            // HTTP response timeout
+#endif
+#ifndef RPC_HANDSHAKE_TIMEOUT_S
+#define RPC_HANDSHAKE_TIMEOUT_S 10      // TLS handshake timeout
+#endif
+#ifndef RPC_MAX_ENDPOINTS
+#define RPC_MAX_ENDPOINTS 3
+#endif
+#ifndef RPC_HEDGE_MS
+#define RPC_HEDGE_MS 3000               // sendTransaction timeout on the first endpoint before the next is tried
+#endif
+#define RPC_EWMA_WEIGHT 8               // Latency / error EWMAs move 1/8 towards each sample
+#define RPC_UNMEASURED_LATENCY_MS 1000  // Assumed latency of an endpoint not used yet
+#ifndef RPC_BACKOFF_MIN_MS
+#define RPC_BACKOFF_MIN_MS 2000         // First backoff after a failure or 429, doubled on repeats
+#endif
+#ifndef RPC_BACKOFF_MAX_MS
+#define RPC_BACKOFF_MAX_MS 120000
+#endif
+#define RPC_REQUEST_SIZE (TX_BASE64_SIZE + 128)  // Large enough for a full sendTransaction
+#ifndef RPC_RESPONSE_SIZE
+#define RPC_RESPONSE_SIZE 4096
+#endif
+#define BLOCKHASH_BASE58_SIZE 45        // 44 characters + terminator
+#define PUBKEY_BASE58_SIZE 45
+#define SIGNATURE_BASE58_SIZE 89        // 88 characters + terminator
+#define RPC_MAX_SIGNATURE_STATUSES 8    // Signatures per getSignatureStatuses request
+#define RPC_MAX_ACCOUNT_SLICE 64        // Bytes per getAccountInfo data slice
+#define RPC_NO_ERROR_CODE UINT32_MAX    // Failed without a program error code (or did not fail)
+
+enum RpcSignatureStatus {
+  RPC_SIGNATURE_UNKNOWN,                // Not (or no longer) known to the cluster
+  RPC_SIGNATURE_PROCESSED,              // In a block that is not confirmed yet
+  RPC_SIGNATURE_CONFIRMED,              // Confirmed or finalized without error
+  RPC_SIGNATURE_FAILED                  // Executed, but the transaction returned an error
+};
+
+struct RpcStats {
+  uint32_t requests;                    // Completed HTTP requests
+  uint32_t failures;                    // Requests that failed on every endpoint tried
+  uint32_t handshakes;                  // TLS handshakes performed
+  unsigned long lastHandshakeMs;
+  unsigned long totalHandshakeMs;
+  unsigned long lastRequestMs;          // Time from sending the request to the parsed response
+  unsigned long totalRequestMs;
+};
+
+/*****************************************************************************************
+* Function Declarations
+*****************************************************************************************/
+bool rpcBegin(const char* const* urls, size_t count);
+bool rpcCall(const char* body, size_t bodyLength, char* response, size_t responseSize);
+bool rpcGetLatestBlockhash(char* blockhash, size_t blockhashSize);
+bool rpcSendRawTransaction(const char* txBase64, char* signature, size_t signatureSize);
+bool rpcGetSignatureStatuses(const char* const* signatures, size_t count, RpcSignatureStatus* statuses,
+                             uint32_t* errorCodes);
+uint32_t rpcProgramErrorCode(const JsonValue& err);
+bool rpcGetAccountData(const uint8_t* address, size_t offset, size_t length, uint8_t* data);
+bool rpcGetSplTokenBalance(const char* ownerBase58, const char* mintBase58, uint64_t& outBalance);
+void rpcDisconnect();
+const RpcStats& rpcStats();
+void printRpcStats();
+
+#endif
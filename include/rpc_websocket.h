@@ -0,0 +1,59 @@
+/*****************************************************************************************
+ * RPC WebSocket
+ *
+ * Persistent WebSocket connection to the PubSub endpoint of the Solana RPC (same host,
+ * wss://). Accounts registered with wsSubscribeAccount() are pushed to their handler on
+ * every change instead of being polled, and a transaction signature can be watched until
+ * it is confirmed. Account subscriptions are renewed on every reconnect; signature
+ * subscriptions are one-shot, the server drops them after the notification.
+ *
+ * Minimal client (RFC 6455): text frames only, no extensions or fragmentation, fixed
+ * buffers; a frame larger than the receive buffer is skipped.
+ *
+ *****************************************************************************************/
+
+#ifndef RPC_WEBSOCKET_H
+#define RPC_WEBSOCKET_H
+
+#include <Arduino.h>
+
+/*****************************************************************************************
+* Configuration
+*****************************************************************************************/
+#ifndef WS_PING_MS
+#define WS_PING_MS 30000                // Keepalive ping (servers close idle connections after ~60 s)
+#endif
+#ifndef WS_RECONNECT_MS
+#define WS_RECONNECT_MS 15000           // Wait after a failed or lost connection
+#endif
+#ifndef WS_HANDSHAKE_TIMEOUT_MS
+#define WS_HANDSHAKE_TIMEOUT_MS 10000   // TLS connect plus HTTP upgrade
+#endif
+#ifndef WS_SERVICE_MS
+#define WS_SERVICE_MS 1000              // Receive poll interval while connected
+#endif
+#define WS_RX_BUFFER_SIZE 2048          // Largest frame received
+#define WS_TX_BUFFER_SIZE 320           // Largest frame sent (signatureSubscribe)
+#define WS_MAX_ACCOUNT_DATA 256         // Largest account whose notifications are decoded
+#define WS_MAX_ACCOUNTS 2
+#define WS_MAX_SIGNATURES 8
+
+// Receives [offset, offset + length) of the account data after every change
+typedef void (*WsAccountHandler)(const uint8_t* data, size_t length);
+// Receives the outcome of a watched transaction once it is confirmed (the program error
+// code if it failed with one, RPC_NO_ERROR_CODE otherwise)
+typedef void (*WsSignatureHandler)(const char* signature, bool success, uint32_t errorCode);
+
+/*****************************************************************************************
+* Function Declarations
+*****************************************************************************************/
+bool wsBegin(const char* url);
+bool wsSubscribeAccount(const uint8_t* address, size_t offset, size_t length, WsAccountHandler handler);
+bool wsSubscribeSignature(const char* signature, WsSignatureHandler handler);
+void wsCancelSignature(const char* signature);
+void wsService();
+void wsDisconnect();
+bool wsConnected();
+uint32_t wsSessions();
+
+#endif
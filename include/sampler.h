@@ -0,0 +1,40 @@
+/*****************************************************************************************
+ * Sampler
+ *
+ * Fixed-rate sampling engine for the KY039 heart rate sensor(s). The ESP32 ADC runs in
+ * continuous (DMA) mode and scans SAMPLER_CHANNELS pins in one pattern; a dedicated task
+ * oversamples the conversions and writes them into per-channel rings that the loop drains
+ * in blocks. All channels share one sample index, so sample N of every channel belongs to
+ * the same scan.
+ *
+ *****************************************************************************************/
+
+#ifndef SAMPLER_H
+#define SAMPLER_H
+
+#include <Arduino.h>
+#include "sampler_config.h"
+
+/*****************************************************************************************
+* Configuration
+*****************************************************************************************/
+#ifndef SAMPLER_FRAME_CONVERSIONS
+#define SAMPLER_FRAME_CONVERSIONS 50    // Conversions per DMA frame (50ms at 1kHz)
+#endif
+#ifndef SAMPLE_RING_SIZE
+#define SAMPLE_RING_SIZE 1024           // Ring buffer size in samples (power of two)
+#endif
+
+#define SAMPLER_TASK_CORE 1
+#define SAMPLER_TASK_PRIORITY (configMAX_PRIORITIES - 2)
+#define SAMPLER_TASK_STACK_SIZE 4096
+
+/*****************************************************************************************
+* Function Declarations
+*****************************************************************************************/
+bool samplerBegin(const uint8_t* pins);
+size_t samplerRead(uint16_t* samples, size_t maxSamples, uint32_t* firstIndex);
+unsigned long samplerSampleTimeMs(uint32_t sampleIndex);
+uint32_t samplerOverruns();
+
+#endif
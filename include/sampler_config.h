@@ -0,0 +1,24 @@
+/*****************************************************************************************
+ * Sampler Configuration
+ *
+ * Sample rate constants shared by the sampler and the signal processing modules. Kept free
+ * of Arduino headers so the signal pipeline also compiles for the host.
+ *
+ *****************************************************************************************/
+
+#ifndef SAMPLER_CONFIG_H
+#define SAMPLER_CONFIG_H
+
+#ifndef SAMPLER_ADC_RATE_HZ
+#define SAMPLER_ADC_RATE_HZ 1000        // ADC DMA conversion rate (ESP32-S3 minimum is ~611 Hz)
+#endif
+#ifndef SAMPLER_OVERSAMPLE
+#define SAMPLER_OVERSAMPLE 2            // Conversions averaged into one output sample
+#endif
+#ifndef SAMPLER_CHANNELS
+#define SAMPLER_CHANNELS 1              // Sensor channels converted in one DMA scan
+#endif
+#define SAMPLE_RATE_HZ (SAMPLER_ADC_RATE_HZ / SAMPLER_OVERSAMPLE)  // Per channel
+#define SAMPLE_PERIOD_US (1000000UL / SAMPLE_RATE_HZ)
+
+#endif
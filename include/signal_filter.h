@@ -0,0 +1,40 @@
+/*****************************************************************************************
+ * Signal Filter
+ *
+ * Fixed-point band-pass filter for the raw KY039 signal, run on every sample at
+ * SAMPLE_RATE_HZ: a one-mains-period moving average (nulls 50Hz and its harmonics), a
+ * DC-blocking high-pass and a two-pole low-pass. All stages are integer shift/add
+ * arithmetic on Q-format state, so a block of DMA samples is filtered in one pass. Every
+ * sampler channel has its own state.
+ *
+ *****************************************************************************************/
+
+#ifndef SIGNAL_FILTER_H
+#define SIGNAL_FILTER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "sampler_config.h"
+
+/*****************************************************************************************
+* Configuration
+*****************************************************************************************/
+#define FILTER_Q_BITS 8                 // Fractional bits of filter values (Q23.8)
+#ifndef FILTER_MAINS_HZ
+#define FILTER_MAINS_HZ 50              // Mains frequency to null (use 60 where applicable)
+#endif
+#define FILTER_MAINS_TAPS (SAMPLE_RATE_HZ / FILTER_MAINS_HZ)
+#ifndef FILTER_HIGHPASS_SHIFT
+#define FILTER_HIGHPASS_SHIFT 8         // DC blocker pole 1 - 2^-8: ~0.3Hz corner at 500Hz
+#endif
+#ifndef FILTER_LOWPASS_SHIFT
+#define FILTER_LOWPASS_SHIFT 4          // Low-pass poles 1 - 2^-4: ~5Hz corner at 500Hz
+#endif
+
+/*****************************************************************************************
+* Function Declarations
+*****************************************************************************************/
+void filterReset();
+void filterProcessBlock(uint32_t channel, const uint16_t* samples, size_t count, int32_t* output);
+
+#endif
@@ -0,0 +1,45 @@
+/*****************************************************************************************
+ * Signal Quality
+ *
+ * Signal quality index (0-100) of the window between two heart rate readings. Raw samples
+ * are counted for clipping block by block as they are filtered, and every beat candidate
+ * of the detector is reported with its amplitude and interval. The index is the weakest
+ * of four scores: clipping, pulse amplitude, share of candidates accepted as beats and
+ * regularity of the beat intervals (coefficient of variation). Readings below
+ * SIGNAL_QUALITY_MIN are not uploaded.
+ *
+ * No Arduino dependency, so recorded traces can be scored on the host.
+ *
+ *****************************************************************************************/
+
+#ifndef SIGNAL_QUALITY_H
+#define SIGNAL_QUALITY_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "signal_filter.h"
+
+/*****************************************************************************************
+* Configuration
+*****************************************************************************************/
+#ifndef SIGNAL_QUALITY_MIN
+#define SIGNAL_QUALITY_MIN 55           // Readings from worse windows are not uploaded
+#endif
+#ifndef SIGNAL_QUALITY_MIN_BEATS
+#define SIGNAL_QUALITY_MIN_BEATS 5      // Fewer accepted beats in a window score 0
+#endif
+#ifndef SIGNAL_QUALITY_GOOD_AMPLITUDE
+#define SIGNAL_QUALITY_GOOD_AMPLITUDE (8 << FILTER_Q_BITS)  // Pulse amplitude (filtered) scoring 100
+#endif
+#define SIGNAL_QUALITY_MAX_CV_PERCENT 25 // Interval variation scoring 0
+#define SIGNAL_QUALITY_ADC_MAX 4095     // Raw value of a saturated 12-bit conversion
+
+/*****************************************************************************************
+* Function Declarations
+*****************************************************************************************/
+void qualityReset();
+void qualityAddSamples(const uint16_t* samples, size_t count);
+void qualityAddBeat(bool accepted, uint32_t intervalMs, int32_t amplitude);
+uint8_t qualityScore();
+
+#endif
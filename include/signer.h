@@ -0,0 +1,43 @@
+/*****************************************************************************************
+ * Signer
+ *
+ * Resident Ed25519 signing context for the fee payer. The secret key is decoded and
+ * checked once at boot and kept here for the lifetime of the firmware, so a send only
+ * hashes and signs the message. When the framework ships libsodium (ESP-IDF component)
+ * it is used as the backend: its ref10 code multiplies by the base point with the
+ * precomputed tables in flash and routes SHA-512 through mbedTLS, i.e. the SHA hardware
+ * accelerator. Otherwise signing falls back to the rweather Crypto implementation.
+ *
+ *****************************************************************************************/
+
+#ifndef SIGNER_H
+#define SIGNER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*****************************************************************************************
+* Configuration
+*****************************************************************************************/
+#define SIGNER_SEED_SIZE 32
+#define SIGNER_PUBLIC_KEY_SIZE 32
+#define SIGNER_SECRET_KEY_SIZE 64       // Seed followed by the public key (Solana format)
+#define SIGNER_SIGNATURE_SIZE 64
+
+#ifndef SIGNER_USE_SODIUM
+#if __has_include(<sodium.h>)
+#define SIGNER_USE_SODIUM 1
+#else
+#define SIGNER_USE_SODIUM 0
+#endif
+#endif
+
+/*****************************************************************************************
+* Function Declarations
+*****************************************************************************************/
+bool signerBegin(const uint8_t* secretKey);
+void signerSign(uint8_t* signature, const uint8_t* message, size_t length);
+const uint8_t* signerPublicKey();
+const char* signerBackend();
+
+#endif
@@ -0,0 +1,59 @@
+/*****************************************************************************************
+ * Transaction Pipeline
+ *
+ * In-flight window for log_heartbeat uploads. A transaction accepted by sendTransaction
+ * is not the end of an upload: it only leaves the pipeline once getSignatureStatuses
+ * reports it confirmed. Up to TX_PIPELINE_WINDOW transactions are outstanding at a time,
+ * so the next batch is built, signed and sent while the previous ones are still landing,
+ * and all of them are checked with a single status request. A transaction the cluster
+ * never saw (dropped, its blockhash has expired) is signed again with a fresh blockhash
+ * and resent; only then are its readings sent twice. A transaction the program rejected for
+ * arriving before its rate limit is resent TX_REJECTED_RESEND_MS later instead of given up.
+ *
+ *****************************************************************************************/
+
+#ifndef TX_PIPELINE_H
+#define TX_PIPELINE_H
+
+#include <Arduino.h>
+#include "heart_rate_reading.h"
+#include "rpc_client.h"
+
+/*****************************************************************************************
+* Configuration
+*****************************************************************************************/
+#ifndef TX_PIPELINE_WINDOW
+#define TX_PIPELINE_WINDOW 4            // Transactions in flight (sent, not confirmed)
+#endif
+#define TX_PIPELINE_MAX_READINGS 128    // Readings per transaction the pipeline can hold
+#ifndef TX_STATUS_POLL_MS
+#define TX_STATUS_POLL_MS 2000          // getSignatureStatuses interval while in flight
+#endif
+#ifndef TX_STATUS_POLL_WS_MS
+#define TX_STATUS_POLL_WS_MS 20000      // Fallback interval while confirmations are pushed
+#endif
+#ifndef TX_DROP_TIMEOUT_MS
+#define TX_DROP_TIMEOUT_MS 120000       // Unknown this long after sending: blockhash expired, dropped
+#endif
+#ifndef TX_RATE_LIMIT_ERROR
+#define TX_RATE_LIMIT_ERROR 6000        // Program error of a log_heartbeat sent too early (Anchor's first)
+#endif
+#ifndef TX_REJECTED_RESEND_MS
+#define TX_REJECTED_RESEND_MS 60000     // Wait before resending a transaction rejected by the rate limit
+#endif
+
+// Signs and sends the readings again, storing the new signature
+typedef bool (*TxPipelineResubmit)(const HeartRateReading* readings, size_t count, char* signature);
+
+/*****************************************************************************************
+* Function Declarations
+*****************************************************************************************/
+void pipelineBegin(TxPipelineResubmit resubmit);
+bool pipelineAdd(const HeartRateReading* readings, size_t count, uint32_t storeSlots, const char* signature);
+void pipelineAddSlots(uint32_t storeSlots);
+void pipelineService();
+bool pipelineFull();
+size_t pipelineInFlight();
+unsigned long pipelineMsUntilPoll();
+
+#endif
@@ -0,0 +1,63 @@
+/*****************************************************************************************
+ * Transaction Templates
+ *
+ * Prebuilt legacy Solana transactions for instructions the device sends repeatedly. The
+ * header, account keys and instruction prefix are serialized once into a fixed buffer;
+ * each send only patches the blockhash and instruction data in place, signs the message
+ * and base64-encodes it, without any heap allocation.
+ *
+ * Buffer layout: [signature count][signature][header][account keys][blockhash][instructions]
+ *
+ *****************************************************************************************/
+
+#ifndef TX_TEMPLATE_H
+#define TX_TEMPLATE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*****************************************************************************************
+* Configuration
+*****************************************************************************************/
+#define SOLANA_TX_SIZE_LIMIT 1232       // Maximum serialized transaction size
+#define SOLANA_PUBKEY_SIZE 32
+#define SOLANA_SIGNATURE_SIZE 64
+#define ANCHOR_DISCRIMINATOR_SIZE 8
+#define TX_TEMPLATE_MAX_ACCOUNTS 8      // Message accounts (program id not included)
+#define TX_BASE64_SIZE (((SOLANA_TX_SIZE_LIMIT + 2) / 3) * 4 + 1)
+
+struct TemplateAccount {
+  const uint8_t* pubkey;
+  bool isSigner;
+  bool isWritable;
+};
+
+struct TxTemplate {
+  uint8_t buffer[SOLANA_TX_SIZE_LIMIT];
+  size_t length;                        // Serialized length including the signature
+  size_t blockhashOffset;
+  size_t instructionsOffset;
+  uint8_t ixPrefix[TX_TEMPLATE_MAX_ACCOUNTS + 2];  // Program index, account count, account indices
+  size_t ixPrefixLength;
+  uint8_t discriminator[ANCHOR_DISCRIMINATOR_SIZE];
+  uint8_t extraPrefix[TX_TEMPLATE_MAX_ACCOUNTS + 2];  // Merged templates: second instruction kind
+  size_t extraPrefixLength;             // 0 when the template has no extra instruction
+  uint8_t extraDiscriminator[ANCHOR_DISCRIMINATOR_SIZE];
+};
+
+/*****************************************************************************************
+* Function Declarations
+*****************************************************************************************/
+bool txTemplateBuild(TxTemplate* tpl, const TemplateAccount* accounts, size_t accountCount,
+                     const uint8_t* programId, const uint8_t* discriminator);
+bool txTemplateBuildMerged(TxTemplate* tpl, const TemplateAccount* accounts, size_t accountCount,
+                           const uint8_t* discriminator, const TemplateAccount* extraAccounts,
+                           size_t extraCount, const uint8_t* extraDiscriminator, const uint8_t* programId);
+void txTemplateSetBlockhash(TxTemplate* tpl, const uint8_t* blockhash);
+bool txTemplateSetInstructions(TxTemplate* tpl, const uint8_t* payloads, size_t payloadLength, size_t count);
+void txTemplateSign(TxTemplate* tpl);
+size_t txTemplateBase64(const TxTemplate* tpl, char* output, size_t outputSize);
+bool base58DecodeFixed(const char* input, uint8_t* output, size_t outputLength);
+size_t base58Encode(const uint8_t* input, size_t inputLength, char* output, size_t outputSize);
+
+#endif
@@ -0,0 +1,50 @@
+/*****************************************************************************************
+ * Upload Schedule
+ *
+ * Spreads the uploads of a fleet instead of having every device that booted with the same
+ * power-up hit the RPC node in the same second. Each device uploads once per slot at a
+ * fixed phase derived from its public key, plus a random jitter, and never sooner than
+ * UPLOAD_RATE_LIMIT_MS after its last accepted transaction (the program rejects a
+ * log_heartbeat that arrives early). The slot is the rate limit plus the margin and the
+ * jitter, so uploads on consecutive slots always respect it. Readings still come once a
+ * minute, a little faster than the slots; while a backlog is waiting in the reading
+ * store, the next upload goes out as soon as the rate limit allows instead, and the store
+ * holds whatever the slots fall behind. Failed uploads back off exponentially with jitter
+ * and realign to the slots after the next success.
+ *
+ *****************************************************************************************/
+
+#ifndef UPLOAD_SCHEDULE_H
+#define UPLOAD_SCHEDULE_H
+
+#include <Arduino.h>
+
+/*****************************************************************************************
+* Configuration
+*****************************************************************************************/
+#ifndef UPLOAD_RATE_LIMIT_MS
+#define UPLOAD_RATE_LIMIT_MS 60000      // Program rate limit: one log_heartbeat per minute
+#endif
+#ifndef UPLOAD_RATE_MARGIN_MS
+#define UPLOAD_RATE_MARGIN_MS 2000      // Slack for confirmation time and clock differences
+#endif
+#ifndef UPLOAD_JITTER_MS
+#define UPLOAD_JITTER_MS 5000           // Random delay after the device's slot start
+#endif
+#define UPLOAD_SLOT_MS (UPLOAD_RATE_LIMIT_MS + UPLOAD_RATE_MARGIN_MS + UPLOAD_JITTER_MS)
+#ifndef UPLOAD_BACKOFF_MIN_MS
+#define UPLOAD_BACKOFF_MIN_MS 30000     // Wait after the first failed upload
+#endif
+#ifndef UPLOAD_BACKOFF_MAX_MS
+#define UPLOAD_BACKOFF_MAX_MS 600000    // Longest wait after repeated failures (10 minutes)
+#endif
+
+/*****************************************************************************************
+* Function Declarations
+*****************************************************************************************/
+void uploadScheduleBegin(const uint8_t* deviceKey);
+unsigned long uploadScheduleMsUntilDue();
+void uploadScheduleSent(bool success, bool backlog);
+uint32_t uploadScheduleFailures();
+
+#endif
@@ -0,0 +1,40 @@
+/*****************************************************************************************
+ * WiFi Manager
+ *
+ * Event-driven station connection. The access point's BSSID and channel and the DHCP
+ * lease (IP, gateway, subnet, DNS) of the last good connection are cached in RTC memory
+ * and NVS; reconnects after a drop, a reset or a radio-off period associate directly to
+ * that BSSID on that channel with the cached static IP, skipping the channel scan and
+ * DHCP. If that fails a few times the cache is dropped and a full scan with DHCP is used.
+ *
+ * Link state is published through an event group, so the network task can postpone
+ * uploads while the link is down instead of attempting and failing them.
+ *
+ *****************************************************************************************/
+
+#ifndef WIFI_MANAGER_H
+#define WIFI_MANAGER_H
+
+#include <Arduino.h>
+
+/*****************************************************************************************
+* Configuration
+*****************************************************************************************/
+#ifndef WIFI_CACHE_STATIC_IP
+#define WIFI_CACHE_STATIC_IP 1          // Reuse the last DHCP lease as static IP on fast connects
+#endif
+#define WIFI_FAST_CONNECT_ATTEMPTS 2    // Cached BSSID attempts before a full scan
+#define WIFI_RECONNECT_MIN_MS 500       // First reconnect delay after a drop
+#define WIFI_RECONNECT_MAX_MS 30000     // Reconnect backoff limit
+
+/*****************************************************************************************
+* Function Declarations
+*****************************************************************************************/
+bool wifiBegin(const char* ssid, const char* password);
+bool wifiWaitForLink(unsigned long timeoutMs);
+bool wifiLinkUp();
+void wifiSuspend();
+void wifiResume();
+uint32_t wifiDisconnects();
+
+#endif
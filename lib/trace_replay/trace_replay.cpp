@@ -0,0 +1,274 @@
+/*****************************************************************************************
+ * Trace Replay
+ *
+ * Capture dumps are scanned byte by byte: a serial dump interleaves the text log with the
+ * binary records, so anything that is not a well-formed record (USB) or frame (UDP) is
+ * skipped. Only the raw samples are kept; the filtered half of a frame is what the device
+ * computed and is recomputed by the replay.
+ *
+ * Text recordings hold one raw ADC value per line at SAMPLE_RATE_HZ, as printed by a
+ * serial logger; lines that do not start with a value (headers, log output) are skipped.
+ *
+ * The synthesized pulse uses its own xorshift generator and Box-Muller transform, so a
+ * seed gives the same trace with every compiler and standard library.
+ *
+ *****************************************************************************************/
+
+#include "trace_replay.h"
+#include <ctype.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "capture_format.h"
+#include "signal_filter.h"
+#include "heart_rate_detector.h"
+#include "signal_quality.h"
+#include "heart_rate_window.h"
+
+#define TRACE_LINE_SIZE 128
+#define TRACE_FRAME_HEADER_SIZE sizeof(CaptureHeader)
+#define TRACE_SAMPLE_BYTES (sizeof(uint16_t) + sizeof(int32_t))
+
+static size_t frameLength(const uint8_t* data, size_t available);
+static void takeFrame(const uint8_t* frame, RecordedTrace* trace, uint32_t* nextSequence, uint32_t* nextIndex);
+static float gaussian(uint32_t* state);
+
+/*****************************************************************************************
+* Function: Trace Load Capture
+*
+* Description: Reads the raw samples of a capture dump, either the serial output of a USB
+*              capture (text and binary records) or concatenated UDP datagrams
+* Parameters: path - dump file
+*             trace - samples and capacity set by the caller, filled with the trace
+* Returns: bool - True if the file was read and held at least one frame, false otherwise
+*****************************************************************************************/
+bool traceLoadCapture(const char* path, RecordedTrace* trace) {
+  trace->count = 0;
+  trace->frames = 0;
+  trace->gaps = 0;
+
+  FILE* file = fopen(path, "rb");
+  if (file == NULL) {
+    return false;
+  }
+  fseek(file, 0, SEEK_END);
+  long size = ftell(file);
+  fseek(file, 0, SEEK_SET);
+  uint8_t* data = size > 0 ? (uint8_t*)malloc(size) : NULL;
+  bool read = data != NULL && fread(data, 1, size, file) == (size_t)size;
+  fclose(file);
+  if (!read) {
+    free(data);
+    return false;
+  }
+
+  uint32_t nextSequence = 0;
+  uint32_t nextIndex = 0;
+  size_t p = 0;
+  while (p < (size_t)size) {
+    size_t available = size - p;
+    // USB: logger record around the frame
+    if (data[p] == CAPTURE_RECORD_SYNC && available >= 4 && data[p + 1] == CAPTURE_TAG) {
+      size_t recordLength = data[p + 2] | (data[p + 3] << 8);
+      if (recordLength <= available - 4 && frameLength(data + p + 4, recordLength) == recordLength) {
+        takeFrame(data + p + 4, trace, &nextSequence, &nextIndex);
+        p += 4 + recordLength;
+        continue;
+      }
+    }
+    // UDP: bare frame
+    size_t length = frameLength(data + p, available);
+    if (length > 0) {
+      takeFrame(data + p, trace, &nextSequence, &nextIndex);
+      p += length;
+      continue;
+    }
+    p++;
+  }
+  free(data);
+  return trace->frames > 0;
+}
+
+/*****************************************************************************************
+* Function: Trace Load Text
+*
+* Description: Reads the raw samples of a text recording
+* Parameters: path - recording, one ADC value per line
+*             trace - samples and capacity set by the caller, filled with the trace
+* Returns: bool - True if the file was read and held at least one sample, false otherwise
+*****************************************************************************************/
+bool traceLoadText(const char* path, RecordedTrace* trace) {
+  trace->count = 0;
+  trace->frames = 0;
+  trace->gaps = 0;
+  FILE* file = fopen(path, "r");
+  if (file == NULL) {
+    return false;
+  }
+
+  char line[TRACE_LINE_SIZE];
+  while (fgets(line, sizeof(line), file) != NULL && trace->count < trace->capacity) {
+    const char* p = line;
+    while (*p == ' ' || *p == '\t') {
+      p++;
+    }
+    if (!isdigit((unsigned char)*p)) {
+      continue;
+    }
+    unsigned long value = strtoul(p, NULL, 10);
+    if (value <= TRACE_ADC_MAX) {
+      trace->samples[trace->count++] = (uint16_t)value;
+    }
+  }
+  fclose(file);
+  return trace->count > 0;
+}
+
+/*****************************************************************************************
+* Function: Trace Synthesize
+*
+* Description: Generates a KY-039-like trace: systolic peak and dicrotic wave per beat on
+*              a mid-scale DC level, with mains interference, baseline wander and noise
+* Parameters: pulse - waveform parameters
+*             samples - destination (SAMPLE_RATE_HZ samples per second)
+*             count - number of samples
+* Returns: uint32_t - number of beats (systolic peaks) in the trace
+*****************************************************************************************/
+uint32_t traceSynthesize(const TracePulse& pulse, uint16_t* samples, size_t count) {
+  uint32_t state = pulse.seed != 0 ? pulse.seed : 1;
+  double beatsPerSample = pulse.bpm / 60.0 / SAMPLE_RATE_HZ;
+  for (size_t i = 0; i < count; i++) {
+    double t = (double)i / SAMPLE_RATE_HZ;
+    double phase = fmod(i * beatsPerSample, 1.0);
+    double systolic = (phase - 0.3) / 0.08;
+    double dicrotic = (phase - 0.6) / 0.06;
+    double value = 2000 + pulse.amplitude * (exp(-systolic * systolic) + pulse.notch * exp(-dicrotic * dicrotic)) +
+                   pulse.mains * sin(2 * M_PI * 50 * t) + pulse.wander * sin(2 * M_PI * 0.1 * t) +
+                   pulse.noise * gaussian(&state);
+    samples[i] = (uint16_t)(value < 0 ? 0 : (value > TRACE_ADC_MAX ? TRACE_ADC_MAX : value + 0.5));
+  }
+  // Peaks sit at phase 0.3 of each beat
+  double beats = count * beatsPerSample;
+  return (uint32_t)(beats > 0.3 ? floor(beats - 0.3) + 1 : 0);
+}
+
+/*****************************************************************************************
+* Function: Trace Replay
+*
+* Description: Runs a trace through the signal pipeline from a reset state and collects a
+*              reading at the end of every TRACE_READING_SAMPLES window
+* Parameters: samples - raw samples of HEART_RATE_CHANNEL
+*             count - number of samples
+*             result - set to the totals of the trace
+*             readings - destination for the window readings (may be NULL)
+*             maxReadings - capacity of readings
+* Returns: None
+*****************************************************************************************/
+void traceReplay(const uint16_t* samples, size_t count, TraceResult* result,
+                 HeartRateReading* readings, size_t maxReadings) {
+  filterReset();
+  detectorReset();
+  qualityReset();
+  windowReset();
+  result->beats = 0;
+  result->readingCount = 0;
+
+  int32_t filtered[TRACE_BLOCK_SAMPLES];
+  uint32_t windowCount = 0;
+  for (size_t start = 0; start < count; start += TRACE_BLOCK_SAMPLES) {
+    size_t blockCount = count - start < TRACE_BLOCK_SAMPLES ? count - start : TRACE_BLOCK_SAMPLES;
+    filterProcessBlock(HEART_RATE_CHANNEL, samples + start, blockCount, filtered);
+    qualityAddSamples(samples + start, blockCount);
+    for (size_t i = 0; i < blockCount; i++) {
+      if (++windowCount == HEART_RATE_WINDOW_SAMPLES) {
+        windowCount = 0;
+        if (detectorUpdate(HEART_RATE_CHANNEL, filtered[i], start + i)) {
+          windowAddBeat(detectorLastInterval(HEART_RATE_CHANNEL));
+          result->beats++;
+        }
+      }
+    }
+
+    // The loop closes a window on the first pass after HEART_RATE_SEND_TIME_MS
+    size_t end = start + blockCount;
+    if (end / TRACE_READING_SAMPLES > start / TRACE_READING_SAMPLES) {
+      if (readings != NULL && result->readingCount < maxReadings) {
+        HeartRateReading& reading = readings[result->readingCount];
+        reading.heartRate = windowMeanHeartRate();
+        reading.timestampMs = (unsigned long)((uint64_t)end * 1000 / SAMPLE_RATE_HZ);
+        windowSummarize(qualityScore(), &reading.summary);
+      }
+      result->readingCount++;
+      qualityReset();
+      windowReset();
+    }
+  }
+  result->heartRate = detectorHeartRate(HEART_RATE_CHANNEL);
+}
+
+/*****************************************************************************************
+* Function: Frame Length
+*
+* Description: Length of a well-formed capture frame at the start of a buffer
+* Parameters: data - candidate frame
+*             available - bytes available at data
+* Returns: size_t - frame length, 0 if data does not start with a valid frame
+*****************************************************************************************/
+static size_t frameLength(const uint8_t* data, size_t available) {
+  if (available < TRACE_FRAME_HEADER_SIZE) {
+    return 0;
+  }
+  CaptureHeader header;
+  memcpy(&header, data, sizeof(header));
+  size_t length = TRACE_FRAME_HEADER_SIZE + header.count * TRACE_SAMPLE_BYTES;
+  if (header.version != CAPTURE_VERSION || header.count == 0 || header.count > CAPTURE_MAX_SAMPLES ||
+      length > available) {
+    return 0;
+  }
+  return length;
+}
+
+/*****************************************************************************************
+* Function: Take Frame
+*
+* Description: Appends the raw samples of a frame to the trace and counts discontinuities
+* Parameters: frame - valid capture frame
+*             trace - trace being loaded
+*             nextSequence - expected sequence number, advanced
+*             nextIndex - expected sampler index, advanced
+* Returns: None
+*****************************************************************************************/
+static void takeFrame(const uint8_t* frame, RecordedTrace* trace, uint32_t* nextSequence, uint32_t* nextIndex) {
+  CaptureHeader header;
+  memcpy(&header, frame, sizeof(header));
+  if (trace->frames > 0 && (header.sequence != *nextSequence || header.firstIndex != *nextIndex)) {
+    trace->gaps++;
+  }
+  *nextSequence = header.sequence + 1;
+  *nextIndex = header.firstIndex + header.count;
+  trace->frames++;
+
+  const uint8_t* raw = frame + TRACE_FRAME_HEADER_SIZE;
+  for (size_t i = 0; i < header.count && trace->count < trace->capacity; i++) {
+    trace->samples[trace->count++] = raw[2 * i] | (raw[2 * i + 1] << 8);
+  }
+}
+
+/*****************************************************************************************
+* Function: Gaussian
+*
+* Description: Standard normal value (Box-Muller on an xorshift32 generator)
+* Parameters: state - generator state, advanced
+* Returns: float - random value with mean 0 and standard deviation 1
+*****************************************************************************************/
+static float gaussian(uint32_t* state) {
+  double uniform[2];
+  for (int i = 0; i < 2; i++) {
+    *state ^= *state << 13;
+    *state ^= *state >> 17;
+    *state ^= *state << 5;
+    uniform[i] = (*state + 1.0) / 4294967297.0;     // (0, 1)
+  }
+  return (float)(sqrt(-2 * log(uniform[0])) * cos(2 * M_PI * uniform[1]));
+}
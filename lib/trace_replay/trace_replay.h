@@ -0,0 +1,63 @@
+/*****************************************************************************************
+ * Trace Replay
+ *
+ * Host-side harness that runs raw sensor traces through the firmware's signal pipeline
+ * (band-pass filter, peak detection, signal quality and upload window) exactly as
+ * readHeartRate() and the loop feed it on the device, one TRACE_BLOCK_SAMPLES block at a
+ * time. Traces are loaded from raw capture dumps (USB serial output or UDP datagrams, see
+ * capture_format.h) or text recordings of raw ADC values, or synthesized as KY-039-like
+ * pulse waves with a known beat count.
+ *
+ * Used by the native tests and benchmarks (pio test -e native); not part of the firmware.
+ *
+ *****************************************************************************************/
+
+#ifndef TRACE_REPLAY_H
+#define TRACE_REPLAY_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "sampler_config.h"
+#include "heart_rate_reading.h"
+
+/*****************************************************************************************
+* Configuration
+*****************************************************************************************/
+#define TRACE_BLOCK_SAMPLES 64          // Samples per loop read (HEART_RATE_BLOCK_SAMPLES)
+#define TRACE_READING_SAMPLES (SAMPLE_RATE_HZ * 60)  // One reading window (HEART_RATE_SEND_TIME_MS)
+#define TRACE_ADC_MAX 4095
+
+struct RecordedTrace {
+  uint16_t* samples;                    // Caller's buffer for the raw samples
+  size_t capacity;                      // Size of the buffer in samples
+  size_t count;                         // Samples loaded
+  uint32_t frames;                      // Capture frames decoded
+  uint32_t gaps;                        // Sequence or sample index jumps (dropped frames)
+};
+
+struct TracePulse {
+  float bpm;                            // Heart rate of the synthesized pulse
+  float amplitude;                      // Systolic peak height (ADC counts)
+  float notch;                          // Dicrotic wave height relative to the peak
+  float noise;                          // Standard deviation of white noise (ADC counts)
+  float mains;                          // 50Hz interference amplitude (ADC counts)
+  float wander;                         // 0.1Hz baseline wander amplitude (ADC counts)
+  uint32_t seed;                        // Noise generator seed (traces are reproducible)
+};
+
+struct TraceResult {
+  uint32_t beats;                       // Accepted beats of the whole trace
+  float heartRate;                      // Detector output at the end of the trace
+  size_t readingCount;                  // Complete reading windows
+};
+
+/*****************************************************************************************
+* Function Declarations
+*****************************************************************************************/
+bool traceLoadCapture(const char* path, RecordedTrace* trace);
+bool traceLoadText(const char* path, RecordedTrace* trace);
+uint32_t traceSynthesize(const TracePulse& pulse, uint16_t* samples, size_t count);
+void traceReplay(const uint16_t* samples, size_t count, TraceResult* result,
+                 HeartRateReading* readings, size_t maxReadings);
+
+#endif
@@ -0,0 +1,151 @@
+/*****************************************************************************************
+ * Blockhash Cache
+ *
+ * All functions are meant to be called from the network task, which owns the RPC
+ * connection, so the cache needs no locking.
+ *
+ *****************************************************************************************/
+
+#include "blockhash_cache.h"
+#include "rpc_client.h"
+#include "tx_template.h"
+#include "instrumentation.h"
+
+/*****************************************************************************************
+* Global Variables
+*****************************************************************************************/
+static uint8_t cachedBlockhash[SOLANA_PUBKEY_SIZE];
+static bool cacheValid = false;
+static unsigned long fetchTime = 0;
+static unsigned long lastAttemptTime = 0;
+static bool refreshFailed = false;
+static uint32_t cacheHits = 0;
+static uint32_t cacheMisses = 0;
+
+/*****************************************************************************************
+* Function: Blockhash Cache Begin
+*
+* Description: Clears the cache
+* Parameters: None
+* Returns: None
+*****************************************************************************************/
+void blockhashCacheBegin() {
+  cacheValid = false;
+  fetchTime = 0;
+}
+
+/*****************************************************************************************
+* Function: Blockhash Cache Get
+*
+* Description: Copies the cached blockhash if it is younger than BLOCKHASH_MAX_AGE_MS (hit),
+*              otherwise fetches a new one first (miss)
+* Parameters: blockhash - 32-byte destination for the decoded blockhash
+* Returns: bool - True if a blockhash was copied, false if none could be fetched
+*****************************************************************************************/
+bool blockhashCacheGet(uint8_t* blockhash) {
+  if (cacheValid && millis() - fetchTime < BLOCKHASH_MAX_AGE_MS) {
+    cacheHits++;
+  } else {
+    cacheMisses++;
+    if (!blockhashCacheRefresh()) {
+      return false;
+    }
+  }
+  memcpy(blockhash, cachedBlockhash, SOLANA_PUBKEY_SIZE);
+  return true;
+}
+
+/*****************************************************************************************
+* Function: Blockhash Cache Refresh
+*
+* Description: Fetches the latest blockhash from the RPC and stores it in the cache
+* Parameters: None
+* Returns: bool - True if a new blockhash was fetched, false otherwise (cache is cleared)
+*****************************************************************************************/
+bool blockhashCacheRefresh() {
+  char blockhash[BLOCKHASH_BASE58_SIZE];
+  uint32_t fetchStart = instrumentStart();
+  refreshFailed = !rpcGetLatestBlockhash(blockhash, sizeof(blockhash)) ||
+                  !base58DecodeFixed(blockhash, cachedBlockhash, SOLANA_PUBKEY_SIZE);
+  instrumentStop(STAGE_BLOCKHASH_FETCH, fetchStart);
+  lastAttemptTime = millis();
+  cacheValid = !refreshFailed;
+  if (!cacheValid) {
+    return false;
+  }
+  fetchTime = lastAttemptTime;
+  return true;
+}
+
+/*****************************************************************************************
+* Function: Blockhash Cache Service
+*
+* Description: Refreshes the cache if BLOCKHASH_REFRESH_MS has elapsed since the last fetch.
+*              Called by the network task whenever it is idle
+* Parameters: None
+* Returns: None
+*****************************************************************************************/
+void blockhashCacheService() {
+  if (blockhashCacheMsUntilRefresh() == 0) {
+    blockhashCacheRefresh();
+  }
+}
+
+/*****************************************************************************************
+* Function: Blockhash Cache Invalidate
+*
+* Description: Drops the cached blockhash, e.g. after a transaction using it was rejected
+* Parameters: None
+* Returns: None
+*****************************************************************************************/
+void blockhashCacheInvalidate() {
+  cacheValid = false;
+}
+
+/*****************************************************************************************
+* Function: Blockhash Cache Time Until Refresh
+*
+* Description: Time left until the cached blockhash should be refreshed
+* Parameters: None
+* Returns: unsigned long - ms until refresh, 0 if a refresh is due now
+*****************************************************************************************/
+unsigned long blockhashCacheMsUntilRefresh() {
+  unsigned long elapsed;
+  unsigned long interval;
+  if (refreshFailed) {
+    elapsed = millis() - lastAttemptTime;
+    interval = BLOCKHASH_RETRY_MS;
+  } else if (!cacheValid) {
+    return 0;
+  } else {
+    elapsed = millis() - fetchTime;
+    interval = BLOCKHASH_REFRESH_MS;
+  }
+  return (elapsed >= interval) ? 0 : interval - elapsed;
+}
+
+/*****************************************************************************************
+* Function: Blockhash Cache Age
+*
+* Description: Age of the cached blockhash
+* Parameters: None
+* Returns: unsigned long - ms since the cached hash was fetched
+*****************************************************************************************/
+unsigned long blockhashCacheAgeMs() {
+  return millis() - fetchTime;
+}
+
+/*****************************************************************************************
+* Function: Blockhash Cache Hits / Misses
+*
+* Description: Number of blockhashCacheGet() calls served from cache / that had to fetch
+* Parameters: None
+* Returns: uint32_t - counter value
+*****************************************************************************************/
+uint32_t blockhashCacheHits() {
+  return cacheHits;
+}
+
+uint32_t blockhashCacheMisses() {
+  return cacheMisses;
+}
@@ -0,0 +1,163 @@
+/*****************************************************************************************
+ * Capture
+ *
+ * USB: frames go straight into the logger ring as one binary record, which is a bounded
+ * copy that never waits; the logger task drains it to Serial.
+ *
+ * UDP: frames are queued by value for the capture task, which sends one datagram per
+ * frame. The task is created on the first captureStart() and idles on the queue. The
+ * capture holds the radio up (powerRadioHold()) while it is active, so datagrams are not
+ * lost to the duty cycling between uploads; only those of a reconnect are.
+ *
+ * Frames are dropped (and counted) instead of blocking when a transport falls behind.
+ * Both the loop and the capture task count drops, so the counter is atomic.
+ *
+ *****************************************************************************************/
+
+#include "capture.h"
+#include "logger.h"
+#include "power.h"
+#include <atomic>
+#include <WiFi.h>
+#include <WiFiUdp.h>
+
+/*****************************************************************************************
+* Global Variables
+*****************************************************************************************/
+static_assert(CAPTURE_RECORD_SYNC == LOG_BINARY_SYNC, "Capture records use the logger framing");
+
+#define CAPTURE_FRAME_SIZE (sizeof(CaptureHeader) + CAPTURE_MAX_SAMPLES * (sizeof(uint16_t) + sizeof(int32_t)))
+
+struct CaptureFrame {
+  uint16_t length;
+  uint8_t data[CAPTURE_FRAME_SIZE];
+};
+
+static volatile bool active = false;
+static uint32_t sequence = 0;
+static std::atomic<uint32_t> droppedFrames(0);
+
+#if CAPTURE_TRANSPORT == CAPTURE_UDP
+static QueueHandle_t frameQueue = NULL;
+static TaskHandle_t captureTaskHandle = NULL;
+static WiFiUDP udp;
+
+static void captureTask(void* parameter);
+#endif
+
+/*****************************************************************************************
+* Function: Capture Start / Stop / Active
+*
+* Description: Starts streaming (sequence restarts at 0) / stops streaming / current state
+* Parameters: None
+* Returns: bool - True if streaming
+*****************************************************************************************/
+bool captureStart() {
+#if CAPTURE_TRANSPORT == CAPTURE_UDP
+  if (captureTaskHandle == NULL) {
+    frameQueue = xQueueCreate(CAPTURE_QUEUE_LENGTH, sizeof(CaptureFrame));
+    if (frameQueue == NULL ||
+        xTaskCreatePinnedToCore(captureTask, "capture", CAPTURE_TASK_STACK_SIZE, NULL,
+                                CAPTURE_TASK_PRIORITY, &captureTaskHandle, CAPTURE_TASK_CORE) != pdPASS) {
+      LOG_ERROR("❌ Failed to start capture task\n");
+      return false;
+    }
+  }
+  powerRadioHold(true);
+#endif
+  sequence = 0;
+  droppedFrames = 0;
+  active = true;
+  LOG_INFO("✅ Capture started\n");
+  return true;
+}
+
+void captureStop() {
+  active = false;
+#if CAPTURE_TRANSPORT == CAPTURE_UDP
+  powerRadioHold(false);
+#endif
+  LOG_INFO("Capture stopped after %u frames (%u dropped)\n", sequence, (unsigned)droppedFrames.load());
+}
+
+bool captureActive() {
+  return active;
+}
+
+/*****************************************************************************************
+* Function: Capture Block
+*
+* Description: Frames a block of raw and filtered samples and hands it to the transport
+* Parameters: raw - raw ADC samples
+*             filtered - band-passed samples (Q-format, FILTER_Q_BITS)
+*             count - number of samples (at most CAPTURE_MAX_SAMPLES)
+*             firstIndex - sampler index of the first sample
+* Returns: None
+*****************************************************************************************/
+void captureBlock(const uint16_t* raw, const int32_t* filtered, size_t count, uint32_t firstIndex) {
+  if (!active || count == 0) {
+    return;
+  }
+  if (count > CAPTURE_MAX_SAMPLES) {
+    count = CAPTURE_MAX_SAMPLES;
+  }
+
+  // Built in place from the loop's block; the transport copies it once more (into the
+  // logger ring, or by value into the UDP queue) so the next block can reuse it
+  static CaptureFrame frame;
+  CaptureHeader header = { CAPTURE_VERSION, 0, (uint16_t)count, sequence++, firstIndex };
+  memcpy(frame.data, &header, sizeof(header));
+  memcpy(frame.data + sizeof(header), raw, count * sizeof(uint16_t));
+  memcpy(frame.data + sizeof(header) + count * sizeof(uint16_t), filtered, count * sizeof(int32_t));
+  frame.length = sizeof(header) + count * (sizeof(uint16_t) + sizeof(int32_t));
+
+#if CAPTURE_TRANSPORT == CAPTURE_UDP
+  if (xQueueSend(frameQueue, &frame, 0) != pdTRUE) {
+    droppedFrames++;
+  }
+#else
+  if (!logBinary(CAPTURE_TAG, frame.data, frame.length)) {
+    droppedFrames++;
+  }
+#endif
+}
+
+/*****************************************************************************************
+* Function: Capture Dropped
+*
+* Description: Frames dropped since the capture started
+* Parameters: None
+* Returns: uint32_t - frame count
+*****************************************************************************************/
+uint32_t captureDropped() {
+  return droppedFrames.load();
+}
+
+#if CAPTURE_TRANSPORT == CAPTURE_UDP
+/*****************************************************************************************
+* Function: Capture Task
+*
+* Description: Sends queued frames as UDP datagrams while WiFi is connected (the radio is
+*              held up, so only frames of a reconnect are dropped)
+* Parameters: parameter - unused
+* Returns: None
+*****************************************************************************************/
+static void captureTask(void* parameter) {
+  static CaptureFrame frame;
+
+  for (;;) {
+    if (xQueueReceive(frameQueue, &frame, portMAX_DELAY) != pdTRUE) {
+      continue;
+    }
+    if (WiFi.status() != WL_CONNECTED) {
+      droppedFrames++;
+      continue;
+    }
+    udp.beginPacket(CAPTURE_UDP_HOST, CAPTURE_UDP_PORT);
+    udp.write(frame.data, frame.length);
+    if (!udp.endPacket()) {
+      droppedFrames++;
+    }
+  }
+}
+#endif
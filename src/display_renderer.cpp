@@ -0,0 +1,185 @@
+/*****************************************************************************************
+ * Display Renderer
+ *
+ * Two frames are kept besides the Adafruit draw buffer: pendingFrame, the latest committed
+ * frame, and shownFrame, the panel contents. The display task works page by page (8 rows
+ * of 128 column bytes): under the mutex it finds the first and last column that differ,
+ * copies them out and marks them shown, then sends them outside the lock through the
+ * SSD1306 column/page address window. A commit therefore only costs a 1KB memcpy, and a
+ * blinking glyph costs a few bytes on the bus instead of the whole framebuffer.
+ *
+ * If a transfer fails, the whole panel is marked unknown and the next frame is sent in full.
+ *
+ *****************************************************************************************/
+
+#include "display_renderer.h"
+#include <Wire.h>
+#include "logger.h"
+#include "instrumentation.h"
+
+/*****************************************************************************************
+* Global Variables
+*****************************************************************************************/
+#define DISPLAY_PAGES (64 / 8)
+#define DISPLAY_COLUMNS 128
+#define DISPLAY_FRAME_SIZE (DISPLAY_PAGES * DISPLAY_COLUMNS)
+#define SSD1306_CONTROL_COMMAND 0x00
+#define SSD1306_CONTROL_DATA 0x40
+
+static Adafruit_SSD1306* canvas = NULL;
+static uint8_t panelAddress = 0;
+static uint8_t pendingFrame[DISPLAY_FRAME_SIZE];
+static uint8_t shownFrame[DISPLAY_FRAME_SIZE];
+static bool shownValid = false;          // False until the panel is known to match shownFrame
+static uint32_t bytesSent = 0;
+static SemaphoreHandle_t frameMutex = NULL;
+static TaskHandle_t displayTaskHandle = NULL;
+
+static void displayTask(void* parameter);
+static bool sendWindow(uint8_t page, uint8_t firstColumn, const uint8_t* data, size_t length);
+
+/*****************************************************************************************
+* Function: Renderer Begin
+*
+* Description: Switches I2C to DISPLAY_I2C_CLOCK_HZ and starts the display task. Call after
+*              display.begin()
+* Parameters: display - initialized SSD1306 whose buffer is drawn into
+*             address - I2C address of the panel
+* Returns: bool - True if the task was started, false otherwise
+*****************************************************************************************/
+bool rendererBegin(Adafruit_SSD1306* display, uint8_t address) {
+  canvas = display;
+  panelAddress = address;
+  Wire.setClock(DISPLAY_I2C_CLOCK_HZ);
+
+  frameMutex = xSemaphoreCreateMutex();
+  if (frameMutex == NULL) {
+    LOG_ERROR("❌ Failed to create display mutex\n");
+    return false;
+  }
+  if (xTaskCreatePinnedToCore(displayTask, "display", DISPLAY_TASK_STACK_SIZE, NULL,
+                              DISPLAY_TASK_PRIORITY, &displayTaskHandle, DISPLAY_TASK_CORE) != pdPASS) {
+    LOG_ERROR("❌ Failed to start display task\n");
+    return false;
+  }
+  return true;
+}
+
+/*****************************************************************************************
+* Function: Renderer Commit
+*
+* Description: Hands the current draw buffer to the display task. Returns immediately
+* Parameters: None
+* Returns: None
+*****************************************************************************************/
+void rendererCommit() {
+  if (displayTaskHandle == NULL) {
+    return;
+  }
+  xSemaphoreTake(frameMutex, portMAX_DELAY);
+  memcpy(pendingFrame, canvas->getBuffer(), DISPLAY_FRAME_SIZE);
+  xSemaphoreGive(frameMutex);
+  xTaskNotifyGive(displayTaskHandle);
+}
+
+/*****************************************************************************************
+* Function: Renderer Bytes Sent
+*
+* Description: Framebuffer bytes sent to the panel since boot
+* Parameters: None
+* Returns: uint32_t - byte count
+*****************************************************************************************/
+uint32_t rendererBytesSent() {
+  return bytesSent;
+}
+
+/*****************************************************************************************
+* Function: Display Task
+*
+* Description: Sends the changed part of every committed frame to the panel
+* Parameters: parameter - unused
+* Returns: None
+*****************************************************************************************/
+static void displayTask(void* parameter) {
+  uint8_t window[DISPLAY_COLUMNS];
+
+  for (;;) {
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    uint32_t flushStart = instrumentStart();
+
+    for (uint8_t page = 0; page < DISPLAY_PAGES; page++) {
+      size_t pageOffset = page * DISPLAY_COLUMNS;
+      int first = -1;
+      int last = -1;
+
+      xSemaphoreTake(frameMutex, portMAX_DELAY);
+      if (!shownValid) {
+        first = 0;
+        last = DISPLAY_COLUMNS - 1;
+      } else {
+        for (int column = 0; column < DISPLAY_COLUMNS; column++) {
+          if (pendingFrame[pageOffset + column] != shownFrame[pageOffset + column]) {
+            if (first < 0) {
+              first = column;
+            }
+            last = column;
+          }
+        }
+      }
+      size_t length = (first < 0) ? 0 : last - first + 1;
+      if (length > 0) {
+        memcpy(window, pendingFrame + pageOffset + first, length);
+        memcpy(shownFrame + pageOffset + first, window, length);
+      }
+      xSemaphoreGive(frameMutex);
+
+      if (length > 0) {
+        if (!sendWindow(page, first, window, length)) {
+          shownValid = false;
+          break;
+        }
+        bytesSent += length;
+      }
+      // All pages are sent before the panel counts as known
+      if (page == DISPLAY_PAGES - 1) {
+        shownValid = true;
+      }
+    }
+    instrumentStop(STAGE_DISPLAY_FLUSH, flushStart);
+  }
+}
+
+/*****************************************************************************************
+* Function: Send Window
+*
+* Description: Sets the SSD1306 address window to one page and a column range, then writes
+*              the column bytes into it
+* Parameters: page - display page (8-pixel row)
+*             firstColumn - first column of the range
+*             data - column bytes
+*             length - number of columns
+* Returns: bool - True if every I2C transaction was acknowledged, false otherwise
+*****************************************************************************************/
+static bool sendWindow(uint8_t page, uint8_t firstColumn, const uint8_t* data, size_t length) {
+  const uint8_t commands[] = {
+    SSD1306_CONTROL_COMMAND,
+    SSD1306_PAGEADDR, page, page,
+    SSD1306_COLUMNADDR, firstColumn, (uint8_t)(firstColumn + length - 1),
+  };
+  Wire.beginTransmission(panelAddress);
+  Wire.write(commands, sizeof(commands));
+  if (Wire.endTransmission() != 0) {
+    return false;
+  }
+
+  for (size_t offset = 0; offset < length; offset += DISPLAY_I2C_CHUNK) {
+    size_t chunk = min((size_t)DISPLAY_I2C_CHUNK, length - offset);
+    Wire.beginTransmission(panelAddress);
+    Wire.write(SSD1306_CONTROL_DATA);
+    Wire.write(data + offset, chunk);
+    if (Wire.endTransmission() != 0) {
+      return false;
+    }
+  }
+  return true;
+}
@@ -0,0 +1,46 @@
+/*****************************************************************************************
+ * Heap Monitor
+ *
+ * allocated_blocks from heap_caps_get_info() is compared before and after a cycle; a non-zero
+ * delta means that cycle left allocations behind. The minimum free size since boot is the
+ * heap high-water mark, the largest free block shows how fragmented the heap has become.
+ *
+ *****************************************************************************************/
+
+#include "heap_monitor.h"
+#include "esp_heap_caps.h"
+#include "logger.h"
+
+/*****************************************************************************************
+* Function: Heap Snapshot
+*
+* Description: Captures free bytes and allocated block count of the 8-bit capable heap
+* Parameters: None
+* Returns: HeapSnapshot - current heap state
+*****************************************************************************************/
+HeapSnapshot heapSnapshot() {
+  multi_heap_info_t info;
+  heap_caps_get_info(&info, MALLOC_CAP_8BIT);
+  HeapSnapshot snapshot = { info.total_free_bytes, info.allocated_blocks };
+  return snapshot;
+}
+
+/*****************************************************************************************
+* Function: Print Heap Report
+*
+* Description: Prints the heap change since a snapshot, the high-water mark and the largest
+*              free block to the serial monitor
+* Parameters: label - name of the measured cycle
+*             before - snapshot taken at the start of the cycle
+* Returns: None
+*****************************************************************************************/
+void printHeapReport(const char* label, const HeapSnapshot& before) {
+  HeapSnapshot after = heapSnapshot();
+  LOG_DEBUG("Heap [%s]: %d blocks, %d bytes\n", label,
+            (int)after.allocatedBlocks - (int)before.allocatedBlocks,
+            (int)before.freeBytes - (int)after.freeBytes);
+  LOG_DEBUG("Heap free: %u, min: %u, largest: %u\n",
+                (unsigned)after.freeBytes,
+                (unsigned)heap_caps_get_minimum_free_size(MALLOC_CAP_8BIT),
+                (unsigned)heap_caps_get_largest_free_block(MALLOC_CAP_8BIT));
+}
@@ -0,0 +1,185 @@
+/*****************************************************************************************
+ * Heart Rate Detector
+ *
+ * Smoothing (MovingAverage) -> threshold crossing (AdaptiveThreshold) -> plausible
+ * interval (RangeGate, then the running average) -> weighted interval average
+ * (IntervalAverager) -> BPM, clamped to 30-200.
+ *
+ * A beat is the upstroke through HEART_RATE_TRIGGER_PERCENT of the tracked min/max
+ * envelope; the threshold re-arms below HEART_RATE_RELEASE_PERCENT. It scales with the
+ * pulse, so weak signals are not dropped, and the small second rise of the dicrotic
+ * notch stays inside the hysteresis instead of doubling beats. Once HEART_RATE_BEAT_COUNT
+ * beats are averaged, an interval much shorter than the average is taken as a doubled
+ * beat and ignored, a much longer one as a missed beat (restarts the interval without
+ * entering the average); HEART_RATE_OUTLIER_LIMIT outliers in a row accept the new rhythm.
+ * Every candidate of HEART_RATE_CHANNEL is reported to the signal quality index.
+ *
+ * Each sampler channel has its own DetectorChannel, the fields used on every window first,
+ * so the per-window update of a channel touches one contiguous block. The state is an
+ * array of structures, unlike the sampler rings and filter state, which are structures of
+ * arrays: those stream many samples of one channel through the same arithmetic, while the
+ * detector takes one value per channel every HEART_RATE_WINDOW_MS through branches
+ * (threshold crossing, interval gates) that differ per channel and do not vectorize, and
+ * the stage templates keep their own state. Splitting that state into per-field arrays
+ * would spread one update over SAMPLER_CHANNELS-strided cache lines and gain nothing.
+ *
+ *****************************************************************************************/
+
+#include "heart_rate_detector.h"
+#include "filter_stages.h"
+#include "signal_quality.h"
+
+/*****************************************************************************************
+* Global Variables
+*****************************************************************************************/
+typedef AdaptiveThreshold<HEART_RATE_ENVELOPE_SHIFT, HEART_RATE_TRIGGER_PERCENT,
+                          HEART_RATE_RELEASE_PERCENT> BeatThreshold;
+typedef RangeGate<HEART_RATE_MIN_BEAT_MS, HEART_RATE_MAX_BEAT_MS> BeatIntervalGate;
+
+struct DetectorChannel {
+  MovingAverage<HEART_RATE_SAMPLE_SIZE> heartRateAverage;
+  BeatThreshold peakDetector;
+  uint32_t lastBeatTime = 0;
+  bool beatSeen = false;
+  uint32_t averageInterval = 1000;
+  uint32_t outlierCount = 0;
+  uint32_t beatCount = 0;
+  IntervalAverager<HEART_RATE_BEAT_COUNT, HEART_RATE_BEAT_WEIGHTS> beatAverager{1000};  // Start at 60 BPM
+  uint32_t lastInterval = 0;
+  float heartRate = 0;
+};
+
+static_assert(HEART_RATE_CHANNEL < SAMPLER_CHANNELS, "HEART_RATE_CHANNEL must be a sampler channel");
+static DetectorChannel channels[SAMPLER_CHANNELS];
+
+static void reportCandidate(uint32_t channel, bool accepted, uint32_t intervalMs, int32_t amplitude);
+
+/*****************************************************************************************
+* Function: Detector Reset
+*
+* Description: Restarts detection on every channel: BPM back to 0, beat history back to
+*              60 BPM
+* Parameters: None
+* Returns: None
+*****************************************************************************************/
+void detectorReset() {
+  for (uint32_t c = 0; c < SAMPLER_CHANNELS; c++) {
+    channels[c] = DetectorChannel();
+  }
+}
+
+/*****************************************************************************************
+* Function: Detector Gap
+*
+* Description: Forgets the last beat of every channel after samples were lost, so the next
+*              beat starts a new interval instead of measuring one across the gap. The
+*              beat history and BPM are kept
+* Parameters: None
+* Returns: None
+*****************************************************************************************/
+void detectorGap() {
+  for (uint32_t c = 0; c < SAMPLER_CHANNELS; c++) {
+    channels[c].beatSeen = false;
+    channels[c].lastInterval = 0;
+  }
+}
+
+/*****************************************************************************************
+* Function: Detector Update
+*
+* Description: Detects heartbeats using peak detection and calculates BPM from beat intervals
+* Parameters: channel - sampler channel (below SAMPLER_CHANNELS)
+*             filtered - filtered sensor value of one window (Q-format, FILTER_Q_BITS)
+*             sampleIndex - sampler index of the value, used as its timestamp
+* Returns: bool - True if a beat updated the heart rate, false otherwise
+*****************************************************************************************/
+bool detectorUpdate(uint32_t channel, int32_t filtered, uint32_t sampleIndex) {
+  if (channel >= SAMPLER_CHANNELS) {
+    return false;
+  }
+  DetectorChannel& state = channels[channel];
+
+  // Step 2: Update rolling average for smoothing
+  int32_t currentAverage = state.heartRateAverage.update(filtered);
+
+  // Step 3: Peak Detection (heartbeat detection) against the adaptive threshold
+  if (!state.peakDetector.update(currentAverage)) {
+    return false;
+  }
+  int32_t amplitude = state.peakDetector.range();
+  if (amplitude < HEART_RATE_MIN_AMPLITUDE) {
+    return false;                       // No pulse, only noise
+  }
+
+  uint32_t beatTime = (uint32_t)(((uint64_t)sampleIndex * 1000) / SAMPLE_RATE_HZ);
+  uint32_t beatInterval = beatTime - state.lastBeatTime;
+  bool updated = false;
+
+  // Only process if interval is realistic (30-200 BPM) and not first beat
+  if (state.beatSeen && BeatIntervalGate::accepts(beatInterval)) {
+    bool locked = state.beatCount >= HEART_RATE_BEAT_COUNT &&
+                  state.outlierCount < HEART_RATE_OUTLIER_LIMIT;
+    if (locked && beatInterval * 100 < state.averageInterval * HEART_RATE_EARLY_PERCENT) {
+      state.outlierCount++;             // Doubled beat: keep timing from the previous one
+      reportCandidate(channel, false, 0, amplitude);
+      return false;
+    }
+    if (locked && beatInterval * 100 > state.averageInterval * HEART_RATE_LATE_PERCENT) {
+      state.outlierCount++;             // Missed beat: restart the interval
+      reportCandidate(channel, false, 0, amplitude);
+      state.lastBeatTime = beatTime;
+      return false;
+    }
+    state.outlierCount = 0;
+
+    // Calculate BPM using weighted average of the last beats
+    state.lastInterval = beatInterval;
+    state.averageInterval = state.beatAverager.update(beatInterval);
+    float heartRate = 60000.0f / state.averageInterval;  // Convert ms to BPM
+
+    // Constrain to realistic range
+    state.heartRate = heartRate < 30 ? 30 : (heartRate > 200 ? 200 : heartRate);
+    state.beatCount++;
+    updated = true;
+  }
+  reportCandidate(channel, updated, beatInterval, amplitude);
+  state.lastBeatTime = beatTime;
+  state.beatSeen = true;
+  return updated;
+}
+
+/*****************************************************************************************
+* Function: Detector Heart Rate / Beat Count / Last Interval
+*
+* Description: Latest BPM (0 until the first accepted beat) / accepted beats since reset /
+*              interval of the latest accepted beat in ms (0 until then) of a channel
+* Parameters: channel - sampler channel (below SAMPLER_CHANNELS)
+* Returns: float / uint32_t / uint32_t
+*****************************************************************************************/
+float detectorHeartRate(uint32_t channel) {
+  return channel < SAMPLER_CHANNELS ? channels[channel].heartRate : 0;
+}
+
+uint32_t detectorBeatCount(uint32_t channel) {
+  return channel < SAMPLER_CHANNELS ? channels[channel].beatCount : 0;
+}
+
+uint32_t detectorLastInterval(uint32_t channel) {
+  return channel < SAMPLER_CHANNELS ? channels[channel].lastInterval : 0;
+}
+
+/*****************************************************************************************
+* Function: Report Candidate
+*
+* Description: Passes a beat candidate of HEART_RATE_CHANNEL on to the signal quality index
+* Parameters: channel - sampler channel of the candidate
+*             accepted - True if it updated the heart rate
+*             intervalMs - interval to the previous beat (accepted beats only)
+*             amplitude - pulse amplitude when it was detected
+* Returns: None
+*****************************************************************************************/
+static void reportCandidate(uint32_t channel, bool accepted, uint32_t intervalMs, int32_t amplitude) {
+  if (channel == HEART_RATE_CHANNEL) {
+    qualityAddBeat(accepted, intervalMs, amplitude);
+  }
+}
@@ -0,0 +1,136 @@
+/*****************************************************************************************
+ * Heart Rate Window
+ *
+ * Welford's update keeps the mean and the sum of squared deviations of the beat rate
+ * numerically stable in single precision (the ESP32-S3 FPU has no double). RMSSD needs only the
+ * previous interval and the sum of squared successive differences, kept as integers.
+ *
+ * Called from the loop only (detection runs there).
+ *
+ *****************************************************************************************/
+
+#include "heart_rate_window.h"
+#include <math.h>
+
+/*****************************************************************************************
+* Global Variables
+*****************************************************************************************/
+static uint32_t beatCount = 0;
+static float meanBpm = 0;
+static float squaredDeviationSum = 0;   // Welford's M2
+static float minBpm = 0;
+static float maxBpm = 0;
+static uint32_t previousInterval = 0;
+static uint32_t differenceCount = 0;
+static uint64_t squaredDifferenceSum = 0;
+static uint32_t highMs = 0;
+
+static uint16_t saturate16(float value);
+
+/*****************************************************************************************
+* Function: Window Reset
+*
+* Description: Starts a new window
+* Parameters: None
+* Returns: None
+*****************************************************************************************/
+void windowReset() {
+  beatCount = 0;
+  meanBpm = 0;
+  squaredDeviationSum = 0;
+  minBpm = 0;
+  maxBpm = 0;
+  previousInterval = 0;
+  differenceCount = 0;
+  squaredDifferenceSum = 0;
+  highMs = 0;
+}
+
+/*****************************************************************************************
+* Function: Window Add Beat
+*
+* Description: Adds an accepted beat to the window
+* Parameters: intervalMs - interval to the previous beat (non-zero)
+* Returns: None
+*****************************************************************************************/
+void windowAddBeat(uint32_t intervalMs) {
+  if (intervalMs == 0) {
+    return;
+  }
+  float bpm = 60000.0f / intervalMs;
+
+  // Welford: running mean and sum of squared deviations
+  beatCount++;
+  float delta = bpm - meanBpm;
+  meanBpm += delta / beatCount;
+  squaredDeviationSum += delta * (bpm - meanBpm);
+  minBpm = (beatCount == 1 || bpm < minBpm) ? bpm : minBpm;
+  maxBpm = (beatCount == 1 || bpm > maxBpm) ? bpm : maxBpm;
+
+  // RMSSD: successive interval differences
+  if (previousInterval > 0) {
+    int64_t difference = (int64_t)intervalMs - previousInterval;
+    squaredDifferenceSum += (uint64_t)(difference * difference);
+    differenceCount++;
+  }
+  previousInterval = intervalMs;
+
+  if (bpm > WINDOW_HIGH_HEART_RATE) {
+    highMs += intervalMs;
+  }
+}
+
+/*****************************************************************************************
+* Function: Window Gap
+*
+* Description: Marks lost samples: the next beat's interval does not follow the previous
+*              one, so it is not paired with it for RMSSD
+* Parameters: None
+* Returns: None
+*****************************************************************************************/
+void windowGap() {
+  previousInterval = 0;
+}
+
+/*****************************************************************************************
+* Function: Window Mean Heart Rate
+*
+* Description: Mean beat rate of the window
+* Parameters: None
+* Returns: float - mean BPM, 0 if no beat was added
+*****************************************************************************************/
+float windowMeanHeartRate() {
+  return meanBpm;
+}
+
+/*****************************************************************************************
+* Function: Window Summarize
+*
+* Description: Fills the fixed-size summary of the window
+* Parameters: quality - signal quality index of the window
+*             summary - destination
+* Returns: None
+*****************************************************************************************/
+void windowSummarize(uint8_t quality, HeartRateSummary* summary) {
+  float variance = beatCount > 1 ? squaredDeviationSum / (beatCount - 1) : 0;
+  float rmssd = differenceCount > 0 ? sqrtf((float)squaredDifferenceSum / differenceCount) : 0;
+
+  summary->beatCount = beatCount > UINT16_MAX ? UINT16_MAX : beatCount;
+  summary->stdDevCentiBpm = saturate16(sqrtf(variance) * 100);
+  summary->rmssdMs = saturate16(rmssd);
+  summary->highSeconds = saturate16(highMs / 1000.0f);
+  summary->minBpm = (uint8_t)(minBpm + 0.5f);   // Beat gate keeps rates within 30-200
+  summary->maxBpm = (uint8_t)(maxBpm + 0.5f);
+  summary->quality = quality;
+}
+
+/*****************************************************************************************
+* Function: Saturate 16
+*
+* Description: Rounds a non-negative value to uint16_t, clamped to its range
+* Parameters: value - value to convert
+* Returns: uint16_t - rounded value
+*****************************************************************************************/
+static uint16_t saturate16(float value) {
+  return value >= UINT16_MAX ? UINT16_MAX : (uint16_t)(value + 0.5f);
+}
@@ -0,0 +1,324 @@
+/*****************************************************************************************
+ * Heartbeat Codec
+ *
+ * Ages are taken in whole seconds of the millis() clock (now / 1000 - timestamp / 1000),
+ * so the difference between two entries does not depend on when they are encoded; only
+ * the first timed entry does. heartbeatCodecFit() therefore counts that one time code at
+ * its largest size, and a batch sized once still fits when it is encoded again for a
+ * resend. Multi-byte fields are little-endian, varints are LEB128.
+ *
+ *****************************************************************************************/
+
+#include "heartbeat_codec.h"
+
+#define VARINT_MAX_SIZE 5               // 32-bit value
+
+static size_t entrySize(const HeartRateReading& reading, uint8_t flags, size_t timeCodeSize);
+static uint32_t timeCode(const HeartRateReading& reading, unsigned long nowMs, bool* timed, uint32_t* referenceAge);
+static int32_t wholeRate(float heartRate);
+static uint32_t zigZag(int32_t value);
+static int32_t unZigZag(uint32_t value);
+static size_t varintSize(uint32_t value);
+static size_t writeVarint(uint8_t* output, uint32_t value);
+static bool readVarint(const uint8_t** input, const uint8_t* end, uint32_t* value);
+
+/*****************************************************************************************
+* Function: Heartbeat Codec Fit
+*
+* Description: Number of leading readings whose encoding fits a capacity, whenever it is
+*              encoded
+* Parameters: readings - heart rate readings, oldest first
+*             count - number of readings
+*             flags - HEARTBEAT_CODEC_FLAG_* options
+*             capacity - bytes available for the encoding
+* Returns: size_t - number of readings that fit
+*****************************************************************************************/
+size_t heartbeatCodecFit(const HeartRateReading* readings, size_t count, uint8_t flags, size_t capacity) {
+  size_t entriesSize = 0;
+  bool timed = false;
+  uint32_t referenceAge = 0;
+  for (size_t i = 0; i < count; i++) {
+    bool wasTimed = timed;
+    size_t codeSize = varintSize(timeCode(readings[i], 0, &timed, &referenceAge));
+    if (timed && !wasTimed) {
+      codeSize = VARINT_MAX_SIZE;       // Depends on the time of encoding
+    }
+    entriesSize += entrySize(readings[i], flags, codeSize);
+
+    size_t n = i + 1;
+    size_t bitmapSize = (flags & HEARTBEAT_CODEC_FLAG_QUALITY) ? (n + 7) / 8 : 0;
+    if (HEARTBEAT_CODEC_HEADER_SIZE + varintSize(n) + entriesSize + bitmapSize > capacity) {
+      return i;
+    }
+  }
+  return count;
+}
+
+/*****************************************************************************************
+* Function: Heartbeat Codec Encode
+*
+* Description: Encodes readings in the compact format
+* Parameters: readings - heart rate readings, oldest first
+*             count - number of readings
+*             nowMs - current millis(), ages are relative to it
+*             flags - HEARTBEAT_CODEC_FLAG_* options
+*             output - destination
+*             capacity - size of the destination
+* Returns: size_t - encoded length, 0 if it does not fit the capacity
+*****************************************************************************************/
+size_t heartbeatCodecEncode(const HeartRateReading* readings, size_t count, unsigned long nowMs, uint8_t flags,
+                            uint8_t* output, size_t capacity) {
+  // Size first, so nothing is written past the capacity
+  size_t length = HEARTBEAT_CODEC_HEADER_SIZE + varintSize(count);
+  bool timed = false;
+  uint32_t referenceAge = 0;
+  for (size_t i = 0; i < count; i++) {
+    length += entrySize(readings[i], flags, varintSize(timeCode(readings[i], nowMs, &timed, &referenceAge)));
+  }
+  size_t bitmapSize = (flags & HEARTBEAT_CODEC_FLAG_QUALITY) ? (count + 7) / 8 : 0;
+  length += bitmapSize;
+  if (length > capacity) {
+    return 0;
+  }
+
+  uint8_t* out = output;
+  *out++ = HEARTBEAT_CODEC_VERSION;
+  *out++ = flags;
+  out += writeVarint(out, count);
+  timed = false;
+  referenceAge = 0;
+  for (size_t i = 0; i < count; i++) {
+    const HeartRateReading& reading = readings[i];
+    if (flags & HEARTBEAT_CODEC_FLAG_FINE_RATE) {
+      float tenths = reading.heartRate * 10 + 0.5f;
+      uint16_t rate = tenths <= 0 ? 0 : (tenths >= UINT16_MAX ? UINT16_MAX : (uint16_t)tenths);
+      *out++ = rate & 0xFF;
+      *out++ = rate >> 8;
+    } else {
+      int32_t rate = wholeRate(reading.heartRate);
+      *out++ = rate > UINT8_MAX ? UINT8_MAX : (uint8_t)rate;
+    }
+    out += writeVarint(out, timeCode(reading, nowMs, &timed, &referenceAge));
+    if (flags & HEARTBEAT_CODEC_FLAG_SUMMARY) {
+      const HeartRateSummary& summary = reading.summary;
+      int32_t rate = wholeRate(reading.heartRate);
+      out += writeVarint(out, summary.beatCount);
+      out += writeVarint(out, summary.stdDevCentiBpm);
+      out += writeVarint(out, summary.rmssdMs);
+      out += writeVarint(out, summary.highSeconds);
+      out += writeVarint(out, zigZag(summary.minBpm - rate));
+      out += writeVarint(out, zigZag(summary.maxBpm - rate));
+    }
+  }
+  if (bitmapSize > 0) {
+    for (size_t i = 0; i < bitmapSize; i++) {
+      out[i] = 0;
+    }
+    for (size_t i = 0; i < count; i++) {
+      if (readings[i].summary.quality >= HEARTBEAT_CODEC_GOOD_QUALITY) {
+        out[i / 8] |= 1 << (i % 8);
+      }
+    }
+    out += bitmapSize;
+  }
+  return out - output;
+}
+
+/*****************************************************************************************
+* Function: Heartbeat Codec Decode
+*
+* Description: Decodes the compact format. Rates come back quantized, timestamps to the
+*              second, and the quality as HEARTBEAT_CODEC_GOOD_QUALITY or 0 (no quality
+*              bitmap: 0). Summaries are zero without FLAG_SUMMARY
+* Parameters: input - encoded payload
+*             length - payload length
+*             nowMs - millis() the ages are relative to
+*             readings - destination
+*             maxReadings - capacity of the destination
+*             count - set to the number of readings
+*             flags - set to the flags of the payload
+* Returns: bool - True if decoded, false if malformed, of another version or too many
+*****************************************************************************************/
+bool heartbeatCodecDecode(const uint8_t* input, size_t length, unsigned long nowMs,
+                          HeartRateReading* readings, size_t maxReadings, size_t* count, uint8_t* flags) {
+  const uint8_t* p = input;
+  const uint8_t* end = input + length;
+  uint32_t entries;
+  if (length < HEARTBEAT_CODEC_HEADER_SIZE || p[0] != HEARTBEAT_CODEC_VERSION) {
+    return false;
+  }
+  uint8_t options = p[1];
+  p += HEARTBEAT_CODEC_HEADER_SIZE;
+  if (!readVarint(&p, end, &entries) || entries > maxReadings) {
+    return false;
+  }
+
+  uint32_t referenceAge = 0;
+  for (uint32_t i = 0; i < entries; i++) {
+    HeartRateReading& reading = readings[i];
+    reading.summary = HeartRateSummary();
+    if (options & HEARTBEAT_CODEC_FLAG_FINE_RATE) {
+      if (end - p < 2) {
+        return false;
+      }
+      reading.heartRate = (p[0] | (p[1] << 8)) / 10.0f;
+      p += 2;
+    } else {
+      if (end - p < 1) {
+        return false;
+      }
+      reading.heartRate = *p++;
+    }
+
+    uint32_t code;
+    if (!readVarint(&p, end, &code)) {
+      return false;
+    }
+    if (code == 0) {
+      reading.timestampMs = READING_TIMESTAMP_UNKNOWN;
+    } else {
+      referenceAge += unZigZag(code - 1);
+      reading.timestampMs = (uint32_t)(nowMs - referenceAge * 1000UL);
+    }
+
+    if (options & HEARTBEAT_CODEC_FLAG_SUMMARY) {
+      uint32_t fields[6];
+      for (int f = 0; f < 6; f++) {
+        if (!readVarint(&p, end, &fields[f])) {
+          return false;
+        }
+      }
+      int32_t rate = wholeRate(reading.heartRate);
+      reading.summary.beatCount = fields[0];
+      reading.summary.stdDevCentiBpm = fields[1];
+      reading.summary.rmssdMs = fields[2];
+      reading.summary.highSeconds = fields[3];
+      reading.summary.minBpm = rate + unZigZag(fields[4]);
+      reading.summary.maxBpm = rate + unZigZag(fields[5]);
+    }
+  }
+
+  if (options & HEARTBEAT_CODEC_FLAG_QUALITY) {
+    size_t bitmapSize = (entries + 7) / 8;
+    if ((size_t)(end - p) < bitmapSize) {
+      return false;
+    }
+    for (uint32_t i = 0; i < entries; i++) {
+      readings[i].summary.quality = (p[i / 8] & (1 << (i % 8))) ? HEARTBEAT_CODEC_GOOD_QUALITY : 0;
+    }
+    p += bitmapSize;
+  }
+  *count = entries;
+  *flags = options;
+  return p == end;
+}
+
+/*****************************************************************************************
+* Function: Entry Size
+*
+* Description: Encoded size of one entry
+* Parameters: reading - heart rate reading
+*             flags - HEARTBEAT_CODEC_FLAG_* options
+*             timeCodeSize - size of its time code
+* Returns: size_t - entry size in bytes
+*****************************************************************************************/
+static size_t entrySize(const HeartRateReading& reading, uint8_t flags, size_t timeCodeSize) {
+  size_t size = ((flags & HEARTBEAT_CODEC_FLAG_FINE_RATE) ? 2 : 1) + timeCodeSize;
+  if (flags & HEARTBEAT_CODEC_FLAG_SUMMARY) {
+    const HeartRateSummary& summary = reading.summary;
+    int32_t rate = wholeRate(reading.heartRate);
+    size += varintSize(summary.beatCount) + varintSize(summary.stdDevCentiBpm) +
+            varintSize(summary.rmssdMs) + varintSize(summary.highSeconds) +
+            varintSize(zigZag(summary.minBpm - rate)) + varintSize(zigZag(summary.maxBpm - rate));
+  }
+  return size;
+}
+
+/*****************************************************************************************
+* Function: Time Code
+*
+* Description: Time code of an entry, advancing the delta reference past timed entries
+* Parameters: reading - heart rate reading
+*             nowMs - current millis()
+*             timed - set once a timed entry was coded
+*             referenceAge - age (s) of the previous timed entry, 0 before the first
+* Returns: uint32_t - time code
+*****************************************************************************************/
+static uint32_t timeCode(const HeartRateReading& reading, unsigned long nowMs, bool* timed, uint32_t* referenceAge) {
+  if (reading.timestampMs == READING_TIMESTAMP_UNKNOWN) {
+    return 0;
+  }
+  uint32_t age = (uint32_t)(nowMs - reading.timestampMs) / 1000;   // Wrap-safe, like millis()
+  uint32_t code = 1 + zigZag((int32_t)(age - *referenceAge));
+  *referenceAge = age;
+  *timed = true;
+  return code;
+}
+
+/*****************************************************************************************
+* Function: Whole Rate
+*
+* Description: Heart rate rounded to whole BPM
+* Parameters: heartRate - BPM
+* Returns: int32_t - rounded BPM, 0 for negative values
+*****************************************************************************************/
+static int32_t wholeRate(float heartRate) {
+  return heartRate <= 0 ? 0 : (int32_t)(heartRate + 0.5f);
+}
+
+/*****************************************************************************************
+* Function: Zig Zag / Un Zig Zag
+*
+* Description: Maps signed values to unsigned ones with small magnitudes staying small
+*              (0, -1, 1, -2 ... -> 0, 1, 2, 3 ...) and back
+* Parameters: value - value to map
+* Returns: uint32_t / int32_t - mapped value
+*****************************************************************************************/
+static uint32_t zigZag(int32_t value) {
+  return ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+}
+
+static int32_t unZigZag(uint32_t value) {
+  return (int32_t)(value >> 1) ^ -(int32_t)(value & 1);
+}
+
+/*****************************************************************************************
+* Function: Varint Size / Write Varint / Read Varint
+*
+* Description: LEB128 unsigned varints, 7 bits per byte with the high bit continuing
+* Parameters: output / input - position to write / read (advanced past the varint)
+*             end - end of the input
+*             value - value to write / set to the value read
+* Returns: size_t - bytes / bool - True if a complete varint of at most 32 bits was read
+*****************************************************************************************/
+static size_t varintSize(uint32_t value) {
+  size_t size = 1;
+  while (value >= 0x80) {
+    value >>= 7;
+    size++;
+  }
+  return size;
+}
+
+static size_t writeVarint(uint8_t* output, uint32_t value) {
+  size_t size = 0;
+  while (value >= 0x80) {
+    output[size++] = (value & 0x7F) | 0x80;
+    value >>= 7;
+  }
+  output[size++] = value;
+  return size;
+}
+
+static bool readVarint(const uint8_t** input, const uint8_t* end, uint32_t* value) {
+  uint32_t result = 0;
+  for (int shift = 0; shift < 35 && *input < end; shift += 7) {
+    uint8_t byte = *(*input)++;
+    result |= (uint32_t)(byte & 0x7F) << shift;
+    if ((byte & 0x80) == 0) {
+      *value = result;
+      return true;
+    }
+  }
+  return false;
+}
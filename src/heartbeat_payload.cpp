@@ -0,0 +1,104 @@
+/*****************************************************************************************
+ * Heartbeat Payload
+ *
+ * All values are little-endian, as Anchor's Borsh encoding expects; the ESP32 is
+ * little-endian, so fields are copied as they are.
+ *
+ *****************************************************************************************/
+
+#include "heartbeat_payload.h"
+#include <string.h>
+
+/*****************************************************************************************
+* Function: Heartbeat Payload Single
+*
+* Description: Encodes one log_heartbeat payload (f32 heart rate) per reading, back to back
+* Parameters: readings - heart rate readings
+*             count - number of readings
+*             payload - destination, count * HEARTBEAT_SINGLE_SIZE bytes
+* Returns: size_t - size of one payload (every instruction has the same length)
+*****************************************************************************************/
+size_t heartbeatPayloadSingle(const HeartRateReading* readings, size_t count, uint8_t* payload) {
+  for (size_t i = 0; i < count; i++) {
+    memcpy(payload + i * HEARTBEAT_SINGLE_SIZE, &readings[i].heartRate, sizeof(float));
+  }
+  return HEARTBEAT_SINGLE_SIZE;
+}
+
+/*****************************************************************************************
+* Function: Heartbeat Payload Summary
+*
+* Description: Encodes one log_heartbeat_summary payload per reading, back to back: f32 mean
+*              heart rate, u16 beat count, u16 std dev (0.01 BPM), u16 RMSSD (ms), u16 time
+*              above WINDOW_HIGH_HEART_RATE (s), u8 min, u8 max, u8 quality
+* Parameters: readings - heart rate readings
+*             count - number of readings
+*             payload - destination, count * HEARTBEAT_SUMMARY_SIZE bytes
+* Returns: size_t - size of one payload (every instruction has the same length)
+*****************************************************************************************/
+size_t heartbeatPayloadSummary(const HeartRateReading* readings, size_t count, uint8_t* payload) {
+  for (size_t i = 0; i < count; i++) {
+    const HeartRateSummary& summary = readings[i].summary;
+    uint8_t* entry = payload + i * HEARTBEAT_SUMMARY_SIZE;
+    memcpy(entry, &readings[i].heartRate, sizeof(float));
+    memcpy(entry + 4, &summary.beatCount, sizeof(uint16_t));
+    memcpy(entry + 6, &summary.stdDevCentiBpm, sizeof(uint16_t));
+    memcpy(entry + 8, &summary.rmssdMs, sizeof(uint16_t));
+    memcpy(entry + 10, &summary.highSeconds, sizeof(uint16_t));
+    entry[12] = summary.minBpm;
+    entry[13] = summary.maxBpm;
+    entry[14] = summary.quality;
+  }
+  return HEARTBEAT_SUMMARY_SIZE;
+}
+
+/*****************************************************************************************
+* Function: Heartbeat Payload Packed
+*
+* Description: Encodes a log_heartbeat_batch payload: Vec<(u32 age_ms, f32 heart_rate)>.
+*              Readings of an earlier boot get age UINT32_MAX
+* Parameters: readings - heart rate readings
+*             count - number of readings
+*             nowMs - current millis(), ages are relative to it
+*             payload - destination, HEARTBEAT_PACKED_SIZE(count) bytes
+* Returns: size_t - payload length
+*****************************************************************************************/
+size_t heartbeatPayloadPacked(const HeartRateReading* readings, size_t count, unsigned long nowMs, uint8_t* payload) {
+  uint32_t vecLength = count;
+  memcpy(payload, &vecLength, sizeof(uint32_t));
+  uint8_t* entry = payload + sizeof(uint32_t);
+  for (size_t i = 0; i < count; i++) {
+    uint32_t ageMs = (readings[i].timestampMs == READING_TIMESTAMP_UNKNOWN) ? UINT32_MAX : nowMs - readings[i].timestampMs;
+    memcpy(entry, &ageMs, sizeof(uint32_t));
+    memcpy(entry + sizeof(uint32_t), &readings[i].heartRate, sizeof(float));
+    entry += HEARTBEAT_PACKED_ENTRY_SIZE;
+  }
+  return entry - payload;
+}
+
+/*****************************************************************************************
+* Function: Heartbeat Payload Compact
+*
+* Description: Encodes a log_heartbeat_compact payload: Vec<u8> holding the readings in
+*              the heartbeat codec format
+* Parameters: readings - heart rate readings
+*             count - number of readings
+*             nowMs - current millis(), ages are relative to it
+*             flags - HEARTBEAT_CODEC_FLAG_* options
+*             payload - destination
+*             payloadSize - size of the destination
+* Returns: size_t - payload length, 0 if the readings do not fit
+*****************************************************************************************/
+size_t heartbeatPayloadCompact(const HeartRateReading* readings, size_t count, unsigned long nowMs, uint8_t flags,
+                               uint8_t* payload, size_t payloadSize) {
+  if (payloadSize < HEARTBEAT_COMPACT_PREFIX_SIZE) {
+    return 0;
+  }
+  uint32_t vecLength = heartbeatCodecEncode(readings, count, nowMs, flags, payload + HEARTBEAT_COMPACT_PREFIX_SIZE,
+                                            payloadSize - HEARTBEAT_COMPACT_PREFIX_SIZE);
+  if (vecLength == 0) {
+    return 0;
+  }
+  memcpy(payload, &vecLength, sizeof(uint32_t));
+  return HEARTBEAT_COMPACT_PREFIX_SIZE + vecLength;
+}
@@ -0,0 +1,177 @@
+/*****************************************************************************************
+ * Instrumentation
+ *
+ * Stages are recorded from several tasks on both cores, so updates take a spinlock; an
+ * update is a handful of instructions. The 32-bit cycle counter wraps after ~17s at
+ * 240MHz, which bounds the longest measurable stage.
+ *
+ * Percentiles are read from the histograms and reported as bucket upper bounds.
+ *
+ *****************************************************************************************/
+
+#include "instrumentation.h"
+
+#if INSTRUMENTATION_ENABLED
+
+#include "logger.h"
+#include "sampler.h"
+
+/*****************************************************************************************
+* Global Variables
+*****************************************************************************************/
+struct StageStats {
+  uint32_t count;
+  uint64_t totalUs;
+  uint32_t maxUs;
+  uint32_t buckets[INSTRUMENT_BUCKETS];
+};
+
+struct __attribute__((packed)) TelemetryStage {
+  uint32_t count;
+  uint32_t meanUs;
+  uint32_t maxUs;
+};
+
+struct __attribute__((packed)) TelemetryRecord {
+  uint32_t uptimeMs;
+  uint32_t sampleOverruns;
+  TelemetryStage stages[STAGE_COUNT];
+  uint32_t counters[COUNTER_COUNT];
+};
+
+static const char* const stageNames[STAGE_COUNT] = {
+  "adc window", "filter", "peak detect", "display flush",
+  "blockhash fetch", "sign", "serialize", "rpc submit",
+};
+static const char* const counterNames[COUNTER_COUNT] = {
+  "adc pool overflows", "loop deadline misses", "tx failures", "rpc retries", "upload retries",
+  "tx dropped", "rpc failovers", "tx rate limited",
+};
+
+static StageStats stages[STAGE_COUNT];
+static uint32_t counters[COUNTER_COUNT];
+static portMUX_TYPE instrumentMux = portMUX_INITIALIZER_UNLOCKED;
+static unsigned long lastTelemetryTime = 0;
+
+static uint32_t percentileUs(const StageStats& stats, uint32_t percent);
+
+/*****************************************************************************************
+* Function: Instrument Stop
+*
+* Description: Records the duration of a stage started with instrumentStart()
+* Parameters: stage - measured stage
+*             startCycles - value returned by instrumentStart()
+* Returns: None
+*****************************************************************************************/
+void instrumentStop(InstrumentStage stage, uint32_t startCycles) {
+  uint32_t us = (ESP.getCycleCount() - startCycles) / getCpuFrequencyMhz();
+  uint32_t bucket = (us == 0) ? 0 : 32 - __builtin_clz(us);
+  if (bucket >= INSTRUMENT_BUCKETS) {
+    bucket = INSTRUMENT_BUCKETS - 1;
+  }
+
+  portENTER_CRITICAL(&instrumentMux);
+  StageStats& stats = stages[stage];
+  stats.count++;
+  stats.totalUs += us;
+  if (us > stats.maxUs) {
+    stats.maxUs = us;
+  }
+  stats.buckets[bucket]++;
+  portEXIT_CRITICAL(&instrumentMux);
+}
+
+/*****************************************************************************************
+* Function: Instrument Count
+*
+* Description: Increments an event counter
+* Parameters: counter - counted event
+* Returns: None
+*****************************************************************************************/
+void instrumentCount(InstrumentCounter counter) {
+  portENTER_CRITICAL(&instrumentMux);
+  counters[counter]++;
+  portEXIT_CRITICAL(&instrumentMux);
+}
+
+/*****************************************************************************************
+* Function: Instrument Print
+*
+* Description: Prints count, mean, p50, p99 and max of every stage and all counters
+* Parameters: None
+* Returns: None
+*****************************************************************************************/
+void instrumentPrint() {
+  StageStats snapshot[STAGE_COUNT];
+  uint32_t counterSnapshot[COUNTER_COUNT];
+  portENTER_CRITICAL(&instrumentMux);
+  memcpy(snapshot, stages, sizeof(snapshot));
+  memcpy(counterSnapshot, counters, sizeof(counterSnapshot));
+  portEXIT_CRITICAL(&instrumentMux);
+
+  LOG_INFO("\n=== Instrumentation (us) ===\n");
+  LOG_INFO("%-16s %8s %8s %8s %8s %8s\n", "stage", "count", "mean", "p50<", "p99<", "max");
+  for (int i = 0; i < STAGE_COUNT; i++) {
+    const StageStats& stats = snapshot[i];
+    uint32_t mean = stats.count ? (uint32_t)(stats.totalUs / stats.count) : 0;
+    LOG_INFO("%-16s %8u %8u %8u %8u %8u\n", stageNames[i], stats.count, mean,
+             percentileUs(stats, 50), percentileUs(stats, 99), stats.maxUs);
+  }
+  LOG_INFO("%-20s %8u\n", "sample overruns", samplerOverruns());
+  for (int i = 0; i < COUNTER_COUNT; i++) {
+    LOG_INFO("%-20s %8u\n", counterNames[i], counterSnapshot[i]);
+  }
+}
+
+/*****************************************************************************************
+* Function: Instrument Service
+*
+* Description: Emits a binary telemetry record every INSTRUMENT_TELEMETRY_MS. Call from the
+*              loop
+* Parameters: None
+* Returns: None
+*****************************************************************************************/
+void instrumentService() {
+  if (INSTRUMENT_TELEMETRY_MS == 0 || millis() - lastTelemetryTime < INSTRUMENT_TELEMETRY_MS) {
+    return;
+  }
+  lastTelemetryTime = millis();
+
+  TelemetryRecord record;
+  record.uptimeMs = lastTelemetryTime;
+  record.sampleOverruns = samplerOverruns();
+  portENTER_CRITICAL(&instrumentMux);
+  for (int i = 0; i < STAGE_COUNT; i++) {
+    record.stages[i].count = stages[i].count;
+    record.stages[i].meanUs = stages[i].count ? (uint32_t)(stages[i].totalUs / stages[i].count) : 0;
+    record.stages[i].maxUs = stages[i].maxUs;
+  }
+  memcpy(record.counters, counters, sizeof(record.counters));
+  portEXIT_CRITICAL(&instrumentMux);
+  logBinary(INSTRUMENT_TELEMETRY_TAG, &record, sizeof(record));
+}
+
+/*****************************************************************************************
+* Function: Percentile
+*
+* Description: Upper bound of the bucket containing the given percentile
+* Parameters: stats - stage histogram
+*             percent - percentile (1-100)
+* Returns: uint32_t - duration bound in us (UINT32_MAX if in the overflow bucket)
+*****************************************************************************************/
+static uint32_t percentileUs(const StageStats& stats, uint32_t percent) {
+  if (stats.count == 0) {
+    return 0;
+  }
+  uint32_t target = (uint32_t)(((uint64_t)stats.count * percent + 99) / 100);
+  uint32_t cumulative = 0;
+  for (int b = 0; b < INSTRUMENT_BUCKETS - 1; b++) {
+    cumulative += stats.buckets[b];
+    if (cumulative >= target) {
+      return 1UL << b;
+    }
+  }
+  return UINT32_MAX;
+}
+
+#endif
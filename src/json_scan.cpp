@@ -0,0 +1,332 @@
+/*****************************************************************************************
+ * JSON Scan
+ *
+ * Values are skipped by scanning for the matching bracket (strings and escapes taken into
+ * account), so the cost is one pass over the text up to the addressed value and there is
+ * no nesting limit. Keys are compared as written, the RPC never escapes them. Input is
+ * trusted to be well formed; malformed text fails the lookup but is never read past its
+ * terminator.
+ *
+ *****************************************************************************************/
+
+#include "json_scan.h"
+#include <string.h>
+
+static const char* skipWhitespace(const char* p);
+static const char* skipString(const char* p);
+static const char* skipValue(const char* p);
+static const char* findMember(const char* object, const char* key, size_t keyLength);
+static const char* findElement(const char* array, size_t index);
+
+/*****************************************************************************************
+* Function: JSON Find
+*
+* Description: Locates the value at a path in a JSON text
+* Parameters: json - null-terminated JSON text
+*             path - dot-separated keys and array indices, "" for the root
+*             value - set to the located value
+* Returns: bool - True if the path exists, false otherwise
+*****************************************************************************************/
+bool jsonFind(const char* json, const char* path, JsonValue* value) {
+  const char* p = skipWhitespace(json);
+  while (*path != '\0') {
+    const char* end = strchr(path, '.');
+    size_t segmentLength = end ? (size_t)(end - path) : strlen(path);
+
+    if (*p == '{') {
+      p = findMember(p, path, segmentLength);
+    } else if (*p == '[') {
+      size_t index = 0;
+      for (size_t i = 0; i < segmentLength; i++) {
+        if (path[i] < '0' || path[i] > '9') {
+          return false;
+        }
+        index = index * 10 + (path[i] - '0');
+      }
+      p = segmentLength > 0 ? findElement(p, index) : NULL;
+    } else {
+      return false;
+    }
+    if (p == NULL) {
+      return false;
+    }
+    path += segmentLength + (end ? 1 : 0);
+  }
+
+  const char* end = skipValue(p);
+  if (end == NULL) {
+    return false;
+  }
+  value->start = p;
+  value->length = end - p;
+  return true;
+}
+
+/*****************************************************************************************
+* Function: JSON Find In
+*
+* Description: Locates the value at a path relative to a value found before
+* Parameters: container - object or array to start from
+*             path - dot-separated keys and array indices
+*             value - set to the located value
+* Returns: bool - True if the path exists, false otherwise
+*****************************************************************************************/
+bool jsonFindIn(const JsonValue& container, const char* path, JsonValue* value) {
+  return jsonFind(container.start, path, value);
+}
+
+/*****************************************************************************************
+* Function: JSON Array Length
+*
+* Description: Counts the elements of an array
+* Parameters: array - array value
+* Returns: size_t - number of elements, 0 if the value is not an array
+*****************************************************************************************/
+size_t jsonArrayLength(const JsonValue& array) {
+  if (array.length == 0 || array.start[0] != '[') {
+    return 0;
+  }
+  const char* p = skipWhitespace(array.start + 1);
+  size_t count = 0;
+  while (*p != ']') {
+    p = skipValue(p);
+    if (p == NULL) {
+      return 0;
+    }
+    count++;
+    p = skipWhitespace(p);
+    if (*p == ',') {
+      p = skipWhitespace(p + 1);
+    } else if (*p != ']') {
+      return 0;
+    }
+  }
+  return count;
+}
+
+/*****************************************************************************************
+* Function: JSON Is Null / JSON Is String
+*
+* Description: Whether a value is null / the string expected
+* Parameters: value - value to test
+*             expected - string content to compare with
+* Returns: bool - True if it is, false otherwise
+*****************************************************************************************/
+bool jsonIsNull(const JsonValue& value) {
+  return value.length == 4 && strncmp(value.start, "null", 4) == 0;
+}
+
+bool jsonIsString(const JsonValue& value, const char* expected) {
+  size_t expectedLength = strlen(expected);
+  return value.length == expectedLength + 2 && value.start[0] == '"' &&
+         strncmp(value.start + 1, expected, expectedLength) == 0;
+}
+
+/*****************************************************************************************
+* Function: JSON Copy String
+*
+* Description: Copies the content of a string value, resolving the simple escapes
+* Parameters: value - string value
+*             output - destination, null-terminated
+*             outputSize - size of the destination
+* Returns: bool - True if copied, false if not a string, too long or \u-escaped
+*****************************************************************************************/
+bool jsonCopyString(const JsonValue& value, char* output, size_t outputSize) {
+  if (value.length < 2 || value.start[0] != '"' || outputSize == 0) {
+    return false;
+  }
+  const char* p = value.start + 1;
+  const char* end = value.start + value.length - 1;
+  size_t length = 0;
+  while (p < end) {
+    char c = *p++;
+    if (c == '\\') {
+      switch (*p++) {
+        case '"':  c = '"';  break;
+        case '\\': c = '\\'; break;
+        case '/':  c = '/';  break;
+        case 'n':  c = '\n'; break;
+        case 't':  c = '\t'; break;
+        case 'r':  c = '\r'; break;
+        default:   return false;
+      }
+    }
+    if (length + 1 >= outputSize) {
+      return false;
+    }
+    output[length++] = c;
+  }
+  output[length] = '\0';
+  return true;
+}
+
+/*****************************************************************************************
+* Function: JSON Get Uint64
+*
+* Description: Reads an unsigned integer given as a number or a decimal string (the RPC
+*              sends token amounts as strings)
+* Parameters: value - number or string value
+*             output - set to the integer
+* Returns: bool - True if the value is an unsigned integer within 64 bits, false otherwise
+*****************************************************************************************/
+bool jsonGetUint64(const JsonValue& value, uint64_t* output) {
+  const char* p = value.start;
+  const char* end = value.start + value.length;
+  if (value.length >= 2 && *p == '"') {
+    p++;
+    end--;
+  }
+  if (p == end) {
+    return false;
+  }
+  uint64_t result = 0;
+  for (; p < end; p++) {
+    if (*p < '0' || *p > '9') {
+      return false;
+    }
+    uint64_t digit = *p - '0';
+    if (result > (UINT64_MAX - digit) / 10) {
+      return false;
+    }
+    result = result * 10 + digit;
+  }
+  *output = result;
+  return true;
+}
+
+/*****************************************************************************************
+* Function: Skip Whitespace
+*
+* Description: Advances past JSON whitespace
+* Parameters: p - current position
+* Returns: const char* - first non-whitespace character
+*****************************************************************************************/
+static const char* skipWhitespace(const char* p) {
+  while (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r') {
+    p++;
+  }
+  return p;
+}
+
+/*****************************************************************************************
+* Function: Skip String
+*
+* Description: Advances past a string
+* Parameters: p - opening quote
+* Returns: const char* - character after the closing quote, NULL if unterminated
+*****************************************************************************************/
+static const char* skipString(const char* p) {
+  for (p++; *p != '\0'; p++) {
+    if (*p == '\\') {
+      if (*++p == '\0') {
+        return NULL;
+      }
+    } else if (*p == '"') {
+      return p + 1;
+    }
+  }
+  return NULL;
+}
+
+/*****************************************************************************************
+* Function: Skip Value
+*
+* Description: Advances past a complete value of any type
+* Parameters: p - first character of the value
+* Returns: const char* - character after the value, NULL if malformed
+*****************************************************************************************/
+static const char* skipValue(const char* p) {
+  if (*p == '"') {
+    return skipString(p);
+  }
+  if (*p == '{' || *p == '[') {
+    size_t depth = 0;
+    while (*p != '\0') {
+      if (*p == '"') {
+        p = skipString(p);
+        if (p == NULL) {
+          return NULL;
+        }
+        continue;
+      }
+      if (*p == '{' || *p == '[') {
+        depth++;
+      } else if ((*p == '}' || *p == ']') && --depth == 0) {
+        return p + 1;
+      }
+      p++;
+    }
+    return NULL;
+  }
+  const char* start = p;
+  while (*p != '\0' && *p != ',' && *p != '}' && *p != ']' &&
+         *p != ' ' && *p != '\t' && *p != '\n' && *p != '\r') {
+    p++;
+  }
+  return p > start ? p : NULL;
+}
+
+/*****************************************************************************************
+* Function: Find Member
+*
+* Description: Looks up a key in an object
+* Parameters: object - opening brace
+*             key - key to find (not null-terminated)
+*             keyLength - key length
+* Returns: const char* - first character of the member value, NULL if absent
+*****************************************************************************************/
+static const char* findMember(const char* object, const char* key, size_t keyLength) {
+  const char* p = skipWhitespace(object + 1);
+  while (*p == '"') {
+    const char* keyEnd = skipString(p);
+    if (keyEnd == NULL) {
+      return NULL;
+    }
+    bool match = (size_t)(keyEnd - p) == keyLength + 2 && strncmp(p + 1, key, keyLength) == 0;
+    p = skipWhitespace(keyEnd);
+    if (*p != ':') {
+      return NULL;
+    }
+    p = skipWhitespace(p + 1);
+    if (match) {
+      return p;
+    }
+    p = skipValue(p);
+    if (p == NULL) {
+      return NULL;
+    }
+    p = skipWhitespace(p);
+    if (*p != ',') {
+      return NULL;                      // End of the object (or malformed)
+    }
+    p = skipWhitespace(p + 1);
+  }
+  return NULL;
+}
+
+/*****************************************************************************************
+* Function: Find Element
+*
+* Description: Looks up an element of an array
+* Parameters: array - opening bracket
+*             index - element index
+* Returns: const char* - first character of the element, NULL if out of range
+*****************************************************************************************/
+static const char* findElement(const char* array, size_t index) {
+  const char* p = skipWhitespace(array + 1);
+  if (*p == ']') {
+    return NULL;
+  }
+  for (size_t i = 0; i < index; i++) {
+    p = skipValue(p);
+    if (p == NULL) {
+      return NULL;
+    }
+    p = skipWhitespace(p);
+    if (*p != ',') {
+      return NULL;
+    }
+    p = skipWhitespace(p + 1);
+  }
+  return p;
+}
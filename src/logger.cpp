@@ -0,0 +1,170 @@
+/*****************************************************************************************
+ * Logger
+ *
+ * Any task may write; only the logger task reads. Writers reserve and copy a whole
+ * message inside a short spinlock section, so messages from different tasks never
+ * interleave and a full buffer drops the message (counted) instead of waiting. The
+ * reader copies out of the ring without the lock and publishes its progress with an
+ * atomic store.
+ *
+ * Binary records are framed as LOG_BINARY_SYNC, tag, length (u16 little endian), payload,
+ * so a host script can separate them from the text around them.
+ *
+ * Before logBegin() (or if the task could not start) messages go straight to Serial.
+ *
+ *****************************************************************************************/
+
+#include "logger.h"
+#include <stdarg.h>
+
+/*****************************************************************************************
+* Global Variables
+*****************************************************************************************/
+#define LOG_BUFFER_MASK (LOG_BUFFER_SIZE - 1)
+
+static_assert((LOG_BUFFER_SIZE & LOG_BUFFER_MASK) == 0, "LOG_BUFFER_SIZE must be a power of two");
+
+static uint8_t logRing[LOG_BUFFER_SIZE];
+static uint32_t logHead = 0;            // Total bytes written (writers, under logMux)
+static uint32_t logTail = 0;            // Total bytes flushed (logger task)
+static uint32_t logDroppedCount = 0;
+static portMUX_TYPE logMux = portMUX_INITIALIZER_UNLOCKED;
+static TaskHandle_t logTaskHandle = NULL;
+
+static void logTask(void* parameter);
+static bool logWrite(const uint8_t* header, size_t headerLength, const uint8_t* data, size_t length);
+
+/*****************************************************************************************
+* Function: Log Begin
+*
+* Description: Starts the logger task. Serial must already be started
+* Parameters: None
+* Returns: bool - True if the task was started, false otherwise (logging stays synchronous)
+*****************************************************************************************/
+bool logBegin() {
+  if (xTaskCreatePinnedToCore(logTask, "logger", LOG_TASK_STACK_SIZE, NULL,
+                              LOG_TASK_PRIORITY, &logTaskHandle, LOG_TASK_CORE) != pdPASS) {
+    logTaskHandle = NULL;
+    Serial.println("❌ Failed to start logger task");
+    return false;
+  }
+  return true;
+}
+
+/*****************************************************************************************
+* Function: Log Printf
+*
+* Description: Formats a message (truncated to LOG_LINE_SIZE) and queues it for output
+* Parameters: format - printf format string, followed by its arguments
+* Returns: None
+*****************************************************************************************/
+void logPrintf(const char* format, ...) {
+  char line[LOG_LINE_SIZE];
+  va_list args;
+  va_start(args, format);
+  int length = vsnprintf(line, sizeof(line), format, args);
+  va_end(args);
+  if (length <= 0) {
+    return;
+  }
+  logWrite(NULL, 0, (const uint8_t*)line, min((size_t)length, sizeof(line) - 1));
+}
+
+/*****************************************************************************************
+* Function: Log Binary
+*
+* Description: Queues a framed binary record
+* Parameters: tag - record type chosen by the caller
+*             data - payload
+*             length - payload length in bytes
+* Returns: bool - True if queued, false if dropped because the buffer is full
+*****************************************************************************************/
+bool logBinary(uint8_t tag, const void* data, uint16_t length) {
+  const uint8_t header[] = { LOG_BINARY_SYNC, tag, (uint8_t)(length & 0xFF), (uint8_t)(length >> 8) };
+  return logWrite(header, sizeof(header), (const uint8_t*)data, length);
+}
+
+/*****************************************************************************************
+* Function: Log Dropped
+*
+* Description: Messages lost because the ring buffer was full
+* Parameters: None
+* Returns: uint32_t - message count
+*****************************************************************************************/
+uint32_t logDropped() {
+  return logDroppedCount;
+}
+
+/*****************************************************************************************
+* Function: Log Write
+*
+* Description: Copies a header and payload into the ring as one message, or drops it if
+*              it does not fit
+* Parameters: header - optional bytes written before the payload
+*             headerLength - header length
+*             data - payload
+*             length - payload length
+* Returns: bool - True if queued (or written directly), false if dropped
+*****************************************************************************************/
+static bool logWrite(const uint8_t* header, size_t headerLength, const uint8_t* data, size_t length) {
+  if (logTaskHandle == NULL) {
+    if (headerLength > 0) {
+      Serial.write(header, headerLength);
+    }
+    Serial.write(data, length);
+    return true;
+  }
+
+  size_t total = headerLength + length;
+  bool queued = false;
+  portENTER_CRITICAL(&logMux);
+  uint32_t tail = __atomic_load_n(&logTail, __ATOMIC_ACQUIRE);
+  if (LOG_BUFFER_SIZE - (logHead - tail) >= total) {
+    for (size_t i = 0; i < headerLength; i++) {
+      logRing[(logHead + i) & LOG_BUFFER_MASK] = header[i];
+    }
+    uint32_t start = (logHead + headerLength) & LOG_BUFFER_MASK;
+    size_t first = min(length, (size_t)(LOG_BUFFER_SIZE - start));
+    memcpy(logRing + start, data, first);
+    memcpy(logRing, data + first, length - first);
+    __atomic_store_n(&logHead, logHead + total, __ATOMIC_RELEASE);
+    queued = true;
+  } else {
+    logDroppedCount++;
+  }
+  portEXIT_CRITICAL(&logMux);
+
+  if (queued) {
+    xTaskNotifyGive(logTaskHandle);
+  }
+  return queued;
+}
+
+/*****************************************************************************************
+* Function: Log Task
+*
+* Description: Writes queued bytes to Serial; may block on the port without affecting anyone
+* Parameters: parameter - unused
+* Returns: None
+*****************************************************************************************/
+static void logTask(void* parameter) {
+  uint32_t reportedDrops = 0;
+
+  for (;;) {
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+    uint32_t head;
+    while ((head = __atomic_load_n(&logHead, __ATOMIC_ACQUIRE)) != logTail) {
+      uint32_t start = logTail & LOG_BUFFER_MASK;
+      size_t length = min((size_t)(head - logTail), (size_t)(LOG_BUFFER_SIZE - start));
+      Serial.write(logRing + start, length);
+      __atomic_store_n(&logTail, logTail + length, __ATOMIC_RELEASE);
+    }
+
+    uint32_t drops = logDroppedCount;
+    if (drops != reportedDrops) {
+      Serial.printf("\n⚠️ Logger dropped %u messages\n", drops - reportedDrops);
+      reportedDrops = drops;
+    }
+  }
+}
@@ -23,8 +23,35 @@
 #include <Wire.h>
 #include <Adafruit_GFX.h>
 #include <Adafruit_SSD1306.h>
+#include <Preferences.h>
+#include "mbedtls/sha256.h"
 #include "IoTxChain-lib.h"
 #include "credentials.h"
+#include "sampler.h"
+#include "signal_filter.h"
+#include "heart_rate_detector.h"
+#include "signal_quality.h"
+#include "heart_rate_window.h"
+#include "blockhash_cache.h"
+#include "rpc_client.h"
+#include "rpc_websocket.h"
+#include "tx_template.h"
+#include "signer.h"
+#include "anchor_discriminator.h"
+#include "pda.h"
+#include "heap_monitor.h"
+#include "power.h"
+#include "display_renderer.h"
+#include "logger.h"
+#include "instrumentation.h"
+#include "capture.h"
+#include "wifi_manager.h"
+#include "heart_rate_reading.h"
+#include "reading_store.h"
+#include "heartbeat_payload.h"
+#include "tx_pipeline.h"
+#include "rewards.h"
+#include "upload_schedule.h"
 
 /*****************************************************************************************  
 * Global Variables
@@ -43,21 +70,18 @@ uint8_t ledOn = 0;
 int ledStatus = LOW;
 
 // Heart Rate Sensor KY039
-#define HEART_RATE_SENSOR_PIN A0
-#define HEART_RATE_SAMPLE_SIZE 4        // Small rolling average for peak detection
-#define RISE_THRESHOLD 4                // Threshold for detecting rising edge (heartbeat)
+#ifndef HEART_RATE_SENSOR_PINS
+#define HEART_RATE_SENSOR_PINS A0       // One ADC1 pin per sampler channel (SAMPLER_CHANNELS)
+#endif
+const uint8_t heartRateSensorPins[] = { HEART_RATE_SENSOR_PINS };
+static_assert(sizeof(heartRateSensorPins) == SAMPLER_CHANNELS, "HEART_RATE_SENSOR_PINS needs one pin per sampler channel");
+#define HEART_RATE_BLOCK_SAMPLES CAPTURE_MAX_SAMPLES  // Samples filtered (and captured) per pass
 
 float heartRate = 0;
-float heartRateReadings[HEART_RATE_SAMPLE_SIZE] = {0};  // Initialize to zero
-float heartRateSum = 0;
 bool heartRateHeaderPrinted = false;
-
-// Peak detection variables
-bool rising = false;
-int riseCount = 0;
-float beforeValue = 0;
-unsigned long lastBeatTime = 0;
-float beatIntervals[3] = {1000, 1000, 1000};  // Default to 60 BPM intervals
+bool samplerReady = false;
+int windowCount = 0;                    // Filtered samples since the last detection step
+uint32_t nextSampleIndex = 0;           // Index the filter expects next (detects overruns)
 
 #define HEART_RATE_UPDATE_TIME_MS 250   // Check for heartbeat every 250ms
 unsigned long lastHeartRateTime = 0;
@@ -74,10 +98,15 @@ bool heartRateDisplay = 0;
 #define SCREEN_ADDRESS 0x3C
 #define OLED_SDA A4
 #define OLED_SCL A5
-Adafruit_SSD1306 display(SCREEN_WIDTH, SCREEN_HEIGHT, &Wire, OLED_RESET);
+Adafruit_SSD1306 display(SCREEN_WIDTH, SCREEN_HEIGHT, &Wire, OLED_RESET, DISPLAY_I2C_CLOCK_HZ, DISPLAY_I2C_CLOCK_HZ);
 
 // Solana Configuration
-IoTxChain solana("https://api.devnet.solana.com");
+#define SOLANA_RPC_URL "https://api.devnet.solana.com"
+#ifndef SOLANA_RPC_FALLBACK_URLS
+#define SOLANA_RPC_FALLBACK_URLS        // Further endpoints, e.g. "https://a...", "https://b..." (credentials.h)
+#endif
+const char* const rpcEndpoints[] = { SOLANA_RPC_URL, SOLANA_RPC_FALLBACK_URLS };
+IoTxChain solana(SOLANA_RPC_URL);       // Only for the one-off ATA lookup
 
 #define PROGRAM_ID "2hRuCZS1QyXe5N3bYFYvWWRZZqD1t1VwJWjvogfmAM6u"
 #define TOKEN_MINT "4f6b8KjU9QHeEHPczAsF4hL5RZvfWW52C5rw6QkW5XHy"
@@ -86,39 +115,170 @@ Pubkey SYSTEM_PROGRAM_ID = Pubkey::fromBase58("11111111111111111111111111111111"
 
 // Solana Accounts
 Pubkey owner;
-Keypair signer;
 Pubkey mint;
 std::vector<uint8_t> programId;
 Pubkey accountPdaPubkey;
 Pubkey mintAuthorityPdaPubkey;
 Pubkey tokenAccount;
 String tokenAccountAddress;
+#define SPL_TOKEN_AMOUNT_OFFSET 64      // u64 amount after the mint and owner of a token account
+#define TOKEN_DECIMALS_DIVISOR 1e9
+
+// Account values shown on the display, pushed to (or polled by) the network task
+portMUX_TYPE accountViewMux = portMUX_INITIALIZER_UNLOCKED;
+uint64_t displayedPoints = 0;
+uint64_t displayedTokenBalance = 0;
+bool tokenBalanceKnown = false;
+
+// Derived accounts cache (NVS), keyed by a hash of PUBLIC_KEY, PROGRAM_ID and TOKEN_MINT
+#define ACCOUNT_CACHE_NAMESPACE "accounts"
+Preferences accountCache;
+
+// Transaction templates (built once, patched with blockhash and payload on every send)
+TxTemplate logHeartbeatTemplate;
+TxTemplate logAndMintTemplate;          // log_heartbeat batch followed by mint_reward
+TxTemplate mintRewardTemplate;
 
 // Constants
 const int maxAttempts = 3;
 int attempt = 0;
 bool pdaSuccess = false;
-#define REWARDS_MINT_TIME_MS 600000 // 10 minutes
-unsigned long lastRewardsMintTime = 0;
-bool rewardsMinted = false;
 unsigned long lastDisplayMessageTime = 0;
 #define DISPLAY_MESSAGE_TIME_MS 1500
 
+// Serial commands (single characters from the serial monitor)
+#define SERIAL_COMMAND_STATS 's'        // Print the instrumentation report
+#define SERIAL_COMMAND_CAPTURE 'c'      // Start / stop raw signal capture
+
+// Network Task (Solana transactions run on core 0, sampling and display stay on core 1)
+#define NETWORK_TASK_CORE 0
+#define NETWORK_TASK_PRIORITY 1
+#define NETWORK_TASK_STACK_SIZE 12288
+#define HEART_RATE_QUEUE_LENGTH 4
+#define TX_RESULT_QUEUE_LENGTH 4
+
+// log_heartbeat batching (readings are buffered by the network task and sent in one transaction)
+#ifndef HEART_RATE_BATCH_SIZE
+#define HEART_RATE_BATCH_SIZE 1         // Readings per log_heartbeat transaction
+#endif
+#ifndef HEART_RATE_BATCH_FLUSH_MS
+#define HEART_RATE_BATCH_FLUSH_MS 600000 // Send a partial batch after 10 minutes
+#endif
+#ifndef HEART_RATE_BATCH_PACKED
+#define HEART_RATE_BATCH_PACKED 0       // 1: single log_heartbeat_batch instruction, 0: one log_heartbeat instruction per reading
+#endif
+#ifndef HEART_RATE_SUMMARY_UPLOAD
+#define HEART_RATE_SUMMARY_UPLOAD 0     // 1: one log_heartbeat_summary instruction (window summary) per reading
+#endif
+#ifndef HEART_RATE_BATCH_COMPACT
+#define HEART_RATE_BATCH_COMPACT 0      // 1: single log_heartbeat_compact instruction (heartbeat codec)
+#endif
+#ifndef HEART_RATE_CODEC_FLAGS
+#define HEART_RATE_CODEC_FLAGS (HEARTBEAT_CODEC_FLAG_QUALITY | (HEART_RATE_SUMMARY_UPLOAD ? HEARTBEAT_CODEC_FLAG_SUMMARY : 0))
+#endif
+#if HEART_RATE_SUMMARY_UPLOAD && HEART_RATE_BATCH_PACKED
+#error "HEART_RATE_SUMMARY_UPLOAD sends one instruction per reading, it cannot be combined with HEART_RATE_BATCH_PACKED"
+#endif
+#if HEART_RATE_BATCH_COMPACT && HEART_RATE_BATCH_PACKED
+#error "HEART_RATE_BATCH_COMPACT and HEART_RATE_BATCH_PACKED select different instructions"
+#endif
+
+#define LOG_HEARTBEAT_TX_OVERHEAD 230   // Signature, header, 4 account keys, blockhash, instruction count
+#if HEART_RATE_BATCH_COMPACT
+#define LOG_HEARTBEAT_IX_OVERHEAD 19    // Program index, 3 accounts, data length, discriminator, vec length
+#elif HEART_RATE_BATCH_PACKED
+#define LOG_HEARTBEAT_IX_OVERHEAD 19    // Program index, 3 accounts, data length, discriminator, vec length
+#define LOG_HEARTBEAT_READING_SIZE HEARTBEAT_PACKED_ENTRY_SIZE
+#elif HEART_RATE_SUMMARY_UPLOAD
+#define LOG_HEARTBEAT_IX_OVERHEAD 0
+#define LOG_HEARTBEAT_READING_SIZE 29   // One complete log_heartbeat_summary instruction
+#else
+#define LOG_HEARTBEAT_IX_OVERHEAD 0
+#define LOG_HEARTBEAT_READING_SIZE 18   // One complete log_heartbeat instruction
+#endif
+#define LOG_HEARTBEAT_READINGS_BYTES (SOLANA_TX_SIZE_LIMIT - LOG_HEARTBEAT_TX_OVERHEAD - LOG_HEARTBEAT_IX_OVERHEAD)
+#if HEART_RATE_BATCH_COMPACT
+#define HEART_RATE_BATCH_TX_CAPACITY TX_PIPELINE_MAX_READINGS  // Entries vary in size, batches are cut to fit
+#else
+#define HEART_RATE_BATCH_TX_CAPACITY (LOG_HEARTBEAT_READINGS_BYTES / LOG_HEARTBEAT_READING_SIZE)
+#endif
+#define HEART_RATE_BATCH_CAPACITY (HEART_RATE_BATCH_SIZE < HEART_RATE_BATCH_TX_CAPACITY ? HEART_RATE_BATCH_SIZE : HEART_RATE_BATCH_TX_CAPACITY)
+static_assert(HEART_RATE_BATCH_TX_CAPACITY <= TX_PIPELINE_MAX_READINGS, "Batches must fit a pipeline entry");
+
+// Anchor instruction discriminators (evaluated at compile time)
+#if HEART_RATE_BATCH_COMPACT
+constexpr AnchorDiscriminator LOG_HEARTBEAT_DISCRIMINATOR = anchorDiscriminator("log_heartbeat_compact");
+#elif HEART_RATE_BATCH_PACKED
+constexpr AnchorDiscriminator LOG_HEARTBEAT_DISCRIMINATOR = anchorDiscriminator("log_heartbeat_batch");
+#elif HEART_RATE_SUMMARY_UPLOAD
+constexpr AnchorDiscriminator LOG_HEARTBEAT_DISCRIMINATOR = anchorDiscriminator("log_heartbeat_summary");
+#else
+constexpr AnchorDiscriminator LOG_HEARTBEAT_DISCRIMINATOR = anchorDiscriminator("log_heartbeat");
+#endif
+constexpr AnchorDiscriminator MINT_REWARD_DISCRIMINATOR = anchorDiscriminator("mint_reward");
+#if HEART_RATE_BATCH_COMPACT
+#define LOG_HEARTBEAT_PAYLOAD_SIZE (HEARTBEAT_COMPACT_PREFIX_SIZE + LOG_HEARTBEAT_READINGS_BYTES)
+#elif HEART_RATE_BATCH_PACKED
+#define LOG_HEARTBEAT_PAYLOAD_SIZE HEARTBEAT_PACKED_SIZE(HEART_RATE_BATCH_TX_CAPACITY)
+#elif HEART_RATE_SUMMARY_UPLOAD
+#define LOG_HEARTBEAT_PAYLOAD_SIZE (HEART_RATE_BATCH_TX_CAPACITY * HEARTBEAT_SUMMARY_SIZE)
+#else
+#define LOG_HEARTBEAT_PAYLOAD_SIZE (HEART_RATE_BATCH_TX_CAPACITY * HEARTBEAT_SINGLE_SIZE)
+#endif
+
+// Store-and-forward (readings are persisted in flash until they are on-chain). The program
+// takes one log_heartbeat a minute, so without a batch instruction a backlog goes out one
+// reading per transaction
+#ifndef HEART_RATE_DRAIN_BATCH_SIZE
+#if HEART_RATE_BATCH_COMPACT || HEART_RATE_BATCH_PACKED
+#define HEART_RATE_DRAIN_BATCH_SIZE HEART_RATE_BATCH_TX_CAPACITY  // Readings per tx while catching up on a backlog
+#else
+#define HEART_RATE_DRAIN_BATCH_SIZE 1
+#endif
+#endif
+#define HEART_RATE_DRAIN_CAPACITY (HEART_RATE_DRAIN_BATCH_SIZE < HEART_RATE_BATCH_TX_CAPACITY ? HEART_RATE_DRAIN_BATCH_SIZE : HEART_RATE_BATCH_TX_CAPACITY)
+#ifndef UPLOAD_RETRY_MS
+#define UPLOAD_RETRY_MS 30000           // Wait before a postponed upload is tried again (radio off)
+#endif
+#define LINK_CHECK_MS 1000              // Link poll interval while uploads are postponed
+
+struct TxResult {
+  bool success;
+  size_t readingCount;
+  unsigned long durationMs;
+};
+
+QueueHandle_t heartRateQueue = NULL;
+QueueHandle_t txResultQueue = NULL;
+TaskHandle_t networkTaskHandle = NULL;
+
 /*****************************************************************************************
 * Function Declarations
 *****************************************************************************************/ 
 void connectToWiFi();
 void readHeartRate();
 void printSplTokenBalance();
+void onTokenBalancePushed(const uint8_t* data, size_t length);
+void setDisplayedTokenBalance(uint64_t rawBalance);
 bool prepareSolanaAccounts();
 void printSolanaAccounts();
-String vectorToHex(const std::vector<uint8_t>& data);
-bool sendHeartRateReading(float heartRate);
+void hashAccountInputs(uint8_t* hash);
+bool loadSolanaAccounts(const uint8_t* inputsHash);
+void storeSolanaAccounts(const uint8_t* inputsHash);
+void printHex(const std::vector<uint8_t>& data);
+bool prepareTransactionTemplates();
+bool sendHeartRateBatch(const HeartRateReading* readings, size_t count, char* signature);
+bool resendHeartRateBatch(const HeartRateReading* readings, size_t count, char* signature);
+bool submitTemplate(TxTemplate* tpl, char* signature);
 bool mintRewards();
 void initializeDisplay();
 void displayHeartRate(float heartRate);
 void displayWiFiStatus();
-void displayMessage(String message, int line);
+void displayMessage(const char* message, int line);
+unsigned long msUntilNextDeadline();
+void handleSerialCommands();
+bool startNetworkTask();
+void networkTask(void* parameter);
 
 /*****************************************************************************************
 * Function: Initial Setup
@@ -131,6 +291,7 @@ void setup() {
   // initialize serial communication
   Serial.begin(115200);
   delay(2000);
+  logBegin();
 
   // initialize LEDs
   pinMode(LED_BUILTIN, OUTPUT);
@@ -142,8 +303,20 @@ void setup() {
   digitalWrite(LED_GREEN, HIGH);
   digitalWrite(LED_RED, HIGH);
 
+  // initialize RPC client (persistent connection used for blockhash, transactions and balance)
+  if (!rpcBegin(rpcEndpoints, sizeof(rpcEndpoints) / sizeof(rpcEndpoints[0]))) {
+    LOG_ERROR("❌ No valid RPC endpoint\n");
+  }
+  wsBegin(SOLANA_RPC_URL);
+
   // initialize heart rate sensor
-  pinMode(HEART_RATE_SENSOR_PIN, INPUT);
+  for (uint32_t c = 0; c < SAMPLER_CHANNELS; c++) {
+    pinMode(heartRateSensorPins[c], INPUT);
+  }
+  samplerReady = samplerBegin(heartRateSensorPins);
+  if (!samplerReady) {
+    LOG_ERROR("❌ Failed to start heart rate sampler\n");
+  }
   
   // initialize OLED display
   initializeDisplay();
@@ -165,12 +338,21 @@ void setup() {
   if (pdaSuccess) {
     printSolanaAccounts();
   } else {
-    Serial.println("❌ Failed to calculate PDAs");
+    LOG_ERROR("❌ Failed to calculate PDAs\n");
   }
 
   // print SPL token balance of user
   printSplTokenBalance();
 
+  // radio stays in its low power state between uploads
+  powerBegin();
+
+  // start network task (from here on only the network task talks to the RPC)
+  if (pdaSuccess && !startNetworkTask()) {
+    LOG_ERROR("❌ Failed to start network task\n");
+    pdaSuccess = false;
+  }
+
 }
 
 /*****************************************************************************************
@@ -192,6 +374,9 @@ void loop() {
 
   // capture heart rate
   if (timeMs - lastHeartRateTime > HEART_RATE_UPDATE_TIME_MS) {
+    if (lastHeartRateTime > 0 && timeMs - lastHeartRateTime > 2 * HEART_RATE_UPDATE_TIME_MS) {
+      instrumentCount(COUNTER_LOOP_DEADLINE_MISSES);
+    }
     digitalWrite(LED_RED, LOW);
     digitalWrite(LED_GREEN, HIGH);
     digitalWrite(LED_BLUE, HIGH);
@@ -200,10 +385,17 @@ void loop() {
     
     // Display heart rate in serial monitor
     if (!heartRateHeaderPrinted) {
-      Serial.println("\n== ❤️  Heart Rate Monitor ❤️  ==");
+      LOG_DEBUG("\n== ❤️  Heart Rate Monitor ❤️  ==\n");
       heartRateHeaderPrinted = true;
     }
-    Serial.println("BPM: " + String(heartRate, 1));
+    LOG_DEBUG("BPM: %.1f\n", heartRate);
+#if SAMPLER_CHANNELS > 1
+    for (uint32_t c = 0; c < SAMPLER_CHANNELS; c++) {
+      if (c != HEART_RATE_CHANNEL) {
+        LOG_DEBUG("BPM (channel %u): %.1f\n", c, detectorHeartRate(c));
+      }
+    }
+#endif
     
     // Update OLED display with heart rate
     if (timeMs - lastDisplayMessageTime > DISPLAY_MESSAGE_TIME_MS) {
@@ -211,18 +403,48 @@ void loop() {
     }
   }
 
-  // send heart rate reading
+  // queue heart rate reading for the network task, unless the signal since the last one
+  // was too poor to trust (no transaction fee for garbage)
   if ((timeMs - lastHeartRateSendTime > HEART_RATE_SEND_TIME_MS) && pdaSuccess) {
-    Serial.println("\n\n=== Sending Heart Rate Reading ===");
-    displayMessage("Sending Heart Rate...", 0);
+    uint8_t quality = qualityScore();
+    HeartRateReading reading = { windowMeanHeartRate(), timeMs };
+    windowSummarize(quality, &reading.summary);
+    qualityReset();
+    windowReset();
+    if (quality < SIGNAL_QUALITY_MIN) {
+      LOG_INFO("\nSignal quality %u (below %u), heart rate reading not sent\n", quality, SIGNAL_QUALITY_MIN);
+      displayMessage("Poor signal, skipped", 0);
+    } else {
+      LOG_INFO("\n\n=== Sending Heart Rate Reading (quality %u) ===\n", quality);
+      displayMessage("Sending Heart Rate...", 0);
+      digitalWrite(LED_GREEN, HIGH);
+      digitalWrite(LED_RED, HIGH);
+      digitalWrite(LED_BLUE, LOW);
+      LOG_INFO("\nTime since last transaction: %lums\n\n", millis() - lastHeartRateSendTime);
+      LOG_INFO("Window: %.1f BPM (%u-%u), %u beats, RMSSD %ums, %us above %u BPM\n",
+               reading.heartRate, reading.summary.minBpm, reading.summary.maxBpm, reading.summary.beatCount,
+               reading.summary.rmssdMs, reading.summary.highSeconds, WINDOW_HIGH_HEART_RATE);
+      if (xQueueSend(heartRateQueue, &reading, 0) != pdTRUE) {
+        LOG_ERROR("❌ Heart rate queue full, reading dropped\n");
+      }
+    }
     heartRateHeaderPrinted = false;
-    digitalWrite(LED_GREEN, HIGH);
-    digitalWrite(LED_RED, HIGH);
-    digitalWrite(LED_BLUE, LOW);
-    Serial.println("\nTime since last transaction: " + String(millis()-lastHeartRateSendTime) + "ms\n");
     lastHeartRateSendTime = timeMs;
-    heartRateSent = sendHeartRateReading(heartRate);
-    Serial.println("Time to send transaction: " + String(millis()-lastHeartRateSendTime) + "ms\n");
+    lastDisplayMessageTime = millis();
+  }
+
+  // serial commands and periodic telemetry
+  handleSerialCommands();
+  instrumentService();
+
+  // sleep until the next deadline, waking early for transaction results from the network task
+  TickType_t wait = pdMS_TO_TICKS(msUntilNextDeadline());
+  TxResult txResult;
+  if (!pdaSuccess) {
+    vTaskDelay(wait);
+  } else if (xQueueReceive(txResultQueue, &txResult, wait) == pdTRUE) {
+    heartRateSent = txResult.success;
+    LOG_INFO("Time to send transaction (%u readings): %lums\n\n", (unsigned)txResult.readingCount, txResult.durationMs);
     if (heartRateSent) {
       displayMessage("Tx Sent Successfully!", 2);
     } else {
@@ -231,7 +453,6 @@ void loop() {
     lastDisplayMessageTime = millis();
   }
 
-
 }
 
 /*****************************************************************************************
@@ -269,104 +490,83 @@ void blinkRgbLed() {
 /*****************************************************************************************
 * Function: Connect to WiFi
 *
-* Description: Connects to WiFi with global ssid and password
+* Description: Starts the WiFi manager with global ssid and password and waits for the
+*              first connection. The manager keeps reconnecting in the background
 * Parameters: None
 * Returns: None
 *****************************************************************************************/ 
 void connectToWiFi() {
   timeMs = millis();
-  Serial.println("Connecting to WiFi...");
-  // initialize WiFi
-  WiFi.begin(ssid, password);
+  LOG_INFO("Connecting to WiFi...\n");
+  // initialize WiFi (fast reconnect to the cached access point if there is one)
+  wifiBegin(ssid, password);
 
   // wait for WiFi connection
-  while (WiFi.status() != WL_CONNECTED && (millis() - timeMs) < WIFI_TIMEOUT_MS) {
-    delay(500);
-    Serial.print(".");
-  }
-
-  if (WiFi.status() == WL_CONNECTED) {
-    Serial.println("\nWiFi connected");
-    Serial.print("IP address: ");
-    Serial.println(WiFi.localIP());
+  if (wifiWaitForLink(WIFI_TIMEOUT_MS)) {
+    LOG_INFO("WiFi connected in %lums\n", millis() - timeMs);
+    LOG_INFO("IP address: %s\n", WiFi.localIP().toString().c_str());
   } else {
-    Serial.println("WiFi connection failed");
+    LOG_INFO("WiFi connection failed\n");
   }
 }
 
 /*****************************************************************************************
 * Function: Read Heart Rate
 *
-* Description: Detects heartbeats using peak detection and calculates BPM from beat intervals
+* Description: Drains the sampler rings in blocks, band-pass filters every sample of every
+*              channel, scores the HEART_RATE_CHANNEL block for clipping and runs peak
+*              detection on every HEART_RATE_WINDOW_MS of filtered signal of each channel;
+*              accepted beats of HEART_RATE_CHANNEL go into the upload window
 * Parameters: None
 * Returns: None
 *****************************************************************************************/ 
 void readHeartRate() {
-  // Step 1: Take 20ms average reading (eliminates 50Hz electrical noise)
-  float newReading = 0;
-  int readingCount = 0;
-  unsigned long startTime = millis();
-  
-  do {
-    newReading += analogRead(HEART_RATE_SENSOR_PIN);
-    readingCount++;
-  } while (millis() - startTime < 20);
-  
-  newReading /= readingCount;  // Average of all readings in 20ms
-  
-  // Step 2: Update rolling average for smoothing
-  heartRateSum -= heartRateReadings[0];               // Remove oldest
-  heartRateSum += newReading;                         // Add newest
-  
-  // Shift array left
-  for (int i = 0; i < HEART_RATE_SAMPLE_SIZE - 1; i++) {
-    heartRateReadings[i] = heartRateReadings[i + 1];
+  if (!samplerReady) {
+    return;
   }
-  heartRateReadings[HEART_RATE_SAMPLE_SIZE - 1] = newReading;
-  
-  float currentAverage = heartRateSum / HEART_RATE_SAMPLE_SIZE;
-  
-  // Step 3: Peak Detection (heartbeat detection)
-  if (currentAverage > beforeValue) {
-    // Signal is rising
-    riseCount++;
-    
-    if (!rising && riseCount > RISE_THRESHOLD) {
-      // Detected a heartbeat peak!
-      rising = true;
-      
-      unsigned long currentTime = millis();
-      unsigned long beatInterval = currentTime - lastBeatTime;
-      
-      // Only process if interval is realistic (30-200 BPM = 300-2000ms) and not first beat
-      if (lastBeatTime > 0 && beatInterval > 300 && beatInterval < 2000) {
-        // Update beat intervals (shift array)
-        beatIntervals[2] = beatIntervals[1];
-        beatIntervals[1] = beatIntervals[0];
-        beatIntervals[0] = beatInterval;
-        
-        // Calculate BPM using weighted average of last 3 beats
-        float weightedInterval = (0.4 * beatIntervals[0]) + 
-                                (0.3 * beatIntervals[1]) + 
-                                (0.3 * beatIntervals[2]);
-        
-        heartRate = 60000.0 / weightedInterval;  // Convert ms to BPM
-        
-        // Constrain to realistic range
-        heartRate = constrain(heartRate, 30, 200);
+
+  // One block per channel, back to back (same layout as the sampler rings)
+  uint16_t samples[SAMPLER_CHANNELS * HEART_RATE_BLOCK_SAMPLES];
+  int32_t filtered[SAMPLER_CHANNELS * HEART_RATE_BLOCK_SAMPLES];
+  const uint16_t* heartRateSamples = samples + HEART_RATE_CHANNEL * HEART_RATE_BLOCK_SAMPLES;
+  const int32_t* heartRateFiltered = filtered + HEART_RATE_CHANNEL * HEART_RATE_BLOCK_SAMPLES;
+  uint32_t firstIndex;
+  size_t count;
+
+  // Step 1: Band-pass filter at the full sample rate (removes 50Hz noise and the DC level)
+  while ((count = samplerRead(samples, HEART_RATE_BLOCK_SAMPLES, &firstIndex)) > 0) {
+    if (firstIndex != nextSampleIndex) {
+      // Gap after an overrun: the index skipped the lost samples, but no filter state or
+      // beat interval may span them
+      filterReset();
+      detectorGap();
+      windowGap();
+    }
+    nextSampleIndex = firstIndex + count;
+    uint32_t stageStart = instrumentStart();
+    for (uint32_t c = 0; c < SAMPLER_CHANNELS; c++) {
+      filterProcessBlock(c, samples + c * HEART_RATE_BLOCK_SAMPLES, count, filtered + c * HEART_RATE_BLOCK_SAMPLES);
+    }
+    instrumentStop(STAGE_FILTER, stageStart);
+    qualityAddSamples(heartRateSamples, count);
+    captureBlock(heartRateSamples, heartRateFiltered, count, firstIndex);
+    for (size_t i = 0; i < count; i++) {
+      if (++windowCount == HEART_RATE_WINDOW_SAMPLES) {
+        stageStart = instrumentStart();
+        for (uint32_t c = 0; c < SAMPLER_CHANNELS; c++) {
+          if (detectorUpdate(c, filtered[c * HEART_RATE_BLOCK_SAMPLES + i], firstIndex + i) &&
+              c == HEART_RATE_CHANNEL) {
+            heartRate = detectorHeartRate(c);
+            windowAddBeat(detectorLastInterval(c));
+          }
+        }
+        instrumentStop(STAGE_PEAK_DETECT, stageStart);
+        windowCount = 0;
       }
-      lastBeatTime = currentTime;
     }
-  } else {
-    // Signal is falling - reset rise detection
-    rising = false;
-    riseCount = 0;
   }
-  
-  beforeValue = currentAverage;
 }
 
-
 /*****************************************************************************************
 * Function: Get SPL token balance
 *
@@ -375,89 +575,209 @@ void readHeartRate() {
 * Returns: None
 *****************************************************************************************/ 
 void printSplTokenBalance() {
-  Serial.println("\n=== User SPL Token Balance ===");
+  LOG_INFO("\n=== User SPL Token Balance ===\n");
 
   uint64_t rawBalance = 0;
 
-  if (solana.getSplTokenBalance(PUBLIC_KEY, TOKEN_MINT, rawBalance)) {
-      float readableBalance = (float)rawBalance / 1e9;
-      Serial.print("Token Balance: ");
-      Serial.println(readableBalance, 9);
+  if (rpcGetSplTokenBalance(PUBLIC_KEY, TOKEN_MINT, rawBalance)) {
+      float readableBalance = (float)rawBalance / TOKEN_DECIMALS_DIVISOR;
+      LOG_INFO("Token Balance: %.9f\n", readableBalance);
+      setDisplayedTokenBalance(rawBalance);
   } else {
-      Serial.println("Failed to get SPL token balance.");
+      LOG_INFO("Failed to get SPL token balance.\n");
   }
-  Serial.print("\n");
+  LOG_INFO("\n");
+}
+
+/*****************************************************************************************
+* Function: On Token Balance Pushed
+*
+* Description: Takes the balance from a token account notification (network task)
+* Parameters: data - amount field (u64, little-endian)
+*             length - field length
+* Returns: None
+*****************************************************************************************/ 
+void onTokenBalancePushed(const uint8_t* data, size_t length) {
+  uint64_t rawBalance = 0;
+  for (int i = length - 1; i >= 0; i--) {
+    rawBalance = (rawBalance << 8) | data[i];
+  }
+  LOG_INFO("Token Balance: %.9f (pushed)\n", (float)rawBalance / TOKEN_DECIMALS_DIVISOR);
+  setDisplayedTokenBalance(rawBalance);
+}
+
+/*****************************************************************************************
+* Function: Set Displayed Token Balance
+*
+* Description: Publishes the token balance to the display (read on the loop core)
+* Parameters: rawBalance - raw token amount
+* Returns: None
+*****************************************************************************************/ 
+void setDisplayedTokenBalance(uint64_t rawBalance) {
+  portENTER_CRITICAL(&accountViewMux);
+  displayedTokenBalance = rawBalance;
+  tokenBalanceKnown = true;
+  portEXIT_CRITICAL(&accountViewMux);
 }
 
 /*****************************************************************************************
 * Function: Prepare Solana Accounts
 *
-* Description: Prepares the Solana accounts and PDAs
+* Description: Prepares the Solana accounts and PDAs. Derived accounts are loaded from NVS
+*              when they were computed for the same keys before, otherwise they are derived
+*              (and the ATA looked up) and stored for the next boot
 * Parameters: None
-* Returns: None
+* Returns: bool - True if all accounts are available, false otherwise
 *****************************************************************************************/ 
 bool prepareSolanaAccounts(){
 
   // Prepare accounts and signer
   owner = Pubkey::fromBase58(PUBLIC_KEY);
-  signer = Keypair::fromPrivateKey(PRIVATE_KEY);
   mint = Pubkey::fromBase58(TOKEN_MINT);
+  uint8_t secretKey[SIGNER_SECRET_KEY_SIZE];
+  bool keyValid = base58DecodeFixed(PRIVATE_KEY, secretKey, sizeof(secretKey)) &&
+                  memcmp(secretKey + SIGNER_SEED_SIZE, owner.data.data(), SOLANA_PUBKEY_SIZE) == 0 &&
+                  signerBegin(secretKey);
+  memset(secretKey, 0, sizeof(secretKey));
+  if (!keyValid) {
+    LOG_ERROR("❌ PRIVATE_KEY is not the 64-byte secret key of PUBLIC_KEY\n");
+    return false;
+  }
+  LOG_INFO("✅ Signer ready (%s)\n", signerBackend());
   
   // Prepare program ID
   programId = base58ToPubkey(PROGRAM_ID);
 
+  // Use the derived accounts from NVS if they match the current keys
+  uint8_t inputsHash[32];
+  hashAccountInputs(inputsHash);
+  if (loadSolanaAccounts(inputsHash)) {
+    LOG_INFO("✅ Solana accounts loaded from NVS\n");
+    return prepareTransactionTemplates();
+  }
+
   // Find Heartbeat Account PDA
-  std::vector<uint8_t> accountPda;
-  // Prepare seeds: 
-  std::vector<std::vector<uint8_t>> seeds = {
-    {'h','e','a','r','t','b','e','a','t'},
-    base58ToPubkey(PUBLIC_KEY)
+  const PdaSeed accountSeeds[] = {
+    { (const uint8_t*)"heartbeat", 9 },
+    { owner.data.data(), SOLANA_PUBKEY_SIZE }
   };
+  uint8_t address[SOLANA_PUBKEY_SIZE];
   uint8_t bump;
-  if (!solana.findProgramAddress(seeds, programId, accountPda, bump)) {
-      Serial.println("❌ Failed to find Heartbeat Account PDA.");
+  if (!pdaFind(accountSeeds, 2, programId.data(), address, &bump)) {
+      LOG_ERROR("❌ Failed to find Heartbeat Account PDA.\n");
       return false;
   }
-  accountPdaPubkey.data = accountPda;
+  accountPdaPubkey.data.assign(address, address + SOLANA_PUBKEY_SIZE);
 
   // Find Mint Authority PDA
-  std::vector<uint8_t> mintAuthorityPda;
-  // Prepare seeds: 
-  std::vector<std::vector<uint8_t>> seeds2 = {
-    {'a','u','t','h','o','r','i','t','y'}
+  const PdaSeed authoritySeeds[] = {
+    { (const uint8_t*)"authority", 9 }
   };
-  uint8_t bump2;
-  if (!solana.findProgramAddress(seeds2, programId, mintAuthorityPda, bump2)) {
-    Serial.println("❌ Failed to find program address for Mint Authority!");
+  if (!pdaFind(authoritySeeds, 1, programId.data(), address, &bump)) {
+    LOG_ERROR("❌ Failed to find program address for Mint Authority!\n");
     return false;
   }
-  mintAuthorityPdaPubkey.data = mintAuthorityPda;
+  mintAuthorityPdaPubkey.data.assign(address, address + SOLANA_PUBKEY_SIZE);
 
   // Find Associated Token Account
   if (!solana.findAssociatedTokenAccount(PUBLIC_KEY, TOKEN_MINT, tokenAccountAddress)) {
-      Serial.println("❌ Failed to find ATA.");
+      LOG_ERROR("❌ Failed to find ATA.\n");
       return false;
   }
   tokenAccount = Pubkey::fromBase58(tokenAccountAddress);
 
+  storeSolanaAccounts(inputsHash);
+  return prepareTransactionTemplates();
+
+}
+
+/*****************************************************************************************
+* Function: Hash Account Inputs
+*
+* Description: SHA-256 over the keys the derived accounts depend on
+* Parameters: hash - 32-byte output buffer
+* Returns: None
+*****************************************************************************************/ 
+void hashAccountInputs(uint8_t* hash) {
+  const char* inputs[] = { PUBLIC_KEY, PROGRAM_ID, TOKEN_MINT };
+  mbedtls_sha256_context ctx;
+  mbedtls_sha256_init(&ctx);
+  mbedtls_sha256_starts_ret(&ctx, 0);
+  for (const char* input : inputs) {
+    mbedtls_sha256_update_ret(&ctx, (const uint8_t*)input, strlen(input) + 1);  // include terminator as separator
+  }
+  mbedtls_sha256_finish_ret(&ctx, hash);
+  mbedtls_sha256_free(&ctx);
+}
+
+/*****************************************************************************************
+* Function: Load Solana Accounts
+*
+* Description: Loads the derived PDAs and ATA from NVS
+* Parameters: inputsHash - hash of the current keys, must match the stored one
+* Returns: bool - True if valid cached accounts were loaded, false otherwise
+*****************************************************************************************/ 
+bool loadSolanaAccounts(const uint8_t* inputsHash) {
+  if (!accountCache.begin(ACCOUNT_CACHE_NAMESPACE, true)) {
+    return false;
+  }
+
+  uint8_t storedHash[32];
+  std::vector<uint8_t> accountPda(SOLANA_PUBKEY_SIZE);
+  std::vector<uint8_t> mintAuthorityPda(SOLANA_PUBKEY_SIZE);
+  bool valid = accountCache.getBytes("inputs", storedHash, sizeof(storedHash)) == sizeof(storedHash) &&
+               memcmp(storedHash, inputsHash, sizeof(storedHash)) == 0 &&
+               accountCache.getBytes("pda", accountPda.data(), SOLANA_PUBKEY_SIZE) == SOLANA_PUBKEY_SIZE &&
+               accountCache.getBytes("authority", mintAuthorityPda.data(), SOLANA_PUBKEY_SIZE) == SOLANA_PUBKEY_SIZE;
+  String ata = valid ? accountCache.getString("ata", "") : String("");
+  accountCache.end();
+
+  if (!valid || ata.isEmpty()) {
+    return false;
+  }
+  accountPdaPubkey.data = accountPda;
+  mintAuthorityPdaPubkey.data = mintAuthorityPda;
+  tokenAccountAddress = ata;
+  tokenAccount = Pubkey::fromBase58(tokenAccountAddress);
   return true;
+}
 
+/*****************************************************************************************
+* Function: Store Solana Accounts
+*
+* Description: Stores the derived PDAs and ATA in NVS together with the hash of their inputs
+* Parameters: inputsHash - hash of the keys the accounts were derived from
+* Returns: None
+*****************************************************************************************/ 
+void storeSolanaAccounts(const uint8_t* inputsHash) {
+  if (!accountCache.begin(ACCOUNT_CACHE_NAMESPACE, false)) {
+    LOG_ERROR("❌ Failed to open NVS, accounts not cached\n");
+    return;
+  }
+  // Invalidate first so a partial write is never taken for a valid entry
+  accountCache.remove("inputs");
+  accountCache.putBytes("pda", accountPdaPubkey.data.data(), SOLANA_PUBKEY_SIZE);
+  accountCache.putBytes("authority", mintAuthorityPdaPubkey.data.data(), SOLANA_PUBKEY_SIZE);
+  accountCache.putString("ata", tokenAccountAddress);
+  accountCache.putBytes("inputs", inputsHash, 32);
+  accountCache.end();
 }
 
 /*****************************************************************************************
-* Function: Convert vector to Hex
+* Function: Print Hex
 *
-* Description: Auxiliary function to convert std::vector<uint8_t> to hex string  
-* Parameters: data - vector of bytes to convert
-* Returns: String - hex encoded string
+* Description: Auxiliary function to print std::vector<uint8_t> as hex to the serial monitor
+* Parameters: data - vector of bytes to print (up to 64)
+* Returns: None
 *****************************************************************************************/ 
-String vectorToHex(const std::vector<uint8_t>& data) {
-  String result = "";
-  for (int i = 0; i < data.size(); i++) {
-    if (data[i] < 16) result += "0";
-    result += String(data[i], HEX);
+void printHex(const std::vector<uint8_t>& data) {
+  char hex[2 * 64 + 1];
+  size_t length = min(data.size(), (size_t)64);
+  for (size_t i = 0; i < length; i++) {
+    snprintf(hex + 2 * i, 3, "%02x", data[i]);
   }
-  return result;
+  hex[2 * length] = '\0';
+  LOG_INFO("%s\n", hex);
 }
 
 /*****************************************************************************************
@@ -468,119 +788,484 @@ String vectorToHex(const std::vector<uint8_t>& data) {
 * Returns: None
 *****************************************************************************************/ 
 void printSolanaAccounts() {
-  Serial.println("\n=== Heartbeat Account PDA (hex) ===");
-  Serial.println(vectorToHex(accountPdaPubkey.data));
+  LOG_INFO("\n=== Heartbeat Account PDA (hex) ===\n");
+  printHex(accountPdaPubkey.data);
   
-  Serial.println("\n=== Mint Authority PDA (hex) ===");
-  Serial.println(vectorToHex(mintAuthorityPdaPubkey.data));
+  LOG_INFO("\n=== Mint Authority PDA (hex) ===\n");
+  printHex(mintAuthorityPdaPubkey.data);
   
-  Serial.println("\n=== Associated Token Account ===");
-  Serial.println(tokenAccountAddress);
+  LOG_INFO("\n=== Associated Token Account ===\n");
+  LOG_INFO("%s\n", tokenAccountAddress.c_str());
 }
 
 
 /*****************************************************************************************
-* Function: Send Heart Rate Reading
+* Function: Prepare Transaction Templates
 *
-* Description: 
-* Parameters: heartRate - current heart rate reading (float)
+* Description: Builds the log_heartbeat and mint_reward transaction templates, and the
+*              merged one carrying both. Account layouts are computed once here instead
+*              of on every send, discriminators are compile-time constants
+* Parameters: None
+* Returns: bool - True if all three templates were built, false otherwise
+*****************************************************************************************/ 
+bool prepareTransactionTemplates() {
+  TemplateAccount logAccounts[] = {
+    { owner.data.data(), true, true },
+    { accountPdaPubkey.data.data(), false, true },
+    { SYSTEM_PROGRAM_ID.data.data(), false, false }    // System Program
+  };
+  if (!txTemplateBuild(&logHeartbeatTemplate, logAccounts, 3, programId.data(), LOG_HEARTBEAT_DISCRIMINATOR.bytes)) {
+    LOG_ERROR("❌ Failed to build log_heartbeat template\n");
+    return false;
+  }
+
+  TemplateAccount mintAccounts[] = {
+    { owner.data.data(), true, true },
+    { accountPdaPubkey.data.data(), false, true },
+    { mintAuthorityPdaPubkey.data.data(), false, false },
+    { mint.data.data(), false, true },
+    { tokenAccount.data.data(), false, true },
+    { TOKEN_PROGRAM_ID.data.data(), false, false },    // Token Program
+    { SYSTEM_PROGRAM_ID.data.data(), false, false }    // System Program
+  };
+  if (!txTemplateBuild(&mintRewardTemplate, mintAccounts, 7, programId.data(), MINT_REWARD_DISCRIMINATOR.bytes)) {
+    LOG_ERROR("❌ Failed to build mint_reward template\n");
+    return false;
+  }
+
+  if (!txTemplateBuildMerged(&logAndMintTemplate, logAccounts, 3, LOG_HEARTBEAT_DISCRIMINATOR.bytes,
+                             mintAccounts, 7, MINT_REWARD_DISCRIMINATOR.bytes, programId.data())) {
+    LOG_ERROR("❌ Failed to build log_heartbeat + mint_reward template\n");
+    return false;
+  }
+  return true;
+}
+
+/*****************************************************************************************
+* Function: Send Heart Rate Batch
+*
+* Description: Sends a batch of heart rate readings in a single transaction. Depending on
+*              HEART_RATE_BATCH_PACKED the readings go into one log_heartbeat_batch
+*              instruction (with their age in ms) or into one log_heartbeat instruction each
+*              (log_heartbeat_summary with HEART_RATE_SUMMARY_UPLOAD); with
+*              HEART_RATE_BATCH_COMPACT into one log_heartbeat_compact instruction in the
+*              heartbeat codec format. A requested reward mint rides along when the batch
+*              leaves room for it
+* Parameters: readings - buffered heart rate readings
+*             count - number of readings (at most HEART_RATE_BATCH_TX_CAPACITY)
+*             signature - destination for the base58 signature (SIGNATURE_BASE58_SIZE)
 * Returns: bool - True if transaction is successful, false otherwise
 *****************************************************************************************/ 
-bool sendHeartRateReading(float heartRate) {
-
-  // Prepare instruction
-  std::vector<uint8_t> discriminator = solana.calculateDiscriminator("log_heartbeat");
-  std::vector<uint8_t> data = discriminator;
-
-  // Prepare payload (heart rate as float32 little-endian)
-  std::vector<uint8_t> payload(4);
-  memcpy(payload.data(), &heartRate, sizeof(float));
-  data.insert(data.end(), payload.begin(), payload.end());
-
-  Instruction ix(
-    Pubkey{programId},
-    std::vector<AccountMeta>{
-      AccountMeta::signer(owner),
-      AccountMeta::writable(accountPdaPubkey, false),
-      AccountMeta{SYSTEM_PROGRAM_ID, false, false}   // System Program
-    },
-    data
-  );
+bool sendHeartRateBatch(const HeartRateReading* readings, size_t count, char* signature) {
+  static uint8_t payload[LOG_HEARTBEAT_PAYLOAD_SIZE];
+
+#if HEART_RATE_BATCH_COMPACT
+  size_t length = heartbeatPayloadCompact(readings, count, millis(), HEART_RATE_CODEC_FLAGS, payload, sizeof(payload));
+  size_t instructionCount = 1;
+  if (length == 0) {
+    LOG_ERROR("❌ Batch does not fit in a transaction!\n");
+    return false;
+  }
+#elif HEART_RATE_BATCH_PACKED
+  size_t length = heartbeatPayloadPacked(readings, count, millis(), payload);
+  size_t instructionCount = 1;
+#elif HEART_RATE_SUMMARY_UPLOAD
+  // One instruction per reading, carrying its window summary
+  size_t length = heartbeatPayloadSummary(readings, count, payload);
+  size_t instructionCount = count;
+#else
+  // One instruction per reading
+  size_t length = heartbeatPayloadSingle(readings, count, payload);
+  size_t instructionCount = count;
+#endif
+
+  bool withMint = rewardsMintDue() &&
+                  txTemplateSetInstructions(&logAndMintTemplate, payload, length, instructionCount);
+  TxTemplate* tpl = withMint ? &logAndMintTemplate : &logHeartbeatTemplate;
+  if (!withMint && !txTemplateSetInstructions(tpl, payload, length, instructionCount)) {
+    LOG_ERROR("❌ Batch does not fit in a transaction!\n");
+    return false;
+  }
 
-  Transaction tx;
-    tx.fee_payer = owner;
-    tx.recent_blockhash = solana.getLatestBlockhash();
-    if (tx.recent_blockhash.isEmpty()) {
-        Serial.println("❌ Failed to get blockhash!");
-        return false;
-    }
-    tx.add(ix);
-    tx.sign({signer});
-    String txBase64 = tx.serializeBase64();
+  bool sent = submitTemplate(tpl, signature);
+  if (sent && withMint) {
+    LOG_INFO("✅ Reward mint merged into heart rate batch\n");
+    rewardsMintSent();
+  }
+  return sent;
+}
 
-    String txSig;
-    if (solana.sendRawTransaction(txBase64, txSig)) {
-        Serial.println("✅ Anchor tx sent! Signature: " + txSig);
-    } else {
-        Serial.println("❌ Anchor tx failed.");
-        return false;
+/*****************************************************************************************
+* Function: Resend Heart Rate Batch
+*
+* Description: Sends a batch again after its transaction was dropped or rate limited, once
+*              the upload schedule allows. The cached blockhash is refreshed first, the
+*              dropped transaction may have expired with it
+* Parameters: readings - readings of the dropped batch
+*             count - number of readings
+*             signature - destination for the new base58 signature
+* Returns: bool - True if transaction is successful, false otherwise
+*****************************************************************************************/ 
+bool resendHeartRateBatch(const HeartRateReading* readings, size_t count, char* signature) {
+  if (uploadScheduleMsUntilDue() > 0) {
+    return false;
+  }
+  blockhashCacheInvalidate();
+  bool sent = sendHeartRateBatch(readings, count, signature);
+  uploadScheduleSent(sent, storePending() > 0);
+  return sent;
+}
+
+/*****************************************************************************************
+* Function: Submit Template
+*
+* Description: Patches the cached blockhash into a template, signs, encodes and sends it
+* Parameters: tpl - transaction template with its instructions already set
+*             signature - destination for the base58 signature (SIGNATURE_BASE58_SIZE)
+* Returns: bool - True if transaction is successful, false otherwise
+*****************************************************************************************/ 
+bool submitTemplate(TxTemplate* tpl, char* signature) {
+  static char txBase64[TX_BASE64_SIZE];
+  uint8_t blockhash[SOLANA_PUBKEY_SIZE];
+
+  if (!blockhashCacheGet(blockhash)) {
+    LOG_ERROR("❌ Failed to get blockhash!\n");
+    instrumentCount(COUNTER_TX_FAILURES);
+    return false;
+  }
+
+  uint32_t stageStart = instrumentStart();
+  txTemplateSetBlockhash(tpl, blockhash);
+  instrumentStop(STAGE_SERIALIZE, stageStart);
+
+  stageStart = instrumentStart();
+  txTemplateSign(tpl);
+  instrumentStop(STAGE_SIGN, stageStart);
+
+  stageStart = instrumentStart();
+  size_t encodedLength = txTemplateBase64(tpl, txBase64, sizeof(txBase64));
+  instrumentStop(STAGE_SERIALIZE, stageStart);
+  if (encodedLength == 0) {
+    LOG_ERROR("❌ Failed to encode transaction!\n");
+    instrumentCount(COUNTER_TX_FAILURES);
+    return false;
+  }
+
+  stageStart = instrumentStart();
+  bool sent = rpcSendRawTransaction(txBase64, signature, SIGNATURE_BASE58_SIZE);
+  instrumentStop(STAGE_RPC_SUBMIT, stageStart);
+  if (sent) {
+    LOG_INFO("✅ Anchor tx sent! Signature: %s\n", signature);
+  } else {
+    LOG_ERROR("❌ Anchor tx failed.\n");
+    instrumentCount(COUNTER_TX_FAILURES);
+    blockhashCacheInvalidate();
+    return false;
+  }
+  return true;
+}
+
+/*****************************************************************************************
+* Function: Handle Serial Commands
+*
+* Description: Runs the commands received on the serial monitor since the last call
+* Parameters: None
+* Returns: None
+*****************************************************************************************/ 
+void handleSerialCommands() {
+  while (Serial.available() > 0) {
+    switch (Serial.read()) {
+      case SERIAL_COMMAND_STATS:
+        instrumentPrint();
+        break;
+      case SERIAL_COMMAND_CAPTURE:
+        if (captureActive()) {
+          captureStop();
+        } else {
+          captureStart();
+        }
+        break;
+      default:
+        break;
     }
-    return true;
+  }
 }
 
 /*****************************************************************************************
-* Function: Mint Rewards
+* Function: Time Until Next Deadline
 *
-* Description: 
+* Description: Computes how long the loop can block before the next blink, heart rate update
+*              or send is due (each fires once its interval is strictly exceeded)
 * Parameters: None
-* Returns: bool - True if transaction is successful, false otherwise
+* Returns: unsigned long - ms until the earliest deadline, 0 if one is already due
 *****************************************************************************************/ 
-bool mintRewards() {
+unsigned long msUntilNextDeadline() {
+  unsigned long now = millis();
+  unsigned long deadlines[] = {
+    lastBlinkTime + BLINK_TIME_MS + 1,
+    lastHeartRateTime + HEART_RATE_UPDATE_TIME_MS + 1,
+    pdaSuccess ? lastHeartRateSendTime + HEART_RATE_SEND_TIME_MS + 1 : now + HEART_RATE_SEND_TIME_MS
+  };
 
-  // Prepare instruction
-  std::vector<uint8_t> discriminator = solana.calculateDiscriminator("mint_reward");
+  unsigned long waitMs = HEART_RATE_SEND_TIME_MS;
+  for (unsigned long deadline : deadlines) {
+    long remaining = (long)(deadline - now);
+    if (remaining <= 0) {
+      return 0;
+    }
+    waitMs = min(waitMs, (unsigned long)remaining);
+  }
+  return waitMs;
+}
 
-  // No payload (data = discriminator)
+/*****************************************************************************************
+* Function: Start Network Task
+*
+* Description: Creates the reading/result queues and starts the network task pinned to
+*              NETWORK_TASK_CORE, so RPC round-trips never block sampling on the loop core
+* Parameters: None
+* Returns: bool - True if queues and task were created, false otherwise
+*****************************************************************************************/ 
+bool startNetworkTask() {
+  blockhashCacheBegin();
+  storeBegin();
+  pipelineBegin(resendHeartRateBatch);
+  rewardsBegin(accountPdaPubkey.data.data());
+  uploadScheduleBegin(owner.data.data());
+  if (!wsSubscribeAccount(tokenAccount.data.data(), SPL_TOKEN_AMOUNT_OFFSET, sizeof(uint64_t), onTokenBalancePushed)) {
+    LOG_ERROR("❌ Failed to subscribe to token account\n");
+  }
+  heartRateQueue = xQueueCreate(HEART_RATE_QUEUE_LENGTH, sizeof(HeartRateReading));
+  txResultQueue = xQueueCreate(TX_RESULT_QUEUE_LENGTH, sizeof(TxResult));
+  if (heartRateQueue == NULL || txResultQueue == NULL) {
+    return false;
+  }
 
-  Instruction ix(
-    Pubkey{programId},
-    std::vector<AccountMeta>{
-      AccountMeta::signer(owner),
-      AccountMeta::writable(accountPdaPubkey, false),
-      AccountMeta{mintAuthorityPdaPubkey, false, false},
-      AccountMeta::writable(mint, false),
-      AccountMeta::writable(tokenAccount, false),
-      AccountMeta{TOKEN_PROGRAM_ID, false, false},   // Token Program
-      AccountMeta{SYSTEM_PROGRAM_ID, false, false}   // System Program
-    },
-    discriminator
+  BaseType_t created = xTaskCreatePinnedToCore(
+    networkTask,
+    "networkTask",
+    NETWORK_TASK_STACK_SIZE,
+    NULL,
+    NETWORK_TASK_PRIORITY,
+    &networkTaskHandle,
+    NETWORK_TASK_CORE
   );
+  return created == pdPASS;
+}
+
+/*****************************************************************************************
+* Function: Network Task
+*
+* Description: Persists heart rate readings from heartRateQueue in the reading store and
+*              uploads them once a batch is full (HEART_RATE_BATCH_SIZE or the transaction
+*              size limit) or HEART_RATE_BATCH_FLUSH_MS after the first pending reading.
+*              Uploads go out in the device's slot of the upload schedule (never sooner than
+*              the program's rate limit after the last one); failed uploads stay in the
+*              store and are retried after a jittered exponential backoff, and a backlog
+*              larger than one batch is drained in HEART_RATE_DRAIN_BATCH_SIZE transactions,
+*              one per slot. Without a WiFi link uploads are postponed (not
+*              attempted) until the WiFi manager reports the link back. Sent transactions
+*              stay in the pipeline (readings reserved in the store) until confirmed; up to
+*              TX_PIPELINE_WINDOW are in flight, and the radio stays up until all of them
+*              are resolved. Reward points are checked while the radio is available and a
+*              due mint goes out with the next batch. In modem sleep mode the RPC WebSocket
+*              stays connected and is read every WS_SERVICE_MS, so points, token balance
+*              and confirmations are pushed instead of polled. Send outcomes are reported
+*              on txResultQueue
+* Parameters: parameter - unused
+* Returns: None
+*****************************************************************************************/ 
+void networkTask(void* parameter) {
+  static HeartRateReading batch[HEART_RATE_BATCH_TX_CAPACITY];
+  unsigned long pendingSince = millis();    // Readings restored from flash count from boot
+  bool draining = false;
+  bool unstored = false;                    // batch[0] holds a reading the store rejected
+  bool linkDown = false;                    // Last upload postponed for lack of a link
+  unsigned long postponedTime = 0;
+
+  for (;;) {
+    // Wait for the next reading, but no longer than until an upload is due or the cached
+    // blockhash needs a refresh (if the radio is available)
+    bool idleRefresh = powerRadioIdleAvailable();
+    unsigned long waitMs = idleRefresh ? min(blockhashCacheMsUntilRefresh(), rewardsMsUntilCheck()) : HEART_RATE_BATCH_FLUSH_MS;
+    bool waitForever = !idleRefresh;
+    uint32_t pending = storePending();
+    if (pending > 0 && !pipelineFull()) {
+      unsigned long now = millis();
+      unsigned long dueMs = 0;
+      if (!draining && pending < HEART_RATE_BATCH_CAPACITY && now - pendingSince < HEART_RATE_BATCH_FLUSH_MS) {
+        dueMs = HEART_RATE_BATCH_FLUSH_MS - (now - pendingSince);
+      }
+      dueMs = max(dueMs, uploadScheduleMsUntilDue());
+      waitMs = min(waitMs, dueMs);
+      waitForever = false;
+    } else if (unstored) {
+      waitMs = min(waitMs, uploadScheduleMsUntilDue());
+      waitForever = false;
+    }
+    if (linkDown) {
+      // Modem sleep keeps the manager reconnecting, so watch the link; with the radio off
+      // only a new attempt can tell
+      unsigned long sincePostponed = millis() - postponedTime;
+      unsigned long linkMs = idleRefresh ? LINK_CHECK_MS :
+                             (sincePostponed >= UPLOAD_RETRY_MS ? 0 : UPLOAD_RETRY_MS - sincePostponed);
+      waitMs = min(waitMs, linkMs);
+      waitForever = false;
+    }
+    if (pipelineInFlight() > 0) {
+      waitMs = min(waitMs, pipelineMsUntilPoll());
+      waitForever = false;
+    }
+    if (idleRefresh) {
+      waitMs = min(waitMs, (unsigned long)(wsConnected() ? WS_SERVICE_MS : WS_RECONNECT_MS));
+      waitForever = false;
+    }
 
-  Transaction tx;
-    tx.fee_payer = owner;
-    tx.recent_blockhash = solana.getLatestBlockhash();
-    if (tx.recent_blockhash.isEmpty()) {
-        Serial.println("❌ Failed to get blockhash!");
-        return false;
+    HeartRateReading reading;
+    if (xQueueReceive(heartRateQueue, &reading, waitForever ? portMAX_DELAY : pdMS_TO_TICKS(waitMs)) == pdTRUE) {
+      if (storePending() == 0) {
+        pendingSince = millis();
+      }
+      if (!storeAppend(reading)) {
+        // Without the store the reading is still sent, just not kept across failures
+        LOG_ERROR("❌ Failed to store heart rate reading, sending it unbuffered\n");
+        batch[0] = reading;
+        unstored = true;
+      }
     }
-    tx.add(ix);
-    tx.sign({signer});
-    String txBase64 = tx.serializeBase64();
 
-    String txSig;
-    if (solana.sendRawTransaction(txBase64, txSig)) {
-        Serial.println("✅ Anchor tx sent! Signature: " + txSig);
-    } else {
-        Serial.println("❌ Anchor tx failed.");
-        return false;
+    // Pushed notifications (only while the radio stays available between uploads)
+    if (idleRefresh) {
+      wsService();
     }
-    return true;
+
+    // Confirm what is in flight; the radio was left up for it
+    if (pipelineInFlight() > 0 && pipelineMsUntilPoll() == 0) {
+      pipelineService();
+      if (pipelineInFlight() == 0) {
+        powerRadioDown();
+      }
+    }
+
+    pending = storePending();
+    unsigned long now = millis();
+    bool uploadDue = (unstored ||
+                      (pending > 0 &&
+                       (draining || pending >= HEART_RATE_BATCH_CAPACITY || now - pendingSince >= HEART_RATE_BATCH_FLUSH_MS))) &&
+                     uploadScheduleMsUntilDue() == 0;
+    if (linkDown) {
+      linkDown = idleRefresh ? !wifiLinkUp() : now - postponedTime < UPLOAD_RETRY_MS;
+      uploadDue = uploadDue && !linkDown;
+    }
+    if (!uploadDue || pipelineFull()) {
+      // Idle: keep the blockhash fresh so the next submit does not wait for it, and check
+      // the reward points
+      if (idleRefresh && wifiLinkUp()) {
+        blockhashCacheService();
+        rewardsService();
+      }
+      portENTER_CRITICAL(&accountViewMux);
+      displayedPoints = rewardsPoints();
+      portEXIT_CRITICAL(&accountViewMux);
+      continue;
+    }
+
+    // A backlog larger than one batch goes out in large transactions until it is cleared
+    draining = !unstored && (draining || pending > HEART_RATE_BATCH_CAPACITY);
+    size_t count = unstored ? 1 : storePeek(batch, draining ? HEART_RATE_DRAIN_CAPACITY : HEART_RATE_BATCH_CAPACITY);
+#if HEART_RATE_BATCH_COMPACT
+    // Compact entries vary in size: cut the batch to what one transaction holds
+    size_t fit = heartbeatCodecFit(batch, count, HEART_RATE_CODEC_FLAGS, LOG_HEARTBEAT_READINGS_BYTES);
+    if (!unstored && fit < count) {
+      count = storePeek(batch, fit);
+    }
+#endif
+    if (count == 0) {
+      pipelineAddSlots(storeReservePeeked()); // Only corrupt records
+      continue;
+    }
+
+    unsigned long startTime = millis();
+    if (!powerRadioUp()) {
+      // No link: keep the readings and try again once the WiFi manager has reconnected
+      if (pipelineInFlight() == 0) {
+        powerRadioDown();
+      }
+      LOG_INFO("WiFi link down, upload of %u readings postponed\n", (unsigned)count);
+      linkDown = true;
+      postponedTime = millis();
+      continue;
+    }
+
+    if (uploadScheduleFailures() > 0) {
+      instrumentCount(COUNTER_UPLOAD_RETRIES);
+    }
+    HeapSnapshot heapBefore = heapSnapshot();
+    char signature[SIGNATURE_BASE58_SIZE];
+    bool mintRequested = rewardsMintDue();
+    TxResult result;
+    result.success = sendHeartRateBatch(batch, count, signature);
+    result.readingCount = count;
+    result.durationMs = millis() - startTime;
+
+    uploadScheduleSent(result.success, !unstored && pending > count);
+    if (result.success) {
+      pipelineAdd(batch, count, unstored ? 0 : storeReservePeeked(), signature);
+    }
+
+    // The radio is up anyway: check the points, and mint on its own if the batch had no
+    // room for it (after a backlog, whose full batches never have)
+    rewardsService();
+    if (result.success && mintRequested && rewardsMintDue() && !draining) {
+      mintRewards();
+    }
+    if (pipelineInFlight() == 0) {
+      powerRadioDown();
+    }
+    portENTER_CRITICAL(&accountViewMux);
+    displayedPoints = rewardsPoints();
+    portEXIT_CRITICAL(&accountViewMux);
+    if (unstored) {
+      unstored = false;
+    } else if (result.success) {
+      pendingSince = millis();
+      draining = draining && storePending() > 0;
+    }
+    LOG_DEBUG("Pending readings: %u, in flight: %u, dropped: %u\n", storePending(), storeReserved(), storeDropped());
+    LOG_DEBUG("Blockhash cache hits: %u, misses: %u\n", blockhashCacheHits(), blockhashCacheMisses());
+    printRpcStats();
+    printHeapReport("network cycle", heapBefore);
+    if (xQueueSend(txResultQueue, &result, 0) != pdTRUE) {
+      LOG_ERROR("❌ Tx result queue full, result dropped\n");
+    }
+  }
+}
+
+/*****************************************************************************************
+* Function: Mint Rewards
+*
+* Description: Sends a standalone mint_reward transaction (when a requested mint could not
+*              be merged into a heart rate batch)
+* Parameters: None
+* Returns: bool - True if transaction is successful, false otherwise
+*****************************************************************************************/ 
+bool mintRewards() {
+
+  static char signature[SIGNATURE_BASE58_SIZE];
+
+  // No payload (data = discriminator)
+  txTemplateSetInstructions(&mintRewardTemplate, NULL, 0, 1);
+  if (!submitTemplate(&mintRewardTemplate, signature)) {
+    return false;
+  }
+  rewardsMintSent();
+  return true;
 }
 
 /*****************************************************************************************
 * Function: Initialize Display
 *
-* Description: Initializes the OLED display with I2C communication
+* Description: Initializes the OLED display with I2C communication and starts the renderer
 * Parameters: None
 * Returns: None
 *****************************************************************************************/ 
@@ -590,7 +1275,10 @@ void initializeDisplay() {
   
   // Initialize display
   if(!display.begin(SSD1306_SWITCHCAPVCC, SCREEN_ADDRESS)) {
-    Serial.println("\n❌ OLED Display initialization failed!\n");
+    LOG_ERROR("\n❌ OLED Display initialization failed!\n\n");
+    return;
+  }
+  if (!rendererBegin(&display, SCREEN_ADDRESS)) {
     return;
   }
   
@@ -605,9 +1293,9 @@ void initializeDisplay() {
   display.println("Monitor");
   display.setTextSize(1);
   display.println("\nInitializing...");
-  display.display();
+  rendererCommit();
   
-  Serial.println("\n✅ OLED Display initialized successfully!\n");
+  LOG_INFO("\n✅ OLED Display initialized successfully!\n\n");
 }
 
 /*****************************************************************************************
@@ -640,14 +1328,27 @@ void displayHeartRate(float heartRate) {
     display.print("_/\\  _");
     display.setCursor(39, 45);
     display.print("   \\/");
-    display.display();
     heartRateDisplay = 1;
   } else {
     display.print(" ");
     heartRateDisplay = 0;
   }
+
+  // Reward points and token balance (pushed by the RPC WebSocket)
+  portENTER_CRITICAL(&accountViewMux);
+  uint64_t points = displayedPoints;
+  uint64_t tokenBalance = displayedTokenBalance;
+  bool balanceKnown = tokenBalanceKnown;
+  portEXIT_CRITICAL(&accountViewMux);
+  display.setCursor(0, 56);
+  display.print("Pts ");
+  display.print((unsigned long)points);
+  if (balanceKnown) {
+    display.print("  Tok ");
+    display.print((float)tokenBalance / TOKEN_DECIMALS_DIVISOR, 2);
+  }
   
-  display.display();
+  rendererCommit();
 }
 
 /*****************************************************************************************
@@ -673,7 +1374,7 @@ void displayWiFiStatus() {
     display.println("Status: Connecting...");
   }
   
-  display.display();
+  rendererCommit();
 }
 
 /*****************************************************************************************
@@ -681,9 +1382,10 @@ void displayWiFiStatus() {
 *
 * Description: Displays any string message on the OLED display
 * Parameters: message - string to display on OLED
+*             line - text line (0-5) to start on
 * Returns: None
 *****************************************************************************************/ 
-void displayMessage(String message, int line) {
+void displayMessage(const char* message, int line) {
   if (line < 0) {
     line = 0;
   }
@@ -695,5 +1397,5 @@ void displayMessage(String message, int line) {
   display.setTextColor(SSD1306_WHITE);
   display.setCursor(0, line*10);
   display.println(message);
-  display.display();
+  rendererCommit();
 }
\ No newline at end of file
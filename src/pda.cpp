@@ -0,0 +1,282 @@
+/*****************************************************************************************
+ * Program Derived Addresses
+ *
+ * The curve check is the point decompression test of the Solana runtime: y is a valid
+ * Ed25519 coordinate when (y^2 - 1) / (d*y^2 + 1) has a square root mod 2^255 - 19. Field
+ * elements use sixteen 16-bit limbs in int64_t (TweetNaCl layout); speed matters little
+ * here, one check is a single exponentiation and a search rarely needs more than a few.
+ *
+ *****************************************************************************************/
+
+#include "pda.h"
+#include <string.h>
+#include "mbedtls/sha256.h"
+
+#define PDA_PROGRAM_ID_SIZE 32
+#define PDA_MARKER "ProgramDerivedAddress"
+#define PDA_MARKER_LENGTH (sizeof(PDA_MARKER) - 1)
+#define PDA_PREIMAGE_SIZE (PDA_MAX_SEEDS * PDA_MAX_SEED_LENGTH + 1 + PDA_PROGRAM_ID_SIZE + PDA_MARKER_LENGTH)
+
+typedef int64_t FieldElement[16];
+
+static const FieldElement curveD = {
+  0x78a3, 0x1359, 0x4dca, 0x75eb, 0xd8ab, 0x4141, 0x0a4d, 0x0070,
+  0xe898, 0x7779, 0x4079, 0x8cc7, 0xfe73, 0x2b6f, 0x6cee, 0x5203
+};
+static const FieldElement fieldOne = { 1 };
+
+static void fieldCarry(FieldElement o);
+static void fieldSelect(FieldElement p, FieldElement q, int64_t swap);
+static void fieldPack(uint8_t* output, const FieldElement n);
+static void fieldUnpack(FieldElement o, const uint8_t* n);
+static bool fieldIsZero(const FieldElement a);
+static void fieldAdd(FieldElement o, const FieldElement a, const FieldElement b);
+static void fieldSub(FieldElement o, const FieldElement a, const FieldElement b);
+static void fieldMul(FieldElement o, const FieldElement a, const FieldElement b);
+static void fieldPow2523(FieldElement o, const FieldElement i);
+
+/*****************************************************************************************
+* Function: PDA Find
+*
+* Description: Finds the program derived address for the seeds, trying bumps from 255 down
+* Parameters: seeds - seed list, at most PDA_MAX_SEEDS of at most PDA_MAX_SEED_LENGTH bytes
+*             seedCount - number of seeds
+*             programId - 32-byte program id
+*             address - 32-byte output
+*             bump - output, bump seed of the address
+* Returns: bool - True if an address was found, false for invalid seeds or no valid bump
+*****************************************************************************************/
+bool pdaFind(const PdaSeed* seeds, size_t seedCount, const uint8_t* programId,
+             uint8_t* address, uint8_t* bump) {
+  uint8_t preimage[PDA_PREIMAGE_SIZE];
+  size_t length = 0;
+
+  if (seedCount >= PDA_MAX_SEEDS) {                     // The bump counts as a seed
+    return false;
+  }
+  for (size_t i = 0; i < seedCount; i++) {
+    if (seeds[i].length > PDA_MAX_SEED_LENGTH) {
+      return false;
+    }
+    memcpy(preimage + length, seeds[i].data, seeds[i].length);
+    length += seeds[i].length;
+  }
+  size_t bumpOffset = length++;
+  memcpy(preimage + length, programId, PDA_PROGRAM_ID_SIZE);
+  length += PDA_PROGRAM_ID_SIZE;
+  memcpy(preimage + length, PDA_MARKER, PDA_MARKER_LENGTH);
+  length += PDA_MARKER_LENGTH;
+
+  for (int candidate = 255; candidate >= 0; candidate--) {
+    preimage[bumpOffset] = (uint8_t)candidate;
+    if (mbedtls_sha256_ret(preimage, length, address, 0) != 0) {
+      return false;
+    }
+    if (!pdaOnCurve(address)) {
+      *bump = (uint8_t)candidate;
+      return true;
+    }
+  }
+  return false;
+}
+
+/*****************************************************************************************
+* Function: PDA On Curve
+*
+* Description: Checks whether 32 bytes decompress to an Ed25519 point
+* Parameters: point - compressed point (y with the sign of x in the top bit)
+* Returns: bool - True if the bytes are a curve point, false otherwise
+*****************************************************************************************/
+bool pdaOnCurve(const uint8_t* point) {
+  FieldElement y, ySquared, u, v, vCubed, x, check;
+
+  fieldUnpack(y, point);
+  fieldMul(ySquared, y, y);
+  fieldSub(u, ySquared, fieldOne);
+  fieldMul(v, curveD, ySquared);
+  fieldAdd(v, v, fieldOne);
+
+  // x = u * v^3 * (u * v^7)^((p - 5) / 8)
+  fieldMul(vCubed, v, v);
+  fieldMul(vCubed, vCubed, v);
+  fieldMul(x, vCubed, vCubed);
+  fieldMul(x, x, v);
+  fieldMul(x, x, u);
+  fieldPow2523(x, x);
+  fieldMul(x, x, vCubed);
+  fieldMul(x, x, u);
+
+  // Square root exists if v * x^2 = u, or = -u (the root is then x * sqrt(-1))
+  fieldMul(check, x, x);
+  fieldMul(check, check, v);
+  FieldElement difference;
+  fieldSub(difference, check, u);
+  if (fieldIsZero(difference)) {
+    return true;
+  }
+  fieldAdd(difference, check, u);
+  return fieldIsZero(difference);
+}
+
+/*****************************************************************************************
+* Function: Field Carry
+*
+* Description: Propagates carries so every limb is back in 16 bits (2^256 wraps to 38)
+* Parameters: o - element, reduced in place
+* Returns: None
+*****************************************************************************************/
+static void fieldCarry(FieldElement o) {
+  for (int i = 0; i < 16; i++) {
+    o[i] += (1LL << 16);
+    int64_t carry = o[i] >> 16;
+    o[(i + 1) * (i < 15)] += carry - 1 + 37 * (carry - 1) * (i == 15);
+    o[i] -= carry << 16;
+  }
+}
+
+/*****************************************************************************************
+* Function: Field Select
+*
+* Description: Swaps p and q when swap is 1
+* Parameters: p - first element
+*             q - second element
+*             swap - 0 or 1
+* Returns: None
+*****************************************************************************************/
+static void fieldSelect(FieldElement p, FieldElement q, int64_t swap) {
+  int64_t mask = ~(swap - 1);
+  for (int i = 0; i < 16; i++) {
+    int64_t t = mask & (p[i] ^ q[i]);
+    p[i] ^= t;
+    q[i] ^= t;
+  }
+}
+
+/*****************************************************************************************
+* Function: Field Pack
+*
+* Description: Fully reduces an element mod p and writes it little-endian
+* Parameters: output - 32-byte output
+*             n - element
+* Returns: None
+*****************************************************************************************/
+static void fieldPack(uint8_t* output, const FieldElement n) {
+  FieldElement t, m;
+  memcpy(t, n, sizeof(t));
+  fieldCarry(t);
+  fieldCarry(t);
+  fieldCarry(t);
+  for (int pass = 0; pass < 2; pass++) {
+    m[0] = t[0] - 0xffed;
+    for (int i = 1; i < 15; i++) {
+      m[i] = t[i] - 0xffff - ((m[i - 1] >> 16) & 1);
+      m[i - 1] &= 0xffff;
+    }
+    m[15] = t[15] - 0x7fff - ((m[14] >> 16) & 1);
+    int64_t borrow = (m[15] >> 16) & 1;
+    m[14] &= 0xffff;
+    fieldSelect(t, m, 1 - borrow);
+  }
+  for (int i = 0; i < 16; i++) {
+    output[2 * i] = (uint8_t)(t[i] & 0xff);
+    output[2 * i + 1] = (uint8_t)(t[i] >> 8);
+  }
+}
+
+/*****************************************************************************************
+* Function: Field Unpack
+*
+* Description: Reads a little-endian element, ignoring the top (sign) bit
+* Parameters: o - element output
+*             n - 32-byte input
+* Returns: None
+*****************************************************************************************/
+static void fieldUnpack(FieldElement o, const uint8_t* n) {
+  for (int i = 0; i < 16; i++) {
+    o[i] = n[2 * i] + ((int64_t)n[2 * i + 1] << 8);
+  }
+  o[15] &= 0x7fff;
+}
+
+/*****************************************************************************************
+* Function: Field Is Zero
+*
+* Description: Checks whether an element is 0 mod p
+* Parameters: a - element
+* Returns: bool - True if zero, false otherwise
+*****************************************************************************************/
+static bool fieldIsZero(const FieldElement a) {
+  uint8_t packed[32];
+  uint8_t bits = 0;
+  fieldPack(packed, a);
+  for (int i = 0; i < 32; i++) {
+    bits |= packed[i];
+  }
+  return bits == 0;
+}
+
+/*****************************************************************************************
+* Function: Field Add / Sub
+*
+* Description: Limb-wise addition and subtraction (carried by the next multiplication)
+* Parameters: o - output
+*             a - first operand
+*             b - second operand
+* Returns: None
+*****************************************************************************************/
+static void fieldAdd(FieldElement o, const FieldElement a, const FieldElement b) {
+  for (int i = 0; i < 16; i++) {
+    o[i] = a[i] + b[i];
+  }
+}
+
+static void fieldSub(FieldElement o, const FieldElement a, const FieldElement b) {
+  for (int i = 0; i < 16; i++) {
+    o[i] = a[i] - b[i];
+  }
+}
+
+/*****************************************************************************************
+* Function: Field Mul
+*
+* Description: Multiplies two elements mod p (output may alias an input)
+* Parameters: o - output
+*             a - first operand
+*             b - second operand
+* Returns: None
+*****************************************************************************************/
+static void fieldMul(FieldElement o, const FieldElement a, const FieldElement b) {
+  int64_t product[31] = {};
+  for (int i = 0; i < 16; i++) {
+    for (int j = 0; j < 16; j++) {
+      product[i + j] += a[i] * b[j];
+    }
+  }
+  for (int i = 0; i < 15; i++) {
+    product[i] += 38 * product[i + 16];
+  }
+  memcpy(o, product, sizeof(FieldElement));
+  fieldCarry(o);
+  fieldCarry(o);
+}
+
+/*****************************************************************************************
+* Function: Field Pow2523
+*
+* Description: Raises an element to (p - 5) / 8 = 2^252 - 3
+* Parameters: o - output (may alias i)
+*             i - base
+* Returns: None
+*****************************************************************************************/
+static void fieldPow2523(FieldElement o, const FieldElement i) {
+  FieldElement base, result;
+  memcpy(base, i, sizeof(base));
+  memcpy(result, i, sizeof(result));
+  for (int bit = 250; bit >= 0; bit--) {
+    fieldMul(result, result, result);
+    if (bit != 1) {
+      fieldMul(result, result, base);
+    }
+  }
+  memcpy(o, result, sizeof(result));
+}
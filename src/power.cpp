@@ -0,0 +1,139 @@
+/*****************************************************************************************
+ * Power
+ *
+ * Light sleep is not used: it halts the APB clock and with it the continuous ADC DMA that
+ * samples the sensor. The loop instead blocks until its next deadline, so the cores spend
+ * the time in the idle task's WAITI (clock gated), and the radio - the largest consumer -
+ * is duty-cycled here.
+ *
+ * Called from the network task only, except powerRadioHold(). A mutex orders a hold
+ * against the network task's radio changes, so an upload ending at the same time cannot
+ * switch a held radio back down. It is not kept while waiting for a link.
+ *
+ *****************************************************************************************/
+
+#include "power.h"
+#include <WiFi.h>
+#include "rpc_client.h"
+#include "wifi_manager.h"
+#include "logger.h"
+
+/*****************************************************************************************
+* Global Variables
+*****************************************************************************************/
+static SemaphoreHandle_t radioMutex = NULL;
+static bool radioHeld = false;          // Radio stays up between uploads
+
+static void lockRadio();
+static void unlockRadio();
+
+/*****************************************************************************************
+* Function: Power Begin
+*
+* Description: Puts the connected radio into max modem sleep (or off) until the first upload
+* Parameters: None
+* Returns: None
+*****************************************************************************************/
+void powerBegin() {
+  radioMutex = xSemaphoreCreateMutex();
+  if (radioMutex == NULL) {
+    LOG_ERROR("❌ Failed to create radio mutex\n");
+  }
+  powerRadioDown();
+}
+
+/*****************************************************************************************
+* Function: Power Radio Up
+*
+* Description: Makes the radio fully available for an upload: leaves modem sleep, or turns
+*              WiFi back on and fast-reconnects to the last access point
+* Parameters: None
+* Returns: bool - True if the link is up, false otherwise
+*****************************************************************************************/
+bool powerRadioUp() {
+#if POWER_RADIO_OFF_BETWEEN_UPLOADS
+  lockRadio();
+  wifiResume();
+  unlockRadio();
+  if (!wifiWaitForLink(POWER_RECONNECT_TIMEOUT_MS)) {
+    return false;
+  }
+#endif
+  lockRadio();
+  WiFi.setSleep(WIFI_PS_NONE);
+  unlockRadio();
+  return wifiLinkUp();
+}
+
+/*****************************************************************************************
+* Function: Power Radio Down
+*
+* Description: Returns the radio to its low power state after an upload, unless it is held
+* Parameters: None
+* Returns: None
+*****************************************************************************************/
+void powerRadioDown() {
+  lockRadio();
+  if (!radioHeld) {
+#if POWER_RADIO_OFF_BETWEEN_UPLOADS
+    rpcDisconnect();
+    wifiSuspend();
+#else
+    WiFi.setSleep(WIFI_PS_MAX_MODEM);
+#endif
+  }
+  unlockRadio();
+}
+
+/*****************************************************************************************
+* Function: Power Radio Idle Available
+*
+* Description: Whether background network work (e.g. blockhash refresh) may use the radio
+*              between uploads
+* Parameters: None
+* Returns: bool - True in modem sleep mode, false when the radio is off between uploads
+*****************************************************************************************/
+bool powerRadioIdleAvailable() {
+  return !POWER_RADIO_OFF_BETWEEN_UPLOADS;
+}
+
+/*****************************************************************************************
+* Function: Power Radio Hold
+*
+* Description: Keeps the radio up and out of power save between uploads (for a stream that
+*              is not an upload), or releases it. Taking the hold switches a radio that is
+*              off back on without waiting for the link; after a release the radio goes
+*              back to its low power state at the end of the next upload
+* Parameters: hold - True to keep the radio up, false to release it
+* Returns: None
+*****************************************************************************************/
+void powerRadioHold(bool hold) {
+  lockRadio();
+  radioHeld = hold;
+  if (hold) {
+#if POWER_RADIO_OFF_BETWEEN_UPLOADS
+    wifiResume();
+#endif
+    WiFi.setSleep(WIFI_PS_NONE);
+  }
+  unlockRadio();
+}
+
+/*****************************************************************************************
+* Function: Lock Radio / Unlock Radio
+*
+* Description: Serializes changes of the radio state between the network task and a hold
+* Parameters: None
+* Returns: None
+*****************************************************************************************/
+static void lockRadio() {
+  if (radioMutex != NULL) {
+    xSemaphoreTake(radioMutex, portMAX_DELAY);
+  }
+}
+
+static void unlockRadio() {
+  if (radioMutex != NULL) {
+    xSemaphoreGive(radioMutex);
+  }
+}
@@ -0,0 +1,387 @@
+/*****************************************************************************************
+ * Reading Store
+ *
+ * The partition is used as a ring of 4KB sectors. Each sector starts with a header holding a
+ * magic value and an increasing sector sequence, followed by fixed-size records. Records
+ * are only ever appended into erased flash; a sector is erased right before it is reused,
+ * so erases rotate evenly over the whole partition.
+ *
+ * Uploaded records are marked by programming their 'sent' byte from 0xFF to 0x00, which NOR
+ * flash allows without an erase, so the read position survives reboots without any
+ * read-modify-write. If the ring fills up, the oldest sector is recycled and its readings
+ * are counted as dropped.
+ *
+ * Uploads that are sent but not yet confirmed keep their records pending: they are only
+ * reserved, so storePeek() continues after them, and marked uploaded in order by
+ * storeConsumeReserved() once confirmed. After a reboot reserved records are pending again.
+ *
+ * Flash operations briefly stall the caches; the ADC keeps converting into its DMA buffers
+ * (several frames deep) in the meantime, so sampling is not affected.
+ *
+ * Called from the network task only.
+ *
+ *****************************************************************************************/
+
+#include "reading_store.h"
+#include <Preferences.h>
+#include "esp_partition.h"
+#include "logger.h"
+
+/*****************************************************************************************
+* Global Variables
+*****************************************************************************************/
+#define STORE_MAGIC 0x48524C32          // "HRL2" (records with the window summary)
+#define STORE_ERASED 0xFFFFFFFF
+#define STORE_SENT 0x00
+
+struct SectorHeader {
+  uint32_t magic;
+  uint32_t sequence;
+  uint32_t reserved[2];
+};
+
+struct StoredRecord {
+  uint32_t sequence;
+  uint32_t timestampMs;
+  float heartRate;
+  HeartRateSummary summary;
+  uint32_t reserved;
+  uint16_t bootCount;
+  uint8_t crc;                          // CRC-8 over the bytes before it
+  uint8_t sent;                         // 0xFF pending, 0x00 uploaded
+};
+
+static_assert(sizeof(SectorHeader) == STORE_HEADER_SIZE, "SectorHeader size");
+static_assert(sizeof(StoredRecord) == STORE_RECORD_SIZE, "StoredRecord size");
+
+static const esp_partition_t* partition = NULL;
+static uint32_t sectorCount = 0;
+static uint16_t bootCount = 0;
+
+static uint32_t writeSector = 0;        // Sector currently appended to
+static uint32_t writeSlot = 0;          // Next free record slot in writeSector
+static uint32_t writeSectorSequence = 0;
+static uint32_t nextSequence = 0;
+static uint32_t readSector = 0;         // Position of the oldest pending record
+static uint32_t readSlot = 0;
+static uint32_t pendingCount = 0;       // Records not marked uploaded, reserved ones included
+static uint32_t reservedSlots = 0;      // Oldest pending records handed to an in-flight upload
+static uint32_t peekedSlots = 0;        // Slots covered by the last storePeek()
+static uint32_t droppedCount = 0;
+
+static uint8_t crc8(const uint8_t* data, size_t length);
+static size_t recordOffset(uint32_t sector, uint32_t slot);
+static bool readHeader(uint32_t sector, SectorHeader* header);
+static bool startSector(uint32_t sector);
+static void advance(uint32_t* sector, uint32_t* slot);
+
+/*****************************************************************************************
+* Function: Store Begin
+*
+* Description: Opens the log partition and recovers the write and read positions by scanning
+*              sector headers and records
+* Parameters: None
+* Returns: bool - True if the store is ready, false if the partition is missing or unusable
+*****************************************************************************************/
+bool storeBegin() {
+  partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, STORE_PARTITION_LABEL);
+  if (partition == NULL || partition->size < 2 * STORE_SECTOR_SIZE) {
+    LOG_ERROR("❌ Reading store partition not found\n");
+    return false;
+  }
+  sectorCount = partition->size / STORE_SECTOR_SIZE;
+
+  // Boot counter tells readings of earlier boots (whose millis() are meaningless) apart
+  Preferences preferences;
+  if (preferences.begin("store", false)) {
+    bootCount = preferences.getUShort("boot", 0) + 1;
+    preferences.putUShort("boot", bootCount);
+    preferences.end();
+  }
+
+  // Newest sector is the one we append to
+  bool found = false;
+  SectorHeader header;
+  for (uint32_t sector = 0; sector < sectorCount; sector++) {
+    if (readHeader(sector, &header) && (!found || header.sequence > writeSectorSequence)) {
+      found = true;
+      writeSector = sector;
+      writeSectorSequence = header.sequence;
+    }
+  }
+  if (!found) {
+    writeSectorSequence = 0;
+    nextSequence = 0;
+    pendingCount = 0;
+    if (!startSector(0)) {
+      return false;
+    }
+    readSector = 0;
+    readSlot = 0;
+    return true;
+  }
+
+  // First free slot after the last programmed one in the write sector
+  StoredRecord record;
+  writeSlot = 0;
+  nextSequence = 0;
+  for (uint32_t slot = 0; slot < STORE_RECORDS_PER_SECTOR; slot++) {
+    esp_partition_read(partition, recordOffset(writeSector, slot), &record, sizeof(record));
+    const uint32_t* words = (const uint32_t*)&record;
+    if (words[0] != STORE_ERASED || words[1] != STORE_ERASED || words[2] != STORE_ERASED || words[3] != STORE_ERASED) {
+      writeSlot = slot + 1;
+      if (record.sequence != STORE_ERASED) {
+        nextSequence = record.sequence + 1;
+      }
+    }
+  }
+
+  // Sectors are used round-robin: the oldest valid one follows the write sector
+  readSector = (writeSector + 1) % sectorCount;
+  while (readSector != writeSector && !readHeader(readSector, &header)) {
+    readSector = (readSector + 1) % sectorCount;
+  }
+  readSlot = 0;
+
+  // Skip everything already uploaded, count what is left
+  pendingCount = 0;
+  bool pendingFound = false;
+  uint32_t sector = readSector;
+  uint32_t slot = 0;
+  uint32_t used = ((writeSector + sectorCount - readSector) % sectorCount) * STORE_RECORDS_PER_SECTOR + writeSlot;
+  for (uint32_t i = 0; i < used; i++) {
+    esp_partition_read(partition, recordOffset(sector, slot), &record, sizeof(record));
+    if (record.sent != STORE_SENT) {
+      if (!pendingFound) {
+        pendingFound = true;
+        readSector = sector;
+        readSlot = slot;
+      }
+      pendingCount++;
+    }
+    advance(&sector, &slot);
+  }
+  if (!pendingFound) {
+    readSector = writeSector;
+    readSlot = writeSlot;
+  }
+
+  LOG_INFO("✅ Reading store: %u pending readings\n", pendingCount);
+  return true;
+}
+
+/*****************************************************************************************
+* Function: Store Append
+*
+* Description: Appends a reading to the log, recycling the oldest sector if the log is full
+* Parameters: reading - heart rate reading
+* Returns: bool - True if the reading was written, false otherwise
+*****************************************************************************************/
+bool storeAppend(const HeartRateReading& reading) {
+  if (partition == NULL) {
+    return false;
+  }
+
+  if (writeSlot >= STORE_RECORDS_PER_SECTOR) {
+    uint32_t next = (writeSector + 1) % sectorCount;
+    if (next == readSector && pendingCount > 0) {
+      // Ring full: give up the oldest sector's pending readings
+      uint32_t lost = STORE_RECORDS_PER_SECTOR - readSlot;
+      droppedCount += lost;
+      pendingCount -= min(pendingCount, lost);
+      reservedSlots -= min(reservedSlots, lost);
+      readSector = (next + 1) % sectorCount;
+      readSlot = 0;
+      peekedSlots = 0;
+    }
+    if (!startSector(next)) {
+      return false;
+    }
+  }
+
+  StoredRecord record;
+  record.sequence = nextSequence;
+  record.timestampMs = reading.timestampMs;
+  record.heartRate = reading.heartRate;
+  record.summary = reading.summary;
+  record.reserved = 0;
+  record.bootCount = bootCount;
+  record.crc = crc8((const uint8_t*)&record, offsetof(StoredRecord, crc));
+  record.sent = 0xFF;
+  if (esp_partition_write(partition, recordOffset(writeSector, writeSlot), &record, sizeof(record)) != ESP_OK) {
+    return false;
+  }
+  writeSlot++;
+  nextSequence++;
+  pendingCount++;
+  return true;
+}
+
+/*****************************************************************************************
+* Function: Store Peek
+*
+* Description: Reads the oldest pending readings that are not reserved, without removing
+*              them. Corrupt records (torn writes) are skipped. Readings from earlier boots
+*              get READING_TIMESTAMP_UNKNOWN
+* Parameters: readings - destination
+*             maxReadings - capacity of the destination
+* Returns: size_t - number of readings copied
+*****************************************************************************************/
+size_t storePeek(HeartRateReading* readings, size_t maxReadings) {
+  size_t count = 0;
+  uint32_t sector = readSector;
+  uint32_t slot = readSlot;
+  uint32_t scanned = 0;
+  peekedSlots = 0;
+
+  for (uint32_t i = 0; i < reservedSlots; i++) {
+    advance(&sector, &slot);
+  }
+  while (count < maxReadings && scanned < pendingCount - reservedSlots) {
+    StoredRecord record;
+    esp_partition_read(partition, recordOffset(sector, slot), &record, sizeof(record));
+    if (record.crc == crc8((const uint8_t*)&record, offsetof(StoredRecord, crc))) {
+      readings[count].heartRate = record.heartRate;
+      readings[count].summary = record.summary;
+      readings[count].timestampMs = (record.bootCount == bootCount) ? record.timestampMs : READING_TIMESTAMP_UNKNOWN;
+      count++;
+    }
+    scanned++;
+    advance(&sector, &slot);
+  }
+  peekedSlots = scanned;
+  return count;
+}
+
+/*****************************************************************************************
+* Function: Store Reserve Peeked
+*
+* Description: Reserves the records returned by the last storePeek() for an upload in
+*              flight. They stay pending (and in flash) until storeConsumeReserved()
+* Parameters: None
+* Returns: uint32_t - number of record slots reserved, to be passed back on confirmation
+*****************************************************************************************/
+uint32_t storeReservePeeked() {
+  uint32_t slots = peekedSlots;
+  reservedSlots += slots;
+  peekedSlots = 0;
+  return slots;
+}
+
+/*****************************************************************************************
+* Function: Store Consume Reserved
+*
+* Description: Marks the oldest reserved records as uploaded
+* Parameters: slots - number of record slots (as returned by storeReservePeeked())
+* Returns: None
+*****************************************************************************************/
+void storeConsumeReserved(uint32_t slots) {
+  static const uint8_t sent = STORE_SENT;
+  slots = min(slots, reservedSlots);
+  for (uint32_t i = 0; i < slots && pendingCount > 0; i++) {
+    esp_partition_write(partition, recordOffset(readSector, readSlot) + offsetof(StoredRecord, sent), &sent, 1);
+    advance(&readSector, &readSlot);
+    pendingCount--;
+  }
+  reservedSlots -= slots;
+}
+
+/*****************************************************************************************
+* Function: Store Pending / Reserved / Dropped
+*
+* Description: Number of readings waiting for upload (not reserved) / reserved for uploads
+*              in flight / lost because the log was full
+* Parameters: None
+* Returns: uint32_t - counter value
+*****************************************************************************************/
+uint32_t storePending() {
+  return pendingCount - reservedSlots;
+}
+
+uint32_t storeReserved() {
+  return reservedSlots;
+}
+
+uint32_t storeDropped() {
+  return droppedCount;
+}
+
+/*****************************************************************************************
+* Function: Start Sector
+*
+* Description: Erases a sector and writes a new header to it, making it the write sector
+* Parameters: sector - sector index
+* Returns: bool - True if the sector is ready, false otherwise
+*****************************************************************************************/
+static bool startSector(uint32_t sector) {
+  if (esp_partition_erase_range(partition, sector * STORE_SECTOR_SIZE, STORE_SECTOR_SIZE) != ESP_OK) {
+    return false;
+  }
+  SectorHeader header = { STORE_MAGIC, writeSectorSequence + 1, { STORE_ERASED, STORE_ERASED } };
+  if (esp_partition_write(partition, sector * STORE_SECTOR_SIZE, &header, sizeof(header)) != ESP_OK) {
+    return false;
+  }
+  writeSector = sector;
+  writeSlot = 0;
+  writeSectorSequence = header.sequence;
+  return true;
+}
+
+/*****************************************************************************************
+* Function: Read Header
+*
+* Description: Reads a sector header
+* Parameters: sector - sector index
+*             header - destination
+* Returns: bool - True if the sector holds a valid header, false if it is erased or foreign
+*****************************************************************************************/
+static bool readHeader(uint32_t sector, SectorHeader* header) {
+  if (esp_partition_read(partition, sector * STORE_SECTOR_SIZE, header, sizeof(*header)) != ESP_OK) {
+    return false;
+  }
+  return header->magic == STORE_MAGIC;
+}
+
+/*****************************************************************************************
+* Function: Record Offset
+*
+* Description: Partition offset of a record slot
+* Parameters: sector, slot - record position
+* Returns: size_t - byte offset within the partition
+*****************************************************************************************/
+static size_t recordOffset(uint32_t sector, uint32_t slot) {
+  return sector * STORE_SECTOR_SIZE + STORE_HEADER_SIZE + slot * STORE_RECORD_SIZE;
+}
+
+/*****************************************************************************************
+* Function: Advance
+*
+* Description: Moves a record position to the next slot, wrapping to the next sector
+* Parameters: sector, slot - record position to advance
+* Returns: None
+*****************************************************************************************/
+static void advance(uint32_t* sector, uint32_t* slot) {
+  if (++(*slot) >= STORE_RECORDS_PER_SECTOR) {
+    *slot = 0;
+    *sector = (*sector + 1) % sectorCount;
+  }
+}
+
+/*****************************************************************************************
+* Function: CRC-8
+*
+* Description: CRC-8 (polynomial 0x07) used to detect torn record writes
+* Parameters: data - bytes to check
+*             length - number of bytes
+* Returns: uint8_t - checksum
+*****************************************************************************************/
+static uint8_t crc8(const uint8_t* data, size_t length) {
+  uint8_t crc = 0;
+  for (size_t i = 0; i < length; i++) {
+    crc ^= data[i];
+    for (int bit = 0; bit < 8; bit++) {
+      crc = (crc & 0x80) ? (crc << 1) ^ 0x07 : crc << 1;
+    }
+  }
+  return crc;
+}
@@ -0,0 +1,176 @@
+/*****************************************************************************************
+ * Rewards
+ *
+ * Minting resets the on-chain points, so after a mint went out the scheduler forgets the
+ * cached value and waits a full check interval: a mint that did not land shows up as the
+ * same points at the next check and is requested again.
+ *
+ * The account is also subscribed over the WebSocket. Once the points were read (polled or
+ * pushed) during the current WebSocket session every change is pushed, so polling stops
+ * until the session ends. After a mint went out, pushes still carry the points of heart
+ * rate transactions confirmed before it, so they neither request a mint nor stop polling
+ * until one shows the reset; the check a full interval later still catches a lost mint.
+ *
+ * Called from the network task only, which owns the RPC connection.
+ *
+ *****************************************************************************************/
+
+#include "rewards.h"
+#include "rpc_client.h"
+#include "rpc_websocket.h"
+#include "logger.h"
+
+/*****************************************************************************************
+* Global Variables
+*****************************************************************************************/
+static uint8_t heartbeatAccount[SOLANA_PUBKEY_SIZE];
+static bool accountSet = false;
+static uint64_t points = 0;
+static bool mintDue = false;
+static unsigned long nextCheckTime = 0;
+static uint32_t liveSession = 0;        // WebSocket session the points are current for (0: none)
+static bool awaitingReset = false;      // Mint sent, not yet seen on chain
+
+static uint64_t decodePoints(const uint8_t* data);
+static void onPointsPushed(const uint8_t* data, size_t length);
+
+/*****************************************************************************************
+* Function: Rewards Begin
+*
+* Description: Sets the HeartBeat account whose points are checked and subscribes to its
+*              changes. The first check runs on the next service call
+* Parameters: accountAddress - 32-byte HeartBeat PDA
+* Returns: None
+*****************************************************************************************/
+void rewardsBegin(const uint8_t* accountAddress) {
+  memcpy(heartbeatAccount, accountAddress, SOLANA_PUBKEY_SIZE);
+  accountSet = true;
+  mintDue = false;
+  liveSession = 0;
+  awaitingReset = false;
+  nextCheckTime = millis();
+  if (!wsSubscribeAccount(heartbeatAccount, HEARTBEAT_POINTS_OFFSET, sizeof(uint64_t), onPointsPushed)) {
+    LOG_ERROR("❌ Failed to subscribe to HeartBeat account, points are polled\n");
+  }
+}
+
+/*****************************************************************************************
+* Function: Rewards Service
+*
+* Description: Reads the accumulated points when a check is due and requests a mint once
+*              they reach REWARDS_MIN_POINTS
+* Parameters: None
+* Returns: None
+*****************************************************************************************/
+void rewardsService() {
+  if (!accountSet || mintDue || rewardsMsUntilCheck() > 0) {
+    return;
+  }
+
+  uint8_t data[sizeof(uint64_t)];
+  if (!rpcGetAccountData(heartbeatAccount, HEARTBEAT_POINTS_OFFSET, sizeof(data), data)) {
+    LOG_ERROR("❌ Failed to read HeartBeat points\n");
+    nextCheckTime = millis() + REWARDS_RETRY_MS;
+    return;
+  }
+  points = decodePoints(data);
+  nextCheckTime = millis() + REWARDS_CHECK_MS;
+  liveSession = wsConnected() ? wsSessions() : 0;
+  awaitingReset = false;
+
+  mintDue = points >= REWARDS_MIN_POINTS;
+  LOG_INFO("HeartBeat points: %llu%s\n", (unsigned long long)points, mintDue ? ", mint requested" : "");
+}
+
+/*****************************************************************************************
+* Function: Rewards Mint Due
+*
+* Description: Whether the next upload should carry a mint_reward instruction
+* Parameters: None
+* Returns: bool - True if a mint is requested, false otherwise
+*****************************************************************************************/
+bool rewardsMintDue() {
+  return mintDue;
+}
+
+/*****************************************************************************************
+* Function: Rewards Mint Sent
+*
+* Description: Clears the mint request after a transaction carrying it was accepted
+* Parameters: None
+* Returns: None
+*****************************************************************************************/
+void rewardsMintSent() {
+  mintDue = false;
+  points = 0;
+  nextCheckTime = millis() + REWARDS_CHECK_MS;
+  liveSession = 0;
+  awaitingReset = true;
+}
+
+/*****************************************************************************************
+* Function: Rewards Points
+*
+* Description: Points read at the last check or pushed since
+* Parameters: None
+* Returns: uint64_t - accumulated points
+*****************************************************************************************/
+uint64_t rewardsPoints() {
+  return points;
+}
+
+/*****************************************************************************************
+* Function: Rewards Ms Until Check
+*
+* Description: Time until the next points check is due
+* Parameters: None
+* Returns: unsigned long - ms until the check, 0 if due (REWARDS_CHECK_MS while a mint is
+*          requested, changes are pushed or no account is set, nothing is checked then)
+*****************************************************************************************/
+unsigned long rewardsMsUntilCheck() {
+  if (!accountSet || mintDue || (liveSession != 0 && wsConnected() && liveSession == wsSessions())) {
+    return REWARDS_CHECK_MS;
+  }
+  long remaining = (long)(nextCheckTime - millis());
+  return remaining > 0 ? (unsigned long)remaining : 0;
+}
+
+/*****************************************************************************************
+* Function: On Points Pushed
+*
+* Description: Takes the points from a HeartBeat account notification
+* Parameters: data - points field (u64, little-endian)
+*             length - field length
+* Returns: None
+*****************************************************************************************/
+static void onPointsPushed(const uint8_t* data, size_t length) {
+  points = decodePoints(data);
+  if (awaitingReset) {
+    if (points >= REWARDS_MIN_POINTS) {
+      return;                           // Confirmed before the mint, the poll decides
+    }
+    awaitingReset = false;
+  }
+  liveSession = wsSessions();
+  nextCheckTime = millis() + REWARDS_CHECK_MS;
+  bool wasDue = mintDue;
+  mintDue = points >= REWARDS_MIN_POINTS;
+  if (mintDue != wasDue) {
+    LOG_INFO("HeartBeat points: %llu%s (pushed)\n", (unsigned long long)points, mintDue ? ", mint requested" : "");
+  }
+}
+
+/*****************************************************************************************
+* Function: Decode Points
+*
+* Description: Reads the little-endian u64 points field
+* Parameters: data - 8 bytes
+* Returns: uint64_t - points
+*****************************************************************************************/
+static uint64_t decodePoints(const uint8_t* data) {
+  uint64_t value = 0;
+  for (int i = sizeof(uint64_t) - 1; i >= 0; i--) {
+    value = (value << 8) | data[i];
+  }
+  return value;
+}
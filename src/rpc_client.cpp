@@ -0,0 +1,772 @@
+/*****************************************************************************************
+ * RPC Client
+ *
+ * The TLS connection is opened explicitly with WiFiClientSecure::connect() so that the
+ * handshake can be timed on its own, then handed to HTTPClient with reuse enabled. As long
+ * as the server answers with keep-alive, HTTPClient::end() leaves the socket open and the
+ * next request skips the handshake. A request that fails on a reused connection is retried
+ * once on a fresh one.
+ *
+ * Several endpoints can be configured. Each keeps an EWMA of its request time and error
+ * rate; requests go to the best one, fail over to the next, and an endpoint that failed
+ * or answered 429 is skipped for an exponentially growing backoff (at least Retry-After).
+ * Only the endpoint last used keeps its connection open. sendTransaction is hedged: the
+ * first endpoint gets RPC_HEDGE_MS to answer before the same signed transaction goes to
+ * the next; HTTPClient blocks, so the hedge is sequential rather than concurrent, and a
+ * duplicate that reaches the cluster twice is deduplicated by its signature.
+ *
+ * The Arduino WiFiClientSecure does not expose mbedTLS session tickets, so a dropped link
+ * costs a full handshake; keeping the connection alive avoids it in the common case.
+ *
+ * Request bodies are built in rpcRequest and responses read into rpcResponse. Only the
+ * values a call needs are then looked up in place with json_scan, no document of the
+ * response is built, so the module itself does not allocate and needs no parse memory.
+ * HTTPClient still builds its header Strings internally.
+ *
+ * Not thread safe: after setup() only the network task calls into this module.
+ *
+ *****************************************************************************************/
+
+#include "rpc_client.h"
+#include <WiFi.h>
+#include <WiFiClientSecure.h>
+#include <HTTPClient.h>
+#include "mbedtls/base64.h"
+#include "json_scan.h"
+#include "logger.h"
+#include "instrumentation.h"
+
+/*****************************************************************************************
+* Global Variables
+*****************************************************************************************/
+enum RpcOutcome {
+  RPC_OUTCOME_OK,
+  RPC_OUTCOME_FAILED,                   // Transport error, timeout or 5xx: try the next endpoint
+  RPC_OUTCOME_TIMED_OUT,                // No response within the timeout: try the next endpoint
+  RPC_OUTCOME_HEDGED,                   // Timed out on the short hedge deadline: slow, not failed
+  RPC_OUTCOME_RATE_LIMITED,             // 429: back off this endpoint, try the next
+  RPC_OUTCOME_REJECTED                  // Other HTTP error: every endpoint would answer the same
+};
+
+struct RpcEndpoint {
+  WiFiClientSecure tlsClient;
+  HTTPClient http;
+  String url;
+  String host;
+  uint16_t port;
+  bool measured;                        // At least one latency sample
+  uint32_t latencyMs;                   // EWMA of the request time (handshake excluded)
+  uint32_t errorPerMille;               // EWMA of failed requests
+  uint32_t backoffMs;                   // Current backoff, doubled on every further failure
+  unsigned long backoffUntil;
+  bool rateLimited;                     // Backoff was requested by the server (429)
+  uint32_t requests;
+  uint32_t failures;
+  uint32_t rateLimits;
+};
+
+static RpcEndpoint endpoints[RPC_MAX_ENDPOINTS];
+static size_t endpointCount = 0;
+static RpcStats stats = {};
+static char rpcRequest[RPC_REQUEST_SIZE];
+static char rpcResponse[RPC_RESPONSE_SIZE];
+static const char* rpcCollectedHeaders[] = { "Retry-After" };
+
+/*****************************************************************************************
+* Class: Buffer Sink
+*
+* Description: Stream that appends everything written to it to a fixed buffer. Used with
+*              HTTPClient::writeToStream() for chunked responses
+*****************************************************************************************/
+class BufferSink : public Stream {
+public:
+  BufferSink(char* buffer, size_t size) : buffer(buffer), size(size), length(0), overflow(false) {}
+  size_t write(uint8_t byte) override {
+    if (length + 1 >= size) {
+      overflow = true;
+      return 0;
+    }
+    buffer[length++] = byte;
+    return 1;
+  }
+  int available() override { return 0; }
+  int read() override { return -1; }
+  int peek() override { return -1; }
+  char* buffer;
+  size_t size;
+  size_t length;
+  bool overflow;
+};
+
+static bool parseEndpoint(RpcEndpoint& endpoint, const char* url);
+static bool rpcConnect(RpcEndpoint& endpoint);
+static int selectEndpoint(const bool* tried);
+static RpcOutcome endpointCall(RpcEndpoint& endpoint, const char* body, size_t bodyLength,
+                               char* response, size_t responseSize, uint16_t timeoutMs);
+static void recordOutcome(RpcEndpoint& endpoint, RpcOutcome outcome, unsigned long requestMs);
+static void releaseIdleEndpoints(int keep);
+static bool rpcCallWithDeadline(const char* body, size_t bodyLength, char* response, size_t responseSize,
+                                uint16_t firstTimeoutMs);
+static int readResponse(HTTPClient& http, char* response, size_t responseSize);
+static bool signatureFromTransaction(const char* txBase64, char* signature, size_t signatureSize);
+
+/*****************************************************************************************
+* Function: RPC Begin
+*
+* Description: Sets the RPC endpoints. Connections are opened lazily on the first request
+* Parameters: urls - https URLs of the JSON-RPC endpoints, in order of preference
+*             count - number of URLs (at most RPC_MAX_ENDPOINTS are used)
+* Returns: bool - True if at least one URL could be parsed, false otherwise
+*****************************************************************************************/
+bool rpcBegin(const char* const* urls, size_t count) {
+  endpointCount = 0;
+  for (size_t i = 0; i < count && endpointCount < RPC_MAX_ENDPOINTS; i++) {
+    if (parseEndpoint(endpoints[endpointCount], urls[i])) {
+      endpointCount++;
+    }
+  }
+  if (count > RPC_MAX_ENDPOINTS) {
+    LOG_ERROR("❌ Only the first %u RPC endpoints are used\n", (unsigned)RPC_MAX_ENDPOINTS);
+  }
+  return endpointCount > 0;
+}
+
+/*****************************************************************************************
+* Function: Parse Endpoint
+*
+* Description: Splits an RPC URL into host and port and resets the endpoint's health
+* Parameters: endpoint - endpoint to set up
+*             url - https URL of the JSON-RPC endpoint
+* Returns: bool - True if the URL could be parsed, false otherwise
+*****************************************************************************************/
+static bool parseEndpoint(RpcEndpoint& endpoint, const char* url) {
+  endpoint.url = url;
+  if (!endpoint.url.startsWith("https://")) {
+    LOG_ERROR("❌ RPC URL must be https: %s\n", url);
+    return false;
+  }
+
+  String hostPort = endpoint.url.substring(8);
+  int slash = hostPort.indexOf('/');
+  if (slash >= 0) {
+    hostPort = hostPort.substring(0, slash);
+  }
+  int colon = hostPort.indexOf(':');
+  if (colon >= 0) {
+    endpoint.host = hostPort.substring(0, colon);
+    endpoint.port = hostPort.substring(colon + 1).toInt();
+  } else {
+    endpoint.host = hostPort;
+    endpoint.port = 443;
+  }
+
+  endpoint.measured = false;
+  endpoint.latencyMs = 0;
+  endpoint.errorPerMille = 0;
+  endpoint.backoffMs = 0;
+  endpoint.backoffUntil = 0;
+  endpoint.rateLimited = false;
+  endpoint.requests = 0;
+  endpoint.failures = 0;
+  endpoint.rateLimits = 0;
+  endpoint.tlsClient.setInsecure();
+  endpoint.tlsClient.setHandshakeTimeout(RPC_HANDSHAKE_TIMEOUT_S);
+  endpoint.http.setReuse(true);
+  endpoint.http.setTimeout(RPC_TIMEOUT_MS);
+  endpoint.http.collectHeaders(rpcCollectedHeaders, 1);
+  return true;
+}
+
+/*****************************************************************************************
+* Function: RPC Connect
+*
+* Description: Opens the TLS connection if it is not already open and times the handshake
+* Parameters: endpoint - endpoint to connect to
+* Returns: bool - True if connected, false otherwise
+*****************************************************************************************/
+static bool rpcConnect(RpcEndpoint& endpoint) {
+  if (endpoint.tlsClient.connected()) {
+    return true;
+  }
+  if (WiFi.status() != WL_CONNECTED) {
+    return false;
+  }
+
+  endpoint.tlsClient.stop();
+  unsigned long startTime = millis();
+  if (!endpoint.tlsClient.connect(endpoint.host.c_str(), endpoint.port)) {
+    LOG_ERROR("❌ RPC TLS handshake failed: %s\n", endpoint.host.c_str());
+    return false;
+  }
+  stats.handshakes++;
+  stats.lastHandshakeMs = millis() - startTime;
+  stats.totalHandshakeMs += stats.lastHandshakeMs;
+  return true;
+}
+
+/*****************************************************************************************
+* Function: RPC Disconnect
+*
+* Description: Closes the persistent connections (e.g. before WiFi is turned off)
+* Parameters: None
+* Returns: None
+*****************************************************************************************/
+void rpcDisconnect() {
+  for (size_t i = 0; i < endpointCount; i++) {
+    endpoints[i].http.end();
+    endpoints[i].tlsClient.stop();
+  }
+}
+
+/*****************************************************************************************
+* Function: RPC Call
+*
+* Description: POSTs a JSON-RPC request to the fastest healthy endpoint. If it fails, is
+*              rate limited or answers with a server error, the request goes to the next
+*              best endpoint, until every endpoint was tried once
+* Parameters: body - JSON-RPC request
+*             bodyLength - request length in bytes
+*             response - buffer for the null-terminated response body
+*             responseSize - size of the response buffer
+* Returns: bool - True if a complete HTTP 200 response was received, false otherwise
+*****************************************************************************************/
+bool rpcCall(const char* body, size_t bodyLength, char* response, size_t responseSize) {
+  return rpcCallWithDeadline(body, bodyLength, response, responseSize, RPC_TIMEOUT_MS);
+}
+
+/*****************************************************************************************
+* Function: RPC Call With Deadline
+*
+* Description: rpcCall() with a separate response timeout for the first endpoint tried.
+*              A short one hedges an idempotent request: a slow endpoint is abandoned and
+*              the request repeated on the next one
+* Parameters: body - JSON-RPC request
+*             bodyLength - request length in bytes
+*             response - buffer for the null-terminated response body
+*             responseSize - size of the response buffer
+*             firstTimeoutMs - response timeout of the first attempt
+* Returns: bool - True if a complete HTTP 200 response was received, false otherwise
+*****************************************************************************************/
+static bool rpcCallWithDeadline(const char* body, size_t bodyLength, char* response, size_t responseSize,
+                                uint16_t firstTimeoutMs) {
+  bool tried[RPC_MAX_ENDPOINTS] = {};
+  for (size_t attempt = 0; attempt < endpointCount; attempt++) {
+    int index = selectEndpoint(tried);
+    if (index < 0) {
+      break;                            // All remaining endpoints asked us to back off
+    }
+    tried[index] = true;
+    if (attempt > 0) {
+      instrumentCount(COUNTER_RPC_FAILOVERS);
+    }
+
+    RpcEndpoint& endpoint = endpoints[index];
+    unsigned long startTime = millis();
+    RpcOutcome outcome = endpointCall(endpoint, body, bodyLength, response, responseSize,
+                                      attempt == 0 ? firstTimeoutMs : RPC_TIMEOUT_MS);
+    unsigned long requestMs = millis() - startTime;
+    if (outcome == RPC_OUTCOME_TIMED_OUT && attempt == 0 && firstTimeoutMs < RPC_TIMEOUT_MS) {
+      outcome = RPC_OUTCOME_HEDGED;
+    }
+    recordOutcome(endpoint, outcome, requestMs);
+    if (outcome == RPC_OUTCOME_OK) {
+      stats.requests++;
+      stats.lastRequestMs = requestMs;
+      stats.totalRequestMs += requestMs;
+      releaseIdleEndpoints(index);
+      return true;
+    }
+    if (outcome == RPC_OUTCOME_REJECTED) {
+      break;
+    }
+  }
+  stats.failures++;
+  return false;
+}
+
+/*****************************************************************************************
+* Function: Select Endpoint
+*
+* Description: Picks the endpoint with the lowest latency, weighted by its error rate
+*              (x4 at a 100% error rate), among those not tried yet and not backing off.
+*              Endpoints without a sample count as RPC_UNMEASURED_LATENCY_MS, so a fallback
+*              is only tried once the preferred endpoint is slower than that. If all of
+*              them are backing off after errors, the one whose backoff ends first is
+*              tried anyway; a 429 backoff is always respected
+* Parameters: tried - per endpoint, whether it was tried for this request
+* Returns: int - endpoint index, -1 if none can be used
+*****************************************************************************************/
+static int selectEndpoint(const bool* tried) {
+  unsigned long now = millis();
+  int best = -1;
+  uint64_t bestScore = 0;
+  for (size_t i = 0; i < endpointCount; i++) {
+    const RpcEndpoint& endpoint = endpoints[i];
+    if (tried[i] || (long)(endpoint.backoffUntil - now) > 0) {
+      continue;
+    }
+    uint64_t latency = endpoint.measured ? endpoint.latencyMs : RPC_UNMEASURED_LATENCY_MS;
+    uint64_t score = latency * (1000 + 3 * endpoint.errorPerMille);
+    if (best < 0 || score < bestScore) {
+      best = i;
+      bestScore = score;
+    }
+  }
+  if (best >= 0) {
+    return best;
+  }
+
+  for (size_t i = 0; i < endpointCount; i++) {
+    const RpcEndpoint& endpoint = endpoints[i];
+    if (tried[i] || endpoint.rateLimited) {
+      continue;
+    }
+    if (best < 0 || (long)(endpoint.backoffUntil - endpoints[best].backoffUntil) < 0) {
+      best = i;
+    }
+  }
+  return best;
+}
+
+/*****************************************************************************************
+* Function: Endpoint Call
+*
+* Description: POSTs a request to one endpoint. A request that fails on a reused
+*              connection is retried once on a fresh one (unless it timed out)
+* Parameters: endpoint - endpoint to use
+*             body - JSON-RPC request
+*             bodyLength - request length in bytes
+*             response - buffer for the null-terminated response body
+*             responseSize - size of the response buffer
+*             timeoutMs - response timeout
+* Returns: RpcOutcome - result of the request
+*****************************************************************************************/
+static RpcOutcome endpointCall(RpcEndpoint& endpoint, const char* body, size_t bodyLength,
+                               char* response, size_t responseSize, uint16_t timeoutMs) {
+  for (int attempt = 0; attempt < 2; attempt++) {
+    bool reused = endpoint.tlsClient.connected();
+    if (!rpcConnect(endpoint)) {
+      return RPC_OUTCOME_FAILED;
+    }
+
+    endpoint.http.setTimeout(timeoutMs);
+    endpoint.http.begin(endpoint.tlsClient, endpoint.url);
+    endpoint.http.addHeader("Content-Type", "application/json");
+    int httpCode = endpoint.http.POST((uint8_t*)body, bodyLength);
+    if (httpCode == HTTP_CODE_OK) {
+      int length = readResponse(endpoint.http, response, responseSize);
+      endpoint.http.end();
+      if (length < 0) {
+        endpoint.tlsClient.stop();      // Unread data left on the socket, do not reuse it
+        return RPC_OUTCOME_FAILED;
+      }
+      return RPC_OUTCOME_OK;
+    }
+
+    if (httpCode == HTTP_CODE_TOO_MANY_REQUESTS) {
+      long retryAfterS = endpoint.http.header("Retry-After").toInt();
+      endpoint.http.end();
+      endpoint.rateLimits++;
+      endpoint.backoffMs = endpoint.backoffMs == 0 ? RPC_BACKOFF_MIN_MS : min(endpoint.backoffMs * 2, (uint32_t)RPC_BACKOFF_MAX_MS);
+      unsigned long backoffMs = max((unsigned long)endpoint.backoffMs, (unsigned long)retryAfterS * 1000);
+      endpoint.backoffUntil = millis() + backoffMs;
+      endpoint.rateLimited = true;
+      LOG_ERROR("❌ RPC rate limited, backing off %lums: %s\n", backoffMs, endpoint.host.c_str());
+      return RPC_OUTCOME_RATE_LIMITED;
+    }
+    endpoint.http.end();
+    if (httpCode >= 500) {
+      LOG_ERROR("❌ RPC HTTP error: %d (%s)\n", httpCode, endpoint.host.c_str());
+      return RPC_OUTCOME_FAILED;
+    }
+    if (httpCode > 0) {
+      // The server answered, another endpoint or connection will not help
+      LOG_ERROR("❌ RPC HTTP error: %d\n", httpCode);
+      return RPC_OUTCOME_REJECTED;
+    }
+    // Connection lost or stale keep-alive socket: reconnect and retry
+    endpoint.tlsClient.stop();
+    if (httpCode == HTTPC_ERROR_READ_TIMEOUT) {
+      return RPC_OUTCOME_TIMED_OUT;
+    }
+    if (!reused) {
+      return RPC_OUTCOME_FAILED;
+    }
+    instrumentCount(COUNTER_RPC_RETRIES);
+  }
+  return RPC_OUTCOME_FAILED;
+}
+
+/*****************************************************************************************
+* Function: Record Outcome
+*
+* Description: Updates the latency and error EWMAs (weight 1 / RPC_EWMA_WEIGHT) and the
+*              backoff of an endpoint after a request. A request abandoned at the hedge
+*              deadline only adds a latency sample (the deadline, a lower bound), so a
+*              slow but healthy endpoint is not backed off like a failed one
+* Parameters: endpoint - endpoint used
+*             outcome - result of the request
+*             requestMs - time the request took
+* Returns: None
+*****************************************************************************************/
+static void recordOutcome(RpcEndpoint& endpoint, RpcOutcome outcome, unsigned long requestMs) {
+  endpoint.requests++;
+  if (outcome == RPC_OUTCOME_RATE_LIMITED || outcome == RPC_OUTCOME_REJECTED) {
+    return;                             // Says nothing about the endpoint's health
+  }
+
+  if (!endpoint.measured) {
+    endpoint.latencyMs = requestMs;
+    endpoint.measured = true;
+  } else {
+    endpoint.latencyMs = (endpoint.latencyMs * (RPC_EWMA_WEIGHT - 1) + requestMs) / RPC_EWMA_WEIGHT;
+  }
+  if (outcome == RPC_OUTCOME_HEDGED) {
+    return;
+  }
+
+  bool failed = outcome == RPC_OUTCOME_FAILED || outcome == RPC_OUTCOME_TIMED_OUT;
+  uint32_t errorSample = failed ? 1000 : 0;
+  endpoint.errorPerMille = (endpoint.errorPerMille * (RPC_EWMA_WEIGHT - 1) + errorSample) / RPC_EWMA_WEIGHT;
+
+  if (failed) {
+    endpoint.failures++;
+    endpoint.backoffMs = endpoint.backoffMs == 0 ? RPC_BACKOFF_MIN_MS : min(endpoint.backoffMs * 2, (uint32_t)RPC_BACKOFF_MAX_MS);
+    endpoint.backoffUntil = millis() + endpoint.backoffMs;
+    endpoint.rateLimited = false;
+  } else {
+    endpoint.backoffMs = 0;
+    endpoint.rateLimited = false;
+  }
+}
+
+/*****************************************************************************************
+* Function: Release Idle Endpoints
+*
+* Description: Closes the connections of all endpoints but the one in use, so only one
+*              TLS session stays allocated between requests
+* Parameters: keep - index of the endpoint whose connection stays open
+* Returns: None
+*****************************************************************************************/
+static void releaseIdleEndpoints(int keep) {
+  for (size_t i = 0; i < endpointCount; i++) {
+    if ((int)i != keep && endpoints[i].tlsClient.connected()) {
+      endpoints[i].http.end();
+      endpoints[i].tlsClient.stop();
+    }
+  }
+}
+
+/*****************************************************************************************
+* Function: Read Response
+*
+* Description: Reads the response body of the current request into a fixed buffer
+* Parameters: http - client of the current request
+*             response - destination, null-terminated on success
+*             responseSize - size of the destination
+* Returns: int - body length, -1 if it did not fit or timed out
+*****************************************************************************************/
+static int readResponse(HTTPClient& http, char* response, size_t responseSize) {
+  int size = http.getSize();
+  if (size < 0) {
+    // Chunked transfer: let HTTPClient decode the chunks into the buffer
+    BufferSink sink(response, responseSize);
+    if (http.writeToStream(&sink) < 0 || sink.overflow) {
+      return -1;
+    }
+    response[sink.length] = '\0';
+    return sink.length;
+  }
+  if ((size_t)size >= responseSize) {
+    LOG_ERROR("❌ RPC response too large\n");
+    return -1;
+  }
+
+  WiFiClient* stream = http.getStreamPtr();
+  int received = 0;
+  unsigned long startTime = millis();
+  while (received < size && millis() - startTime < RPC_TIMEOUT_MS) {
+    int available = stream->available();
+    if (available <= 0) {
+      delay(1);
+      continue;
+    }
+    received += stream->read((uint8_t*)response + received, min(available, size - received));
+  }
+  if (received < size) {
+    return -1;
+  }
+  response[received] = '\0';
+  return received;
+}
+
+/*****************************************************************************************
+* Function: RPC Get Latest Blockhash
+*
+* Description: Fetches the latest blockhash
+* Parameters: blockhash - destination for the base58 blockhash
+*             blockhashSize - size of the destination (BLOCKHASH_BASE58_SIZE)
+* Returns: bool - True if a blockhash was received, false otherwise
+*****************************************************************************************/
+bool rpcGetLatestBlockhash(char* blockhash, size_t blockhashSize) {
+  static const char body[] = "{\"jsonrpc\":\"2.0\",\"id\":1,\"method\":\"getLatestBlockhash\"}";
+  if (!rpcCall(body, sizeof(body) - 1, rpcResponse, sizeof(rpcResponse))) {
+    return false;
+  }
+
+  JsonValue value;
+  return jsonFind(rpcResponse, "result.value.blockhash", &value) &&
+         jsonCopyString(value, blockhash, blockhashSize);
+}
+
+/*****************************************************************************************
+* Function: RPC Send Raw Transaction
+*
+* Description: Submits a signed, base64 encoded transaction (hedged across endpoints)
+* Parameters: txBase64 - serialized transaction
+*             signature - destination for the base58 signature
+*             signatureSize - size of the destination (SIGNATURE_BASE58_SIZE)
+* Returns: bool - True if the RPC accepted the transaction, false otherwise
+*****************************************************************************************/
+bool rpcSendRawTransaction(const char* txBase64, char* signature, size_t signatureSize) {
+  int length = snprintf(rpcRequest, sizeof(rpcRequest),
+                        "{\"jsonrpc\":\"2.0\",\"id\":1,\"method\":\"sendTransaction\","
+                        "\"params\":[\"%s\",{\"encoding\":\"base64\"}]}", txBase64);
+  if (length < 0 || (size_t)length >= sizeof(rpcRequest)) {
+    return false;
+  }
+  uint16_t firstTimeoutMs = endpointCount > 1 ? RPC_HEDGE_MS : RPC_TIMEOUT_MS;
+  if (!rpcCallWithDeadline(rpcRequest, length, rpcResponse, sizeof(rpcResponse), firstTimeoutMs)) {
+    return false;
+  }
+
+  JsonValue value;
+  if (jsonFind(rpcResponse, "error", &value)) {
+    char message[128];
+    if (!jsonFind(rpcResponse, "error.message", &value) || !jsonCopyString(value, message, sizeof(message))) {
+      strcpy(message, "unknown");
+    }
+    if (strstr(message, "already been processed") != NULL) {
+      // A hedged copy reached the cluster first: the transaction is in, under its own signature
+      return signatureFromTransaction(txBase64, signature, signatureSize);
+    }
+    LOG_ERROR("❌ RPC error: %s\n", message);
+    return false;
+  }
+  return jsonFind(rpcResponse, "result", &value) &&
+         jsonCopyString(value, signature, signatureSize);
+}
+
+/*****************************************************************************************
+* Function: Signature From Transaction
+*
+* Description: Reads the first signature of a serialized transaction (its id)
+* Parameters: txBase64 - serialized transaction
+*             signature - destination for the base58 signature
+*             signatureSize - size of the destination (SIGNATURE_BASE58_SIZE)
+* Returns: bool - True if the transaction starts with a signature, false otherwise
+*****************************************************************************************/
+static bool signatureFromTransaction(const char* txBase64, char* signature, size_t signatureSize) {
+  // Signature count (compact-u16, one byte below 128) and the first 64-byte signature
+  uint8_t prefix[1 + SOLANA_SIGNATURE_SIZE + 1];
+  size_t prefixLength = 0;
+  if (strlen(txBase64) < 88 ||
+      mbedtls_base64_decode(prefix, sizeof(prefix), &prefixLength, (const uint8_t*)txBase64, 88) != 0 ||
+      prefixLength < 1 + SOLANA_SIGNATURE_SIZE || prefix[0] == 0 || prefix[0] >= 0x80) {
+    return false;
+  }
+  return base58Encode(prefix + 1, SOLANA_SIGNATURE_SIZE, signature, signatureSize) > 0;
+}
+
+/*****************************************************************************************
+* Function: RPC Get Signature Statuses
+*
+* Description: Looks up the status of several transactions with one getSignatureStatuses
+*              request (including transaction history, so a status polled late is found)
+* Parameters: signatures - base58 signatures
+*             count - number of signatures (at most RPC_MAX_SIGNATURE_STATUSES)
+*             statuses - set to the status of each signature
+*             errorCodes - set to the program error code of each failed transaction
+*                          (RPC_NO_ERROR_CODE if it has none)
+* Returns: bool - True if the statuses were read, false otherwise
+*****************************************************************************************/
+bool rpcGetSignatureStatuses(const char* const* signatures, size_t count, RpcSignatureStatus* statuses,
+                             uint32_t* errorCodes) {
+  if (count == 0 || count > RPC_MAX_SIGNATURE_STATUSES) {
+    return false;
+  }
+
+  int length = snprintf(rpcRequest, sizeof(rpcRequest),
+                        "{\"jsonrpc\":\"2.0\",\"id\":1,\"method\":\"getSignatureStatuses\",\"params\":[[");
+  for (size_t i = 0; i < count && (size_t)length < sizeof(rpcRequest); i++) {
+    length += snprintf(rpcRequest + length, sizeof(rpcRequest) - length, "%s\"%s\"",
+                       i > 0 ? "," : "", signatures[i]);
+  }
+  if ((size_t)length >= sizeof(rpcRequest)) {
+    return false;
+  }
+  length += snprintf(rpcRequest + length, sizeof(rpcRequest) - length,
+                     "],{\"searchTransactionHistory\":true}]}");
+  if ((size_t)length >= sizeof(rpcRequest)) {
+    return false;
+  }
+  if (!rpcCall(rpcRequest, length, rpcResponse, sizeof(rpcResponse))) {
+    return false;
+  }
+
+  JsonValue values;
+  if (!jsonFind(rpcResponse, "result.value", &values) || jsonArrayLength(values) != count) {
+    return false;
+  }
+  for (size_t i = 0; i < count; i++) {
+    char index[4];
+    JsonValue value, err, level;
+    snprintf(index, sizeof(index), "%u", (unsigned)i);
+    if (!jsonFindIn(values, index, &value)) {
+      return false;
+    }
+    errorCodes[i] = RPC_NO_ERROR_CODE;
+    if (jsonIsNull(value)) {
+      statuses[i] = RPC_SIGNATURE_UNKNOWN;
+    } else if (jsonFindIn(value, "err", &err) && !jsonIsNull(err)) {
+      statuses[i] = RPC_SIGNATURE_FAILED;
+      errorCodes[i] = rpcProgramErrorCode(err);
+    } else if (jsonFindIn(value, "confirmationStatus", &level) &&
+               (jsonIsString(level, "confirmed") || jsonIsString(level, "finalized"))) {
+      statuses[i] = RPC_SIGNATURE_CONFIRMED;
+    } else {
+      statuses[i] = RPC_SIGNATURE_PROCESSED;
+    }
+  }
+  return true;
+}
+
+/*****************************************************************************************
+* Function: RPC Program Error Code
+*
+* Description: Reads the custom program error of a failed transaction
+*              ({"InstructionError":[index,{"Custom":code}]})
+* Parameters: err - "err" value of a transaction status
+* Returns: uint32_t - program error code, RPC_NO_ERROR_CODE for any other error
+*****************************************************************************************/
+uint32_t rpcProgramErrorCode(const JsonValue& err) {
+  JsonValue custom;
+  uint64_t code;
+  if (!jsonFindIn(err, "InstructionError.1.Custom", &custom) || !jsonGetUint64(custom, &code) ||
+      code >= RPC_NO_ERROR_CODE) {
+    return RPC_NO_ERROR_CODE;
+  }
+  return (uint32_t)code;
+}
+
+/*****************************************************************************************
+* Function: RPC Get Account Data
+*
+* Description: Reads a slice of an account's data with getAccountInfo and a dataSlice, so
+*              only the requested bytes travel (base64) instead of the whole account
+* Parameters: address - 32-byte account address
+*             offset - first byte of the slice
+*             length - slice length (at most RPC_MAX_ACCOUNT_SLICE)
+*             data - destination, length bytes
+* Returns: bool - True if the account exists and the slice was read, false otherwise
+*****************************************************************************************/
+bool rpcGetAccountData(const uint8_t* address, size_t offset, size_t length, uint8_t* data) {
+  char addressBase58[PUBKEY_BASE58_SIZE];
+  if (length > RPC_MAX_ACCOUNT_SLICE || base58Encode(address, SOLANA_PUBKEY_SIZE, addressBase58, sizeof(addressBase58)) == 0) {
+    return false;
+  }
+
+  int requestLength = snprintf(rpcRequest, sizeof(rpcRequest),
+                               "{\"jsonrpc\":\"2.0\",\"id\":1,\"method\":\"getAccountInfo\","
+                               "\"params\":[\"%s\",{\"encoding\":\"base64\",\"dataSlice\":{\"offset\":%u,\"length\":%u}}]}",
+                               addressBase58, (unsigned)offset, (unsigned)length);
+  if (requestLength < 0 || (size_t)requestLength >= sizeof(rpcRequest)) {
+    return false;
+  }
+  if (!rpcCall(rpcRequest, requestLength, rpcResponse, sizeof(rpcResponse))) {
+    return false;
+  }
+
+  JsonValue encoded;
+  if (!jsonFind(rpcResponse, "result.value.data.0", &encoded) || encoded.length < 2 || encoded.start[0] != '"') {
+    return false;                       // Account does not exist
+  }
+  uint8_t decoded[RPC_MAX_ACCOUNT_SLICE];
+  size_t decodedLength = 0;
+  if (mbedtls_base64_decode(decoded, sizeof(decoded), &decodedLength,
+                            (const uint8_t*)encoded.start + 1, encoded.length - 2) != 0 ||
+      decodedLength != length) {
+    return false;
+  }
+  memcpy(data, decoded, length);
+  return true;
+}
+
+/*****************************************************************************************
+* Function: RPC Get SPL Token Balance
+*
+* Description: Gets the raw SPL token balance of a wallet for a given mint
+* Parameters: ownerBase58 - wallet address
+*             mintBase58 - token mint address
+*             outBalance - set to the raw token amount
+* Returns: bool - True if the balance was read, false otherwise
+*****************************************************************************************/
+bool rpcGetSplTokenBalance(const char* ownerBase58, const char* mintBase58, uint64_t& outBalance) {
+  int length = snprintf(rpcRequest, sizeof(rpcRequest),
+                        "{\"jsonrpc\":\"2.0\",\"id\":1,\"method\":\"getTokenAccountsByOwner\","
+                        "\"params\":[\"%s\",{\"mint\":\"%s\"},{\"encoding\":\"jsonParsed\"}]}",
+                        ownerBase58, mintBase58);
+  if (length < 0 || (size_t)length >= sizeof(rpcRequest)) {
+    return false;
+  }
+  if (!rpcCall(rpcRequest, length, rpcResponse, sizeof(rpcResponse))) {
+    return false;
+  }
+
+  JsonValue accounts;
+  if (!jsonFind(rpcResponse, "result.value", &accounts) || accounts.start[0] != '[') {
+    return false;
+  }
+  outBalance = 0;
+  size_t accountCount = jsonArrayLength(accounts);
+  for (size_t i = 0; i < accountCount; i++) {
+    char path[64];
+    JsonValue amountValue;
+    uint64_t amount;
+    snprintf(path, sizeof(path), "%u.account.data.parsed.info.tokenAmount.amount", (unsigned)i);
+    if (jsonFindIn(accounts, path, &amountValue) && jsonGetUint64(amountValue, &amount)) {
+      outBalance += amount;
+    }
+  }
+  return true;
+}
+
+/*****************************************************************************************
+* Function: RPC Stats
+*
+* Description: Connection and timing counters
+* Parameters: None
+* Returns: const RpcStats& - current counters
+*****************************************************************************************/
+const RpcStats& rpcStats() {
+  return stats;
+}
+
+/*****************************************************************************************
+* Function: Print RPC Stats
+*
+* Description: Prints handshake vs request timing and the health of every endpoint to
+*              the serial monitor
+* Parameters: None
+* Returns: None
+*****************************************************************************************/
+void printRpcStats() {
+  LOG_DEBUG("RPC requests: %u (%u failed), last %lums\n", stats.requests, stats.failures, stats.lastRequestMs);
+  LOG_DEBUG("RPC handshakes: %u, last %lums\n", stats.handshakes, stats.lastHandshakeMs);
+  for (size_t i = 0; i < endpointCount; i++) {
+    const RpcEndpoint& endpoint = endpoints[i];
+    LOG_DEBUG("RPC %s: %u requests, %u failed, %u rate limited, ~%lums, %u.%u%% errors\n",
+              endpoint.host.c_str(), endpoint.requests, endpoint.failures, endpoint.rateLimits,
+              (unsigned long)endpoint.latencyMs, endpoint.errorPerMille / 10, endpoint.errorPerMille % 10);
+  }
+}
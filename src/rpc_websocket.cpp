@@ -0,0 +1,650 @@
+/*****************************************************************************************
+ * RPC WebSocket
+ *
+ * wsService() never blocks on the socket while connected: it reads what has arrived into
+ * rxBuffer, handles every complete frame and keeps the rest for the next call. Message
+ * fields are looked up in place with json_scan. Only connecting
+ * blocks, for at most WS_HANDSHAKE_TIMEOUT_MS.
+ *
+ * Requests carry the slot index in their id (accounts from WS_ACCOUNT_ID_BASE, signatures
+ * from WS_SIGNATURE_ID_BASE), so a subscribe response maps back to its slot and the
+ * subscription id it returns to the notifications that follow.
+ *
+ * Not thread safe: only the network task calls into this module.
+ *
+ *****************************************************************************************/
+
+#include "rpc_websocket.h"
+#include <WiFi.h>
+#include <WiFiClientSecure.h>
+#include "mbedtls/base64.h"
+#include "mbedtls/sha1.h"
+#include "json_scan.h"
+#include "tx_template.h"
+#include "rpc_client.h"
+#include "wifi_manager.h"
+#include "logger.h"
+
+#define WS_OPCODE_CONTINUATION 0x0
+#define WS_OPCODE_TEXT 0x1
+#define WS_OPCODE_CLOSE 0x8
+#define WS_OPCODE_PING 0x9
+#define WS_OPCODE_PONG 0xA
+#define WS_GUID "258EAFA5-E914-47DA-95CA-C5AB0DC85B11"
+#define WS_KEY_SIZE 16
+#define WS_KEY_BASE64_SIZE 25           // 24 characters + terminator
+#define WS_HOST_SIZE 64
+#define WS_PATH_SIZE 128
+#define WS_ACCOUNT_ID_BASE 1
+#define WS_SIGNATURE_ID_BASE 32
+
+/*****************************************************************************************
+* Global Variables
+*****************************************************************************************/
+struct AccountSubscription {
+  bool used;
+  uint8_t address[SOLANA_PUBKEY_SIZE];
+  size_t offset;
+  size_t length;
+  WsAccountHandler handler;
+  bool subscribed;
+  uint32_t subscriptionId;
+};
+
+struct SignatureSubscription {
+  bool used;
+  char signature[SIGNATURE_BASE58_SIZE];
+  WsSignatureHandler handler;
+  bool subscribed;
+  uint32_t subscriptionId;
+};
+
+static WiFiClientSecure wsClient;
+static char wsHost[WS_HOST_SIZE];
+static char wsPath[WS_PATH_SIZE];
+static uint16_t wsPort = 443;
+static bool configured = false;
+static bool connected = false;
+static uint32_t sessions = 0;
+static unsigned long lastConnectAttempt = 0;
+static bool attempted = false;
+static unsigned long lastPingTime = 0;
+static AccountSubscription accounts[WS_MAX_ACCOUNTS];
+static SignatureSubscription signatures[WS_MAX_SIGNATURES];
+static uint8_t rxBuffer[WS_RX_BUFFER_SIZE + 1];  // + terminator of a payload ending the buffer
+static size_t rxLength = 0;
+static uint64_t discardRemaining = 0;   // Rest of an oversized frame still to be skipped
+static uint8_t txBuffer[WS_TX_BUFFER_SIZE];
+
+static bool wsConnect();
+static bool readHandshakeLine(char* line, size_t size, unsigned long deadline);
+static bool sendFrame(uint8_t opcode, const uint8_t* payload, size_t length);
+static bool sendAccountSubscribe(size_t slot);
+static bool sendSignatureSubscribe(size_t slot);
+static void processFrames();
+static void handleMessage(const char* json);
+
+/*****************************************************************************************
+* Function: WS Begin
+*
+* Description: Derives the wss endpoint from the https RPC URL. The connection is opened
+*              by the first wsService() call
+* Parameters: url - https URL of the JSON-RPC endpoint
+* Returns: bool - True if the URL could be parsed, false otherwise
+*****************************************************************************************/
+bool wsBegin(const char* url) {
+  configured = false;
+  if (strncmp(url, "https://", 8) != 0) {
+    LOG_ERROR("❌ WebSocket RPC URL must be https\n");
+    return false;
+  }
+
+  const char* host = url + 8;
+  const char* path = strchr(host, '/');
+  size_t hostLength = path ? (size_t)(path - host) : strlen(host);
+  const char* colon = (const char*)memchr(host, ':', hostLength);
+  wsPort = 443;
+  if (colon) {
+    wsPort = atoi(colon + 1) + 1;       // Solana convention: PubSub listens on the RPC port + 1
+    hostLength = colon - host;
+  }
+  if (hostLength == 0 || hostLength >= sizeof(wsHost) || (path && strlen(path) >= sizeof(wsPath))) {
+    LOG_ERROR("❌ WebSocket RPC URL too long\n");
+    return false;
+  }
+  memcpy(wsHost, host, hostLength);
+  wsHost[hostLength] = '\0';
+  strcpy(wsPath, path ? path : "/");
+
+  wsClient.setInsecure();
+  wsClient.setHandshakeTimeout(RPC_HANDSHAKE_TIMEOUT_S);
+  configured = true;
+  return true;
+}
+
+/*****************************************************************************************
+* Function: WS Subscribe Account
+*
+* Description: Registers an account whose changes are pushed to the handler. Subscribed
+*              right away when connected, otherwise on the next connect
+* Parameters: address - 32-byte account address
+*             offset - start of the data slice passed to the handler
+*             length - slice length
+*             handler - called with the slice after every change
+* Returns: bool - True if registered, false if all slots are used or the slice is invalid
+*****************************************************************************************/
+bool wsSubscribeAccount(const uint8_t* address, size_t offset, size_t length, WsAccountHandler handler) {
+  if (offset + length > WS_MAX_ACCOUNT_DATA) {
+    return false;
+  }
+  for (size_t i = 0; i < WS_MAX_ACCOUNTS; i++) {
+    AccountSubscription& account = accounts[i];
+    if (account.used) {
+      continue;
+    }
+    memcpy(account.address, address, SOLANA_PUBKEY_SIZE);
+    account.offset = offset;
+    account.length = length;
+    account.handler = handler;
+    account.subscribed = false;
+    account.used = true;
+    if (connected) {
+      sendAccountSubscribe(i);
+    }
+    return true;
+  }
+  return false;
+}
+
+/*****************************************************************************************
+* Function: WS Subscribe Signature
+*
+* Description: Watches a transaction until it is confirmed (commitment "confirmed")
+* Parameters: signature - base58 transaction signature
+*             handler - called once with the outcome
+* Returns: bool - True if watched, false if not connected or all slots are used
+*****************************************************************************************/
+bool wsSubscribeSignature(const char* signature, WsSignatureHandler handler) {
+  if (!connected || strlen(signature) >= SIGNATURE_BASE58_SIZE) {
+    return false;
+  }
+  for (size_t i = 0; i < WS_MAX_SIGNATURES; i++) {
+    SignatureSubscription& entry = signatures[i];
+    if (entry.used) {
+      continue;
+    }
+    strcpy(entry.signature, signature);
+    entry.handler = handler;
+    entry.subscribed = false;
+    entry.used = true;
+    if (!sendSignatureSubscribe(i)) {
+      entry.used = false;
+      return false;
+    }
+    return true;
+  }
+  return false;
+}
+
+/*****************************************************************************************
+* Function: WS Cancel Signature
+*
+* Description: Stops watching a transaction (e.g. after it was replaced by a resend)
+* Parameters: signature - base58 transaction signature
+* Returns: None
+*****************************************************************************************/
+void wsCancelSignature(const char* signature) {
+  for (size_t i = 0; i < WS_MAX_SIGNATURES; i++) {
+    SignatureSubscription& entry = signatures[i];
+    if (!entry.used || strcmp(entry.signature, signature) != 0) {
+      continue;
+    }
+    if (connected && entry.subscribed) {
+      char request[96];
+      int length = snprintf(request, sizeof(request),
+                            "{\"jsonrpc\":\"2.0\",\"id\":0,\"method\":\"signatureUnsubscribe\",\"params\":[%u]}",
+                            (unsigned)entry.subscriptionId);
+      sendFrame(WS_OPCODE_TEXT, (const uint8_t*)request, length);
+    }
+    entry.used = false;
+  }
+}
+
+/*****************************************************************************************
+* Function: WS Service
+*
+* Description: Connects (at most every WS_RECONNECT_MS) while the WiFi link is up, then
+*              handles received frames and sends the keepalive ping
+* Parameters: None
+* Returns: None
+*****************************************************************************************/
+void wsService() {
+  if (!configured) {
+    return;
+  }
+  if (connected && !wsClient.connected()) {
+    LOG_INFO("WebSocket connection lost\n");
+    wsDisconnect();
+  }
+  if (!connected) {
+    if (!wifiLinkUp() || (attempted && millis() - lastConnectAttempt < WS_RECONNECT_MS)) {
+      return;
+    }
+    attempted = true;
+    lastConnectAttempt = millis();
+    if (!wsConnect()) {
+      return;
+    }
+  }
+
+  int available;
+  while ((available = wsClient.available()) > 0) {
+    if (discardRemaining > 0) {
+      uint8_t scratch[64];
+      size_t skip = (size_t)min((uint64_t)sizeof(scratch), min(discardRemaining, (uint64_t)available));
+      int read = wsClient.read(scratch, skip);
+      if (read <= 0) {
+        break;
+      }
+      discardRemaining -= read;
+      continue;
+    }
+    size_t space = WS_RX_BUFFER_SIZE - rxLength;
+    int read = wsClient.read(rxBuffer + rxLength, min(space, (size_t)available));
+    if (read <= 0) {
+      break;
+    }
+    rxLength += read;
+    processFrames();
+    if (!connected) {
+      return;                           // Closed by the server
+    }
+  }
+
+  if (millis() - lastPingTime >= WS_PING_MS) {
+    lastPingTime = millis();
+    sendFrame(WS_OPCODE_PING, NULL, 0);
+  }
+}
+
+/*****************************************************************************************
+* Function: WS Connect
+*
+* Description: Opens the TLS connection, performs the HTTP upgrade (checking the
+*              Sec-WebSocket-Accept key) and renews the account subscriptions
+* Parameters: None
+* Returns: bool - True if connected, false otherwise
+*****************************************************************************************/
+static bool wsConnect() {
+  wsClient.stop();
+  if (!wsClient.connect(wsHost, wsPort)) {
+    LOG_ERROR("❌ WebSocket TLS handshake failed\n");
+    return false;
+  }
+
+  uint8_t key[WS_KEY_SIZE];
+  char keyBase64[WS_KEY_BASE64_SIZE];
+  size_t keyLength = 0;
+  for (size_t i = 0; i < WS_KEY_SIZE; i += 4) {
+    uint32_t random = esp_random();
+    memcpy(key + i, &random, 4);
+  }
+  mbedtls_base64_encode((uint8_t*)keyBase64, sizeof(keyBase64), &keyLength, key, sizeof(key));
+  keyBase64[keyLength] = '\0';
+
+  char request[WS_HOST_SIZE + WS_PATH_SIZE + 160];
+  int requestLength = snprintf(request, sizeof(request),
+                               "GET %s HTTP/1.1\r\nHost: %s\r\nUpgrade: websocket\r\nConnection: Upgrade\r\n"
+                               "Sec-WebSocket-Key: %s\r\nSec-WebSocket-Version: 13\r\n\r\n",
+                               wsPath, wsHost, keyBase64);
+  if (requestLength < 0 || (size_t)requestLength >= sizeof(request) ||
+      wsClient.write((const uint8_t*)request, requestLength) != (size_t)requestLength) {
+    wsClient.stop();
+    return false;
+  }
+
+  // Expected accept key: base64(SHA-1(key + GUID))
+  char acceptInput[WS_KEY_BASE64_SIZE + sizeof(WS_GUID)];
+  uint8_t acceptHash[20];
+  char expectedAccept[32];
+  size_t acceptLength = 0;
+  snprintf(acceptInput, sizeof(acceptInput), "%s%s", keyBase64, WS_GUID);
+  mbedtls_sha1_ret((const uint8_t*)acceptInput, strlen(acceptInput), acceptHash);
+  mbedtls_base64_encode((uint8_t*)expectedAccept, sizeof(expectedAccept), &acceptLength, acceptHash, sizeof(acceptHash));
+  expectedAccept[acceptLength] = '\0';
+
+  unsigned long deadline = millis() + WS_HANDSHAKE_TIMEOUT_MS;
+  char line[128];
+  bool upgraded = readHandshakeLine(line, sizeof(line), deadline) && strncmp(line, "HTTP/1.1 101", 12) == 0;
+  bool accepted = false;
+  while (upgraded && readHandshakeLine(line, sizeof(line), deadline) && line[0] != '\0') {
+    if (strncasecmp(line, "Sec-WebSocket-Accept:", 21) == 0) {
+      const char* value = line + 21;
+      while (*value == ' ') {
+        value++;
+      }
+      accepted = strcmp(value, expectedAccept) == 0;
+    }
+  }
+  if (!upgraded || !accepted || line[0] != '\0') {
+    LOG_ERROR("❌ WebSocket upgrade rejected\n");
+    wsClient.stop();
+    return false;
+  }
+
+  connected = true;
+  sessions++;
+  rxLength = 0;
+  discardRemaining = 0;
+  lastPingTime = millis();
+  for (size_t i = 0; i < WS_MAX_ACCOUNTS; i++) {
+    if (accounts[i].used) {
+      accounts[i].subscribed = false;
+      sendAccountSubscribe(i);
+    }
+  }
+  for (size_t i = 0; i < WS_MAX_SIGNATURES; i++) {
+    if (signatures[i].used) {
+      signatures[i].subscribed = false;
+      sendSignatureSubscribe(i);
+    }
+  }
+  LOG_INFO("✅ WebSocket connected to %s\n", wsHost);
+  return true;
+}
+
+/*****************************************************************************************
+* Function: Read Handshake Line
+*
+* Description: Reads one CRLF-terminated line of the upgrade response
+* Parameters: line - output buffer (line without CRLF, truncated to the buffer)
+*             size - buffer size
+*             deadline - millis() value by which the line must be complete
+* Returns: bool - True if a line was read, false on timeout or disconnect
+*****************************************************************************************/
+static bool readHandshakeLine(char* line, size_t size, unsigned long deadline) {
+  size_t length = 0;
+  while ((long)(deadline - millis()) > 0 && wsClient.connected()) {
+    if (wsClient.available() <= 0) {
+      delay(10);
+      continue;
+    }
+    int c = wsClient.read();
+    if (c == '\n') {
+      if (length > 0 && line[length - 1] == '\r') {
+        length--;
+      }
+      line[length] = '\0';
+      return true;
+    }
+    if (c >= 0 && length + 1 < size) {
+      line[length++] = (char)c;
+    }
+  }
+  return false;
+}
+
+/*****************************************************************************************
+* Function: WS Disconnect
+*
+* Description: Closes the connection (e.g. before WiFi is turned off). Registered accounts
+*              and watched signatures are kept and subscribed again on the next connect
+* Parameters: None
+* Returns: None
+*****************************************************************************************/
+void wsDisconnect() {
+  if (connected && wsClient.connected()) {
+    sendFrame(WS_OPCODE_CLOSE, NULL, 0);
+  }
+  wsClient.stop();
+  connected = false;
+}
+
+/*****************************************************************************************
+* Function: WS Connected / Sessions
+*
+* Description: Whether the connection is open / number of connections opened so far (a
+*              change means notifications may have been missed in between)
+* Parameters: None
+* Returns: bool / uint32_t - connection state
+*****************************************************************************************/
+bool wsConnected() {
+  return connected;
+}
+
+uint32_t wsSessions() {
+  return sessions;
+}
+
+/*****************************************************************************************
+* Function: Send Frame
+*
+* Description: Sends a single masked client frame
+* Parameters: opcode - frame opcode
+*             payload - frame payload (may be NULL if length is 0)
+*             length - payload length
+* Returns: bool - True if the frame was written, false otherwise
+*****************************************************************************************/
+static bool sendFrame(uint8_t opcode, const uint8_t* payload, size_t length) {
+  size_t headerLength = length < 126 ? 6 : 8;
+  if (headerLength + length > sizeof(txBuffer)) {
+    return false;
+  }
+
+  txBuffer[0] = 0x80 | opcode;          // FIN, unfragmented
+  if (length < 126) {
+    txBuffer[1] = 0x80 | (uint8_t)length;
+  } else {
+    txBuffer[1] = 0x80 | 126;
+    txBuffer[2] = (uint8_t)(length >> 8);
+    txBuffer[3] = (uint8_t)length;
+  }
+  uint32_t mask = esp_random();
+  uint8_t* maskKey = txBuffer + headerLength - 4;
+  memcpy(maskKey, &mask, 4);
+  for (size_t i = 0; i < length; i++) {
+    txBuffer[headerLength + i] = payload[i] ^ maskKey[i % 4];
+  }
+  return wsClient.write(txBuffer, headerLength + length) == headerLength + length;
+}
+
+/*****************************************************************************************
+* Function: Send Account Subscribe / Send Signature Subscribe
+*
+* Description: Sends the subscribe request of a slot
+* Parameters: slot - account or signature slot index
+* Returns: bool - True if sent, false otherwise
+*****************************************************************************************/
+static bool sendAccountSubscribe(size_t slot) {
+  char address[PUBKEY_BASE58_SIZE];
+  char request[192];
+  if (base58Encode(accounts[slot].address, SOLANA_PUBKEY_SIZE, address, sizeof(address)) == 0) {
+    return false;
+  }
+  int length = snprintf(request, sizeof(request),
+                        "{\"jsonrpc\":\"2.0\",\"id\":%u,\"method\":\"accountSubscribe\","
+                        "\"params\":[\"%s\",{\"encoding\":\"base64\",\"commitment\":\"confirmed\"}]}",
+                        (unsigned)(WS_ACCOUNT_ID_BASE + slot), address);
+  return length > 0 && (size_t)length < sizeof(request) &&
+         sendFrame(WS_OPCODE_TEXT, (const uint8_t*)request, length);
+}
+
+static bool sendSignatureSubscribe(size_t slot) {
+  char request[WS_TX_BUFFER_SIZE - 8];
+  int length = snprintf(request, sizeof(request),
+                        "{\"jsonrpc\":\"2.0\",\"id\":%u,\"method\":\"signatureSubscribe\","
+                        "\"params\":[\"%s\",{\"commitment\":\"confirmed\"}]}",
+                        (unsigned)(WS_SIGNATURE_ID_BASE + slot), signatures[slot].signature);
+  return length > 0 && (size_t)length < sizeof(request) &&
+         sendFrame(WS_OPCODE_TEXT, (const uint8_t*)request, length);
+}
+
+/*****************************************************************************************
+* Function: Process Frames
+*
+* Description: Handles every complete frame in rxBuffer and moves the remainder to the
+*              front. Frames that can never fit the buffer are skipped
+* Parameters: None
+* Returns: None
+*****************************************************************************************/
+static void processFrames() {
+  size_t offset = 0;
+  while (connected && rxLength - offset >= 2) {
+    uint8_t* frame = rxBuffer + offset;
+    size_t available = rxLength - offset;
+    bool final = frame[0] & 0x80;
+    uint8_t opcode = frame[0] & 0x0f;
+    bool masked = frame[1] & 0x80;
+    uint64_t payloadLength = frame[1] & 0x7f;
+    size_t headerLength = 2;
+    if (payloadLength == 126) {
+      if (available < 4) {
+        break;
+      }
+      payloadLength = ((uint64_t)frame[2] << 8) | frame[3];
+      headerLength = 4;
+    } else if (payloadLength == 127) {
+      if (available < 10) {
+        break;
+      }
+      payloadLength = 0;
+      for (int i = 2; i < 10; i++) {
+        payloadLength = (payloadLength << 8) | frame[i];
+      }
+      headerLength = 10;
+    }
+    if (masked) {
+      headerLength += 4;                // Servers must not mask, but tolerate it
+    }
+    uint64_t frameLength = headerLength + payloadLength;
+
+    if (frameLength > WS_RX_BUFFER_SIZE) {
+      LOG_ERROR("❌ WebSocket frame of %llu bytes skipped\n", (unsigned long long)payloadLength);
+      size_t consumed = (size_t)min(frameLength, (uint64_t)available);
+      discardRemaining = frameLength - consumed;
+      offset += consumed;
+      continue;
+    }
+    if (available < frameLength) {
+      break;
+    }
+
+    uint8_t* payload = frame + headerLength;
+    if (masked) {
+      for (size_t i = 0; i < payloadLength; i++) {
+        payload[i] ^= frame[headerLength - 4 + (i % 4)];
+      }
+    }
+    offset += frameLength;
+
+    switch (opcode) {
+      case WS_OPCODE_TEXT: {
+        if (!final) {
+          LOG_ERROR("❌ Fragmented WebSocket message dropped\n");
+          break;
+        }
+        uint8_t saved = payload[payloadLength];
+        payload[payloadLength] = '\0';
+        handleMessage((const char*)payload);
+        payload[payloadLength] = saved;
+        break;
+      }
+      case WS_OPCODE_PING:
+        sendFrame(WS_OPCODE_PONG, payload, payloadLength);
+        break;
+      case WS_OPCODE_CLOSE:
+        LOG_INFO("WebSocket closed by server\n");
+        wsDisconnect();
+        break;
+      default:
+        break;                          // Pong, continuation (of a dropped message)
+    }
+  }
+
+  if (offset >= rxLength) {
+    rxLength = 0;
+  } else if (offset > 0) {
+    memmove(rxBuffer, rxBuffer + offset, rxLength - offset);
+    rxLength -= offset;
+  }
+}
+
+/*****************************************************************************************
+* Function: Handle Message
+*
+* Description: Dispatches a JSON-RPC message: subscribe responses record the subscription
+*              id, notifications go to the handler of their subscription
+* Parameters: json - null-terminated message
+* Returns: None
+*****************************************************************************************/
+static void handleMessage(const char* json) {
+  JsonValue field;
+  uint64_t number;
+
+  if (jsonFind(json, "id", &field)) {
+    if (!jsonGetUint64(field, &number)) {
+      return;
+    }
+    unsigned id = (unsigned)number;
+    bool subscribed = jsonFind(json, "result", &field) && jsonGetUint64(field, &number);
+    if (id >= WS_ACCOUNT_ID_BASE && id < WS_ACCOUNT_ID_BASE + WS_MAX_ACCOUNTS) {
+      accounts[id - WS_ACCOUNT_ID_BASE].subscriptionId = (uint32_t)number;
+      accounts[id - WS_ACCOUNT_ID_BASE].subscribed = subscribed;
+    } else if (id >= WS_SIGNATURE_ID_BASE && id < WS_SIGNATURE_ID_BASE + WS_MAX_SIGNATURES) {
+      signatures[id - WS_SIGNATURE_ID_BASE].subscriptionId = (uint32_t)number;
+      signatures[id - WS_SIGNATURE_ID_BASE].subscribed = subscribed;
+      if (!subscribed) {
+        signatures[id - WS_SIGNATURE_ID_BASE].used = false;   // The status poll covers it
+      }
+    } else {
+      return;                           // Unsubscribe response
+    }
+    if (!subscribed) {
+      LOG_ERROR("❌ WebSocket request %u failed\n", id);
+    }
+    return;
+  }
+
+  JsonValue method, value;
+  if (!jsonFind(json, "method", &method) ||
+      !jsonFind(json, "params.subscription", &field) || !jsonGetUint64(field, &number) ||
+      !jsonFind(json, "params.result.value", &value)) {
+    return;
+  }
+  uint32_t subscriptionId = (uint32_t)number;
+
+  if (jsonIsString(method, "accountNotification")) {
+    for (size_t i = 0; i < WS_MAX_ACCOUNTS; i++) {
+      AccountSubscription& account = accounts[i];
+      if (!account.used || !account.subscribed || account.subscriptionId != subscriptionId) {
+        continue;
+      }
+      JsonValue encoded;
+      uint8_t data[WS_MAX_ACCOUNT_DATA];
+      size_t dataLength = 0;
+      if (!jsonFindIn(value, "data.0", &encoded) || encoded.length < 2 || encoded.start[0] != '"' ||
+          mbedtls_base64_decode(data, sizeof(data), &dataLength, (const uint8_t*)encoded.start + 1, encoded.length - 2) != 0 ||
+          dataLength < account.offset + account.length) {
+        LOG_ERROR("❌ Invalid account notification\n");
+        return;
+      }
+      account.handler(data + account.offset, account.length);
+      return;
+    }
+  } else if (jsonIsString(method, "signatureNotification")) {
+    for (size_t i = 0; i < WS_MAX_SIGNATURES; i++) {
+      SignatureSubscription& entry = signatures[i];
+      if (!entry.used || !entry.subscribed || entry.subscriptionId != subscriptionId) {
+        continue;
+      }
+      JsonValue err;
+      bool success = !jsonFindIn(value, "err", &err) || jsonIsNull(err);
+      uint32_t errorCode = success ? RPC_NO_ERROR_CODE : rpcProgramErrorCode(err);
+      char signature[SIGNATURE_BASE58_SIZE];
+      strcpy(signature, entry.signature);
+      entry.used = false;               // Removed by the server after the notification
+      entry.handler(signature, success, errorCode);
+      return;
+    }
+  }
+}
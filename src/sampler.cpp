@@ -0,0 +1,247 @@
+/*****************************************************************************************
+ * Sampler
+ *
+ * ADC continuous mode converts the sensor channels at SAMPLER_ADC_RATE_HZ each straight into
+ * DMA buffers, one pattern entry per channel. The sampler task blocks until a frame is
+ * ready (so the core is idle in the meantime), averages SAMPLER_OVERSAMPLE conversions
+ * per sample and appends the result to a single-producer / single-consumer ring.
+ *
+ * The rings are a structure of arrays, one contiguous ring per channel behind a shared
+ * head, so the filter streams each channel's samples without striding over the others.
+ * A sample index is published once every channel has produced it. Conversions lost in a
+ * driver pool overflow would shift channels against each other, so after an overflow the
+ * channels ahead are cut back to the slowest one (dropping at most its partial samples).
+ *
+ * Sample N was taken at a fixed offset of N * SAMPLE_PERIOD_US from the start of
+ * conversion, which gives beat timestamps millisecond precision regardless of when the
+ * loop gets around to reading them. Samples skipped after a consumer overrun keep their
+ * indices, so the next block's first index jumps by the lost samples and the consumer can
+ * tell the gap.
+ *
+ *****************************************************************************************/
+
+#include "sampler.h"
+#include "driver/adc.h"
+#include "logger.h"
+#include "instrumentation.h"
+
+/*****************************************************************************************
+* Global Variables
+*****************************************************************************************/
+#define SAMPLE_RING_MASK (SAMPLE_RING_SIZE - 1)
+#define SAMPLER_FRAME_BYTES (SAMPLER_FRAME_CONVERSIONS * sizeof(adc_digi_output_data_t))
+// Samples per channel one frame can complete (plus the one carried over in the accumulator)
+#define SAMPLER_FRAME_SAMPLES (SAMPLER_FRAME_CONVERSIONS / (SAMPLER_OVERSAMPLE * SAMPLER_CHANNELS) + 1)
+
+static_assert((SAMPLE_RING_SIZE & SAMPLE_RING_MASK) == 0, "SAMPLE_RING_SIZE must be a power of two");
+static_assert(SAMPLER_ADC_RATE_HZ % SAMPLER_OVERSAMPLE == 0, "SAMPLER_ADC_RATE_HZ must be a multiple of SAMPLER_OVERSAMPLE");
+static_assert(SAMPLER_FRAME_SAMPLES < SAMPLE_RING_SIZE / 2, "SAMPLE_RING_SIZE must hold more than two DMA frames");
+static_assert(SAMPLER_CHANNELS > 0 && SAMPLER_CHANNELS <= SOC_ADC_PATT_LEN_MAX, "SAMPLER_CHANNELS exceeds the ADC pattern table");
+
+static uint16_t sampleRing[SAMPLER_CHANNELS][SAMPLE_RING_SIZE];
+static volatile uint32_t sampleHead = 0;     // Total samples written on every channel (producer)
+static uint32_t sampleTail = 0;              // Total samples read (consumer)
+static uint32_t sampleOverruns = 0;
+
+static uint8_t adcChannels[SAMPLER_CHANNELS];
+static uint8_t channelSlot[SOC_ADC_CHANNEL_NUM(0)];  // ADC1 channel -> ring, SAMPLER_CHANNELS if unused
+static unsigned long samplerStartMs = 0;
+static TaskHandle_t samplerTaskHandle = NULL;
+
+static void samplerTask(void* parameter);
+
+/*****************************************************************************************
+* Function: Sampler Begin
+*
+* Description: Configures ADC1 continuous mode to scan the given pins and starts the sampler
+*              task
+* Parameters: pins - SAMPLER_CHANNELS analog pins of the sensors, ring order (must be
+*                    distinct ADC1 channels, ADC2 is used by WiFi)
+* Returns: bool - True if the ADC and task were started, false otherwise
+*****************************************************************************************/
+bool samplerBegin(const uint8_t* pins) {
+  uint32_t channelMask = 0;
+  for (uint32_t i = 0; i < SOC_ADC_CHANNEL_NUM(0); i++) {
+    channelSlot[i] = SAMPLER_CHANNELS;
+  }
+  for (uint32_t c = 0; c < SAMPLER_CHANNELS; c++) {
+    int8_t channel = digitalPinToAnalogChannel(pins[c]);
+    if (channel < 0 || channel >= SOC_ADC_CHANNEL_NUM(0) || (channelMask & BIT(channel))) {
+      LOG_ERROR("❌ Sampler pin %u is not a distinct ADC1 channel\n", pins[c]);
+      return false;
+    }
+    adcChannels[c] = channel;
+    channelSlot[channel] = c;
+    channelMask |= BIT(channel);
+  }
+
+  adc_digi_init_config_t dmaConfig = {};
+  dmaConfig.max_store_buf_size = SAMPLER_FRAME_BYTES * 4;
+  dmaConfig.conv_num_each_intr = SAMPLER_FRAME_BYTES;
+  dmaConfig.adc1_chan_mask = channelMask;
+  dmaConfig.adc2_chan_mask = 0;
+  if (adc_digi_initialize(&dmaConfig) != ESP_OK) {
+    LOG_ERROR("❌ ADC DMA initialization failed\n");
+    return false;
+  }
+
+  adc_digi_pattern_config_t patterns[SAMPLER_CHANNELS] = {};
+  for (uint32_t c = 0; c < SAMPLER_CHANNELS; c++) {
+    patterns[c].atten = ADC_ATTEN_DB_11;       // Same range as analogRead()
+    patterns[c].channel = adcChannels[c];
+    patterns[c].unit = 0;                      // ADC1
+    patterns[c].bit_width = SOC_ADC_DIGI_MAX_BITWIDTH;
+  }
+
+  adc_digi_configuration_t digiConfig = {};
+  digiConfig.conv_limit_en = false;
+  digiConfig.conv_limit_num = 250;
+  digiConfig.pattern_num = SAMPLER_CHANNELS;
+  digiConfig.adc_pattern = patterns;
+  digiConfig.sample_freq_hz = SAMPLER_ADC_RATE_HZ * SAMPLER_CHANNELS;  // The pattern shares the rate
+  digiConfig.conv_mode = ADC_CONV_SINGLE_UNIT_1;
+  digiConfig.format = ADC_DIGI_OUTPUT_FORMAT_TYPE2;
+  if (adc_digi_controller_configure(&digiConfig) != ESP_OK) {
+    LOG_ERROR("❌ ADC DMA configuration failed\n");
+    adc_digi_deinitialize();
+    return false;
+  }
+
+  BaseType_t created = xTaskCreatePinnedToCore(
+    samplerTask,
+    "samplerTask",
+    SAMPLER_TASK_STACK_SIZE,
+    NULL,
+    SAMPLER_TASK_PRIORITY,
+    &samplerTaskHandle,
+    SAMPLER_TASK_CORE
+  );
+  if (created != pdPASS) {
+    adc_digi_deinitialize();
+    return false;
+  }
+
+  samplerStartMs = millis();
+  adc_digi_start();
+  return true;
+}
+
+/*****************************************************************************************
+* Function: Sampler Read
+*
+* Description: Copies the oldest unread samples of every channel out of the rings. If the
+*              consumer fell so far behind that the producer may already be writing over
+*              the oldest unread samples (it fills a frame ahead of the published head),
+*              they are skipped and counted as overrun; firstIndex then advances past
+*              them, so sample times stay exact and the gap shows
+* Parameters: samples - destination, SAMPLER_CHANNELS blocks of maxSamples (channel c
+*                       starts at samples + c * maxSamples)
+*             maxSamples - capacity of the destination per channel
+*             firstIndex - set to the sample index of the first sample of each block
+* Returns: size_t - number of samples copied
+*****************************************************************************************/
+size_t samplerRead(uint16_t* samples, size_t maxSamples, uint32_t* firstIndex) {
+  uint32_t head = __atomic_load_n(&sampleHead, __ATOMIC_ACQUIRE);
+
+  if (head - sampleTail > SAMPLE_RING_SIZE - SAMPLER_FRAME_SAMPLES) {
+    // Leave half a ring of headroom so the producer does not overwrite what we copy
+    uint32_t skipTo = head - SAMPLE_RING_SIZE / 2;
+    sampleOverruns += skipTo - sampleTail;
+    sampleTail = skipTo;
+  }
+
+  size_t count = head - sampleTail;
+  if (count > maxSamples) {
+    count = maxSamples;
+  }
+
+  *firstIndex = sampleTail;
+  for (uint32_t c = 0; c < SAMPLER_CHANNELS; c++) {
+    uint16_t* block = samples + c * maxSamples;
+    for (size_t i = 0; i < count; i++) {
+      block[i] = sampleRing[c][(sampleTail + i) & SAMPLE_RING_MASK];
+    }
+  }
+  sampleTail += count;
+  return count;
+}
+
+/*****************************************************************************************
+* Function: Sampler Sample Time
+*
+* Description: Converts a sample index into a millis() timestamp
+* Parameters: sampleIndex - index returned by samplerRead()
+* Returns: unsigned long - time the sample was taken in ms
+*****************************************************************************************/
+unsigned long samplerSampleTimeMs(uint32_t sampleIndex) {
+  return samplerStartMs + (unsigned long)(((uint64_t)sampleIndex * 1000) / SAMPLE_RATE_HZ);
+}
+
+/*****************************************************************************************
+* Function: Sampler Overruns
+*
+* Description: Number of samples dropped because the consumer did not keep up
+* Parameters: None
+* Returns: uint32_t - dropped sample count
+*****************************************************************************************/
+uint32_t samplerOverruns() {
+  return sampleOverruns;
+}
+
+/*****************************************************************************************
+* Function: Sampler Task
+*
+* Description: Reads DMA frames, oversamples them and appends the samples to the rings
+* Parameters: parameter - unused
+* Returns: None
+*****************************************************************************************/
+static void samplerTask(void* parameter) {
+  static uint8_t frame[SAMPLER_FRAME_BYTES];
+  uint32_t accumulator[SAMPLER_CHANNELS] = {};
+  uint8_t accumulated[SAMPLER_CHANNELS] = {};
+  uint32_t written[SAMPLER_CHANNELS] = {};     // Samples written per channel
+
+  for (;;) {
+    uint32_t length = 0;
+    esp_err_t err = adc_digi_read_bytes(frame, SAMPLER_FRAME_BYTES, &length, ADC_MAX_DELAY);
+    // ESP_ERR_INVALID_STATE means the driver's internal pool overflowed, the data is still valid
+    bool overflow = (err == ESP_ERR_INVALID_STATE);
+    if (overflow) {
+      instrumentCount(COUNTER_ADC_POOL_OVERFLOWS);
+    } else if (err != ESP_OK) {
+      continue;
+    }
+    uint32_t frameStart = instrumentStart();
+
+    for (uint32_t i = 0; i + sizeof(adc_digi_output_data_t) <= length; i += sizeof(adc_digi_output_data_t)) {
+      const adc_digi_output_data_t* conversion = (const adc_digi_output_data_t*)&frame[i];
+      uint32_t channel = conversion->type2.channel;
+      uint32_t c = channel < SOC_ADC_CHANNEL_NUM(0) ? channelSlot[channel] : SAMPLER_CHANNELS;
+      if (c == SAMPLER_CHANNELS) {
+        continue;
+      }
+      accumulator[c] += conversion->type2.data;
+      if (++accumulated[c] == SAMPLER_OVERSAMPLE) {
+        sampleRing[c][written[c] & SAMPLE_RING_MASK] = accumulator[c] / SAMPLER_OVERSAMPLE;
+        written[c]++;
+        accumulator[c] = 0;
+        accumulated[c] = 0;
+      }
+    }
+
+    // Publish the scans every channel has completed
+    uint32_t head = written[0];
+    for (uint32_t c = 1; c < SAMPLER_CHANNELS; c++) {
+      head = (int32_t)(written[c] - head) < 0 ? written[c] : head;
+    }
+    if (overflow && SAMPLER_CHANNELS > 1) {
+      for (uint32_t c = 0; c < SAMPLER_CHANNELS; c++) {
+        written[c] = head;
+        accumulator[c] = 0;
+        accumulated[c] = 0;
+      }
+    }
+    __atomic_store_n(&sampleHead, head, __ATOMIC_RELEASE);
+    instrumentStop(STAGE_ADC_WINDOW, frameStart);
+  }
+}
@@ -0,0 +1,111 @@
+/*****************************************************************************************
+ * Signal Filter
+ *
+ * Per sample: x = 12-bit ADC value
+ *   mains:    m = (sum of the last FILTER_MAINS_TAPS x) / FILTER_MAINS_TAPS, in Q8
+ *   highpass: h = m - m[-1] + h[-1] - (h[-1] >> FILTER_HIGHPASS_SHIFT)
+ *   lowpass:  l1 += (h - l1) >> FILTER_LOWPASS_SHIFT; l2 += (l1 - l2) >> FILTER_LOWPASS_SHIFT
+ *
+ * The moving average keeps a running sum over a circular history, so it costs one add and
+ * one subtract per sample regardless of its length. Division by the constant tap count
+ * compiles to a multiply. Q8 values of a 12-bit input stay below 2^21, well inside int32.
+ *
+ * Each channel keeps its state in one FilterState, so a block touches one contiguous struct
+ * (history included) and nothing of the other channels.
+ *
+ * Called from the loop only.
+ *
+ *****************************************************************************************/
+
+#include "signal_filter.h"
+
+/*****************************************************************************************
+* Global Variables
+*****************************************************************************************/
+static_assert(FILTER_MAINS_TAPS > 0, "SAMPLE_RATE_HZ must be at least FILTER_MAINS_HZ");
+
+struct FilterState {
+  uint32_t mainsSum;
+  uint32_t mainsIndex;
+  int32_t previousMains;
+  int32_t highpass;
+  int32_t lowpass1;
+  int32_t lowpass2;
+  bool primed;
+  uint16_t mainsHistory[FILTER_MAINS_TAPS];
+};
+
+static FilterState channels[SAMPLER_CHANNELS];
+
+/*****************************************************************************************
+* Function: Filter Reset
+*
+* Description: Clears the filter state of every channel; the next sample re-primes it
+* Parameters: None
+* Returns: None
+*****************************************************************************************/
+void filterReset() {
+  for (uint32_t c = 0; c < SAMPLER_CHANNELS; c++) {
+    channels[c].primed = false;
+  }
+}
+
+/*****************************************************************************************
+* Function: Filter Process Block
+*
+* Description: Band-pass filters a block of consecutive samples of one channel
+* Parameters: channel - sampler channel (below SAMPLER_CHANNELS)
+*             samples - raw ADC samples
+*             count - number of samples
+*             output - filtered values in Q-format (FILTER_Q_BITS), count entries
+* Returns: None
+*****************************************************************************************/
+void filterProcessBlock(uint32_t channel, const uint16_t* samples, size_t count, int32_t* output) {
+  if (count == 0 || channel >= SAMPLER_CHANNELS) {
+    return;
+  }
+  FilterState& state = channels[channel];
+
+  // Start from the first sample as steady state so the DC step does not ring through
+  if (!state.primed) {
+    for (uint32_t i = 0; i < FILTER_MAINS_TAPS; i++) {
+      state.mainsHistory[i] = samples[0];
+    }
+    state.mainsSum = (uint32_t)samples[0] * FILTER_MAINS_TAPS;
+    state.mainsIndex = 0;
+    state.previousMains = (int32_t)samples[0] << FILTER_Q_BITS;
+    state.highpass = 0;
+    state.lowpass1 = 0;
+    state.lowpass2 = 0;
+    state.primed = true;
+  }
+
+  // Work on locals so the state stays in registers for the whole block
+  uint32_t sum = state.mainsSum;
+  uint32_t index = state.mainsIndex;
+  int32_t previous = state.previousMains;
+  int32_t h = state.highpass;
+  int32_t l1 = state.lowpass1;
+  int32_t l2 = state.lowpass2;
+
+  for (size_t i = 0; i < count; i++) {
+    sum += samples[i];
+    sum -= state.mainsHistory[index];
+    state.mainsHistory[index] = samples[i];
+    index = (index + 1 == FILTER_MAINS_TAPS) ? 0 : index + 1;
+
+    int32_t mains = (int32_t)((sum << FILTER_Q_BITS) / FILTER_MAINS_TAPS);
+    h = mains - previous + h - (h >> FILTER_HIGHPASS_SHIFT);
+    previous = mains;
+    l1 += (h - l1) >> FILTER_LOWPASS_SHIFT;
+    l2 += (l1 - l2) >> FILTER_LOWPASS_SHIFT;
+    output[i] = l2;
+  }
+
+  state.mainsSum = sum;
+  state.mainsIndex = index;
+  state.previousMains = previous;
+  state.highpass = h;
+  state.lowpass1 = l1;
+  state.lowpass2 = l2;
+}
@@ -0,0 +1,115 @@
+/*****************************************************************************************
+ * Signal Quality
+ *
+ * Everything is accumulated as counts and sums (intervals and their squares), so a window
+ * costs a few adds per beat and one compare per sample, and the scores are derived once
+ * per reading.
+ *
+ * Called from the loop only (sampling and detection run there).
+ *
+ *****************************************************************************************/
+
+#include "signal_quality.h"
+#include <math.h>
+
+/*****************************************************************************************
+* Global Variables
+*****************************************************************************************/
+static uint32_t sampleCount = 0;
+static uint32_t clippedCount = 0;
+static uint32_t candidateCount = 0;
+static uint32_t beatCount = 0;
+static uint64_t intervalSum = 0;
+static uint64_t intervalSquareSum = 0;
+static int64_t amplitudeSum = 0;
+
+/*****************************************************************************************
+* Function: Quality Reset
+*
+* Description: Starts a new window
+* Parameters: None
+* Returns: None
+*****************************************************************************************/
+void qualityReset() {
+  sampleCount = 0;
+  clippedCount = 0;
+  candidateCount = 0;
+  beatCount = 0;
+  intervalSum = 0;
+  intervalSquareSum = 0;
+  amplitudeSum = 0;
+}
+
+/*****************************************************************************************
+* Function: Quality Add Samples
+*
+* Description: Counts raw samples and the saturated ones among them (finger pressed too
+*              hard, ambient light, sensor off the skin)
+* Parameters: samples - raw samples
+*             count - number of samples
+* Returns: None
+*****************************************************************************************/
+void qualityAddSamples(const uint16_t* samples, size_t count) {
+  uint32_t clipped = 0;
+  for (size_t i = 0; i < count; i++) {
+    clipped += (samples[i] == 0 || samples[i] >= SIGNAL_QUALITY_ADC_MAX);
+  }
+  sampleCount += count;
+  clippedCount += clipped;
+}
+
+/*****************************************************************************************
+* Function: Quality Add Beat
+*
+* Description: Records a beat candidate of the detector
+* Parameters: accepted - True if it updated the heart rate
+*             intervalMs - interval to the previous beat (accepted beats only)
+*             amplitude - pulse amplitude (filtered units) when it was detected
+* Returns: None
+*****************************************************************************************/
+void qualityAddBeat(bool accepted, uint32_t intervalMs, int32_t amplitude) {
+  candidateCount++;
+  if (!accepted) {
+    return;
+  }
+  beatCount++;
+  intervalSum += intervalMs;
+  intervalSquareSum += (uint64_t)intervalMs * intervalMs;
+  amplitudeSum += amplitude;
+}
+
+/*****************************************************************************************
+* Function: Quality Score
+*
+* Description: Signal quality index of the current window
+* Parameters: None
+* Returns: uint8_t - 0 (unusable) to 100
+*****************************************************************************************/
+uint8_t qualityScore() {
+  if (sampleCount == 0 || beatCount < SIGNAL_QUALITY_MIN_BEATS) {
+    return 0;
+  }
+
+  // Clipping: 10% saturated samples score 0
+  uint32_t clippedPerMille = (uint32_t)((uint64_t)clippedCount * 1000 / sampleCount);
+  int32_t clipScore = 100 - (int32_t)clippedPerMille;
+
+  // Amplitude: mean pulse amplitude against a clear signal
+  int64_t amplitude = amplitudeSum / beatCount;
+  int32_t amplitudeScore = (int32_t)(amplitude * 100 / SIGNAL_QUALITY_GOOD_AMPLITUDE);
+
+  // Acceptance: candidates rejected as doubled or implausible beats
+  int32_t acceptanceScore = (int32_t)(beatCount * 100 / candidateCount);
+
+  // Regularity: coefficient of variation of the beat intervals
+  // (n * sum(x^2) - sum(x)^2 is exact in integers, so single precision is enough after it)
+  uint64_t spread = beatCount * intervalSquareSum - intervalSum * intervalSum;
+  float cvPercent = intervalSum > 0 ? 100.0f * sqrtf((float)spread) / intervalSum : 0;
+  int32_t regularityScore = 100 - (int32_t)(cvPercent * 100 / SIGNAL_QUALITY_MAX_CV_PERCENT);
+
+  int32_t score = clipScore;
+  score = amplitudeScore < score ? amplitudeScore : score;
+  score = acceptanceScore < score ? acceptanceScore : score;
+  score = regularityScore < score ? regularityScore : score;
+  return (uint8_t)(score < 0 ? 0 : (score > 100 ? 100 : score));
+}
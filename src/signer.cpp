@@ -0,0 +1,102 @@
+/*****************************************************************************************
+ * Signer
+ *
+ * The context is written once by signerBegin() before the network task starts and only
+ * read afterwards, so it needs no locking. The public key half of the secret key is
+ * re-derived from the seed at boot: a mismatched key would otherwise only show up as
+ * transactions rejected for an invalid signature.
+ *
+ *****************************************************************************************/
+
+#include "signer.h"
+#include <string.h>
+#if SIGNER_USE_SODIUM
+#include <sodium.h>
+#else
+#include <Ed25519.h>
+#endif
+
+/*****************************************************************************************
+* Global Variables
+*****************************************************************************************/
+static uint8_t signingKey[SIGNER_SECRET_KEY_SIZE];
+static bool signerReady = false;
+
+/*****************************************************************************************
+* Function: Signer Begin
+*
+* Description: Initializes the backend and stores the signing key after checking that
+*              its public key half matches the one derived from the seed
+* Parameters: secretKey - SIGNER_SECRET_KEY_SIZE bytes, seed followed by the public key
+* Returns: bool - True if the key is usable, false otherwise
+*****************************************************************************************/
+bool signerBegin(const uint8_t* secretKey) {
+  uint8_t derivedPublicKey[SIGNER_PUBLIC_KEY_SIZE];
+
+#if SIGNER_USE_SODIUM
+  uint8_t derivedSecretKey[SIGNER_SECRET_KEY_SIZE];
+  if (sodium_init() < 0) {
+    return false;
+  }
+  crypto_sign_ed25519_seed_keypair(derivedPublicKey, derivedSecretKey, secretKey);
+  sodium_memzero(derivedSecretKey, sizeof(derivedSecretKey));
+#else
+  Ed25519::derivePublicKey(derivedPublicKey, secretKey);
+#endif
+
+  if (memcmp(derivedPublicKey, secretKey + SIGNER_SEED_SIZE, SIGNER_PUBLIC_KEY_SIZE) != 0) {
+    return false;
+  }
+
+  memcpy(signingKey, secretKey, sizeof(signingKey));
+  signerReady = true;
+  return true;
+}
+
+/*****************************************************************************************
+* Function: Signer Sign
+*
+* Description: Signs a message with the resident key
+* Parameters: signature - destination, SIGNER_SIGNATURE_SIZE bytes
+*             message - message to sign
+*             length - message length
+* Returns: None
+*****************************************************************************************/
+void signerSign(uint8_t* signature, const uint8_t* message, size_t length) {
+  if (!signerReady) {
+    memset(signature, 0, SIGNER_SIGNATURE_SIZE);
+    return;
+  }
+
+#if SIGNER_USE_SODIUM
+  crypto_sign_ed25519_detached(signature, NULL, message, length, signingKey);
+#else
+  Ed25519::sign(signature, signingKey, signingKey + SIGNER_SEED_SIZE, message, length);
+#endif
+}
+
+/*****************************************************************************************
+* Function: Signer Public Key
+*
+* Description: Returns the public key of the resident signing key
+* Parameters: None
+* Returns: const uint8_t* - SIGNER_PUBLIC_KEY_SIZE bytes
+*****************************************************************************************/
+const uint8_t* signerPublicKey() {
+  return signingKey + SIGNER_SEED_SIZE;
+}
+
+/*****************************************************************************************
+* Function: Signer Backend
+*
+* Description: Returns the name of the signing backend for the boot log
+* Parameters: None
+* Returns: const char* - backend name
+*****************************************************************************************/
+const char* signerBackend() {
+#if SIGNER_USE_SODIUM
+  return "libsodium (hardware SHA-512)";
+#else
+  return "rweather Crypto";
+#endif
+}
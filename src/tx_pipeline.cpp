@@ -0,0 +1,285 @@
+/*****************************************************************************************
+ * Transaction Pipeline
+ *
+ * Entries form a FIFO in send order, each holding a copy of its readings (for a resend)
+ * and the number of reading store slots it reserved. Confirmations may arrive out of
+ * order, but reserved records are released strictly from the oldest end, so an entry
+ * confirmed early waits for the ones before it. A transaction that executed with an error
+ * is not resent, repeating it would fail the same way; its readings are given up. The
+ * exception is the program's rate limit: that rejection only says the transaction came too
+ * early, so the entry keeps its readings and store slots and is resent later.
+ *
+ * While the WebSocket is connected every entry is also watched with signatureSubscribe and
+ * usually resolved by the push; the status poll then only runs every TX_STATUS_POLL_WS_MS
+ * as a fallback for notifications that never arrive (subscription lost on a reconnect).
+ *
+ * Called from the network task only, which owns the RPC connection.
+ *
+ *****************************************************************************************/
+
+#include "tx_pipeline.h"
+#include "reading_store.h"
+#include "logger.h"
+#include "instrumentation.h"
+#include "rpc_websocket.h"
+
+static_assert(TX_PIPELINE_WINDOW <= RPC_MAX_SIGNATURE_STATUSES, "One status request per poll");
+
+/*****************************************************************************************
+* Global Variables
+*****************************************************************************************/
+struct PipelineEntry {
+  HeartRateReading readings[TX_PIPELINE_MAX_READINGS];
+  size_t count;
+  uint32_t storeSlots;
+  char signature[SIGNATURE_BASE58_SIZE];
+  unsigned long sentTime;
+  bool resolved;                        // Confirmed or failed, waiting for older entries
+  bool rejected;                        // Rate limited, resent TX_REJECTED_RESEND_MS after sentTime
+};
+
+static PipelineEntry entries[TX_PIPELINE_WINDOW];
+static size_t head = 0;                 // Oldest entry
+static size_t entryCount = 0;
+static unsigned long lastPollTime = 0;
+static TxPipelineResubmit resubmitCallback = NULL;
+
+static void releaseResolved();
+static void resendEntry(PipelineEntry& entry);
+static void entryFailed(PipelineEntry& entry, uint32_t errorCode);
+static void onSignatureResult(const char* signature, bool success, uint32_t errorCode);
+
+/*****************************************************************************************
+* Function: Pipeline Begin
+*
+* Description: Empties the pipeline and sets the function used to resend dropped batches
+* Parameters: resubmit - signs and sends a batch again
+* Returns: None
+*****************************************************************************************/
+void pipelineBegin(TxPipelineResubmit resubmit) {
+  resubmitCallback = resubmit;
+  head = 0;
+  entryCount = 0;
+}
+
+/*****************************************************************************************
+* Function: Pipeline Add
+*
+* Description: Tracks a transaction accepted by the RPC until it is confirmed
+* Parameters: readings - readings in the transaction
+*             count - number of readings (at most TX_PIPELINE_MAX_READINGS)
+*             storeSlots - reading store slots reserved for it (storeReservePeeked())
+*             signature - base58 transaction signature
+* Returns: bool - True if added, false if the window is full or the batch too large
+*****************************************************************************************/
+bool pipelineAdd(const HeartRateReading* readings, size_t count, uint32_t storeSlots, const char* signature) {
+  if (entryCount >= TX_PIPELINE_WINDOW || count > TX_PIPELINE_MAX_READINGS) {
+    return false;
+  }
+
+  PipelineEntry& entry = entries[(head + entryCount) % TX_PIPELINE_WINDOW];
+  memcpy(entry.readings, readings, count * sizeof(HeartRateReading));
+  entry.count = count;
+  entry.storeSlots = storeSlots;
+  strcpy(entry.signature, signature);
+  entry.sentTime = millis();
+  entry.resolved = false;
+  entry.rejected = false;
+  if (entryCount == 0) {
+    lastPollTime = millis();            // First status check one poll period after sending
+  }
+  entryCount++;
+  wsSubscribeSignature(entry.signature, onSignatureResult);
+  return true;
+}
+
+/*****************************************************************************************
+* Function: Pipeline Add Slots
+*
+* Description: Attaches reserved store slots without readings (corrupt records) to the
+*              newest entry, so they are released together with it
+* Parameters: storeSlots - reserved slots
+* Returns: None
+*****************************************************************************************/
+void pipelineAddSlots(uint32_t storeSlots) {
+  if (entryCount == 0) {
+    storeConsumeReserved(storeSlots);
+    return;
+  }
+  entries[(head + entryCount - 1) % TX_PIPELINE_WINDOW].storeSlots += storeSlots;
+}
+
+/*****************************************************************************************
+* Function: Pipeline Service
+*
+* Description: Polls the status of all unresolved transactions in one request once
+*              TX_STATUS_POLL_MS has passed. Confirmed batches are released from the
+*              reading store, dropped ones (unknown after TX_DROP_TIMEOUT_MS) and rate
+*              limited ones (after TX_REJECTED_RESEND_MS) resent
+* Parameters: None
+* Returns: None
+*****************************************************************************************/
+void pipelineService() {
+  if (entryCount == 0 || pipelineMsUntilPoll() > 0) {
+    return;
+  }
+  lastPollTime = millis();
+
+  const char* signatures[TX_PIPELINE_WINDOW];
+  PipelineEntry* polled[TX_PIPELINE_WINDOW];
+  size_t pollCount = 0;
+  for (size_t i = 0; i < entryCount; i++) {
+    PipelineEntry& entry = entries[(head + i) % TX_PIPELINE_WINDOW];
+    if (entry.rejected && millis() - entry.sentTime >= TX_REJECTED_RESEND_MS) {
+      LOG_INFO("Resending %u readings rejected by the rate limit\n", (unsigned)entry.count);
+      resendEntry(entry);
+    }
+    if (!entry.resolved && !entry.rejected) {
+      signatures[pollCount] = entry.signature;
+      polled[pollCount++] = &entry;
+    }
+  }
+
+  RpcSignatureStatus statuses[TX_PIPELINE_WINDOW];
+  uint32_t errorCodes[TX_PIPELINE_WINDOW];
+  if (pollCount == 0 || !rpcGetSignatureStatuses(signatures, pollCount, statuses, errorCodes)) {
+    return;
+  }
+
+  unsigned long now = millis();
+  for (size_t i = 0; i < pollCount; i++) {
+    PipelineEntry& entry = *polled[i];
+    switch (statuses[i]) {
+      case RPC_SIGNATURE_CONFIRMED:
+        LOG_INFO("✅ Tx confirmed (%u readings): %s\n", (unsigned)entry.count, entry.signature);
+        entry.resolved = true;
+        wsCancelSignature(entry.signature);
+        break;
+      case RPC_SIGNATURE_FAILED:
+        wsCancelSignature(entry.signature);
+        entryFailed(entry, errorCodes[i]);
+        break;
+      case RPC_SIGNATURE_UNKNOWN:
+        if (now - entry.sentTime >= TX_DROP_TIMEOUT_MS) {
+          LOG_INFO("Tx dropped, resending %u readings\n", (unsigned)entry.count);
+          instrumentCount(COUNTER_TX_DROPPED);
+          resendEntry(entry);
+        }
+        break;
+      default:
+        break;                          // Processed: wait for confirmation
+    }
+  }
+  releaseResolved();
+}
+
+/*****************************************************************************************
+* Function: On Signature Result
+*
+* Description: Resolves the entry of a transaction whose confirmation was pushed
+* Parameters: signature - base58 transaction signature
+*             success - True if it executed without error
+* Returns: None
+*****************************************************************************************/
+static void onSignatureResult(const char* signature, bool success, uint32_t errorCode) {
+  for (size_t i = 0; i < entryCount; i++) {
+    PipelineEntry& entry = entries[(head + i) % TX_PIPELINE_WINDOW];
+    if (entry.resolved || entry.rejected || strcmp(entry.signature, signature) != 0) {
+      continue;
+    }
+    if (success) {
+      LOG_INFO("✅ Tx confirmed (%u readings, pushed): %s\n", (unsigned)entry.count, entry.signature);
+      entry.resolved = true;
+    } else {
+      entryFailed(entry, errorCode);
+    }
+    releaseResolved();
+    return;
+  }
+}
+
+/*****************************************************************************************
+* Function: Resend Entry
+*
+* Description: Signs and sends the readings of an entry again under a new signature
+* Parameters: entry - dropped or rate limited entry
+* Returns: None
+*****************************************************************************************/
+static void resendEntry(PipelineEntry& entry) {
+  char signature[SIGNATURE_BASE58_SIZE];
+  if (resubmitCallback != NULL && resubmitCallback(entry.readings, entry.count, signature)) {
+    wsCancelSignature(entry.signature);
+    strcpy(entry.signature, signature);
+    wsSubscribeSignature(entry.signature, onSignatureResult);
+    entry.rejected = false;
+  }
+  entry.sentTime = millis();            // A failed resend is retried after another timeout
+}
+
+/*****************************************************************************************
+* Function: Entry Failed
+*
+* Description: Handles a transaction that executed with an error: rate limited ones wait
+*              for a resend, any other error gives the readings up
+* Parameters: entry - failed entry
+*             errorCode - program error code (RPC_NO_ERROR_CODE if none)
+* Returns: None
+*****************************************************************************************/
+static void entryFailed(PipelineEntry& entry, uint32_t errorCode) {
+  if (errorCode == TX_RATE_LIMIT_ERROR) {
+    LOG_INFO("Tx rejected by the rate limit, %u readings kept: %s\n", (unsigned)entry.count, entry.signature);
+    instrumentCount(COUNTER_TX_RATE_LIMITED);
+    entry.rejected = true;
+    entry.sentTime = millis();
+    return;
+  }
+  LOG_ERROR("❌ Tx failed on chain, %u readings given up: %s\n", (unsigned)entry.count, entry.signature);
+  instrumentCount(COUNTER_TX_FAILURES);
+  entry.resolved = true;
+}
+
+/*****************************************************************************************
+* Function: Release Resolved
+*
+* Description: Removes resolved entries from the oldest end and releases their store slots
+* Parameters: None
+* Returns: None
+*****************************************************************************************/
+static void releaseResolved() {
+  while (entryCount > 0 && entries[head].resolved) {
+    storeConsumeReserved(entries[head].storeSlots);
+    head = (head + 1) % TX_PIPELINE_WINDOW;
+    entryCount--;
+  }
+}
+
+/*****************************************************************************************
+* Function: Pipeline Full / In Flight
+*
+* Description: Whether another transaction can be sent / number of transactions in flight
+* Parameters: None
+* Returns: bool / size_t - pipeline state
+*****************************************************************************************/
+bool pipelineFull() {
+  return entryCount >= TX_PIPELINE_WINDOW;
+}
+
+size_t pipelineInFlight() {
+  return entryCount;
+}
+
+/*****************************************************************************************
+* Function: Pipeline Ms Until Poll
+*
+* Description: Time until the next status poll is due
+* Parameters: None
+* Returns: unsigned long - ms until the poll, 0 if due (or nothing in flight)
+*****************************************************************************************/
+unsigned long pipelineMsUntilPoll() {
+  unsigned long interval = wsConnected() ? TX_STATUS_POLL_WS_MS : TX_STATUS_POLL_MS;
+  unsigned long elapsed = millis() - lastPollTime;
+  if (entryCount == 0 || elapsed >= interval) {
+    return 0;
+  }
+  return interval - elapsed;
+}
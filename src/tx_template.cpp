@@ -0,0 +1,393 @@
+/*****************************************************************************************
+ * Transaction Templates
+ *
+ * Account keys are ordered the way the Solana runtime expects them: writable signers,
+ * read-only signers, writable non-signers, read-only non-signers, with the program id last.
+ * Instructions are rewritten on every send (they are the tail of the message), which lets
+ * one template carry a variable number of instructions or a variable-length payload.
+ *
+ *****************************************************************************************/
+
+#include "tx_template.h"
+#include <string.h>
+#include "signer.h"
+#include "mbedtls/base64.h"
+
+#define TX_SIGNATURE_OFFSET 1
+#define TX_MESSAGE_OFFSET (TX_SIGNATURE_OFFSET + SOLANA_SIGNATURE_SIZE)
+#define BASE58_MAX_DIGITS 88            // Base58 digits of a 64-byte value
+
+static const char base58Alphabet[] = "123456789ABCDEFGHJKLMNPQRSTUVWXYZabcdefghijkmnopqrstuvwxyz";
+
+static size_t writeCompactU16(uint8_t* output, uint16_t value);
+static uint8_t accountCategory(bool isSigner, bool isWritable);
+static size_t writeInstructionPrefix(uint8_t* prefix, uint8_t programIndex, const TemplateAccount* accounts,
+                                     size_t accountCount, const TemplateAccount* keys,
+                                     const uint8_t* keyIndex, size_t keyCount);
+
+/*****************************************************************************************
+* Function: Transaction Template Build
+*
+* Description: Serializes the fixed part of a single-signer transaction
+* Parameters: tpl - template to build
+*             accounts - instruction accounts in instruction order, accounts[0] is the fee
+*                        payer and the only signer
+*             accountCount - number of instruction accounts
+*             programId - 32-byte program id
+*             discriminator - 8-byte Anchor instruction discriminator
+* Returns: bool - True if the template was built, false if the accounts are not supported
+*****************************************************************************************/
+bool txTemplateBuild(TxTemplate* tpl, const TemplateAccount* accounts, size_t accountCount,
+                     const uint8_t* programId, const uint8_t* discriminator) {
+  return txTemplateBuildMerged(tpl, accounts, accountCount, discriminator, NULL, 0, NULL, programId);
+}
+
+/*****************************************************************************************
+* Function: Transaction Template Build Merged
+*
+* Description: Serializes the fixed part of a single-signer transaction that carries, after
+*              the template's instructions, one argument-less instruction of a second kind
+*              of the same program. The account list is the union of both instructions'
+*              accounts (flags combined), each instruction referencing its own accounts
+* Parameters: tpl - template to build
+*             accounts - accounts of the main instruction, accounts[0] is the fee payer and
+*                        the only signer
+*             accountCount - number of main instruction accounts
+*             discriminator - 8-byte discriminator of the main instruction
+*             extraAccounts - accounts of the extra instruction (NULL for none)
+*             extraCount - number of extra instruction accounts
+*             extraDiscriminator - 8-byte discriminator of the extra instruction
+*             programId - 32-byte program id
+* Returns: bool - True if the template was built, false if the accounts are not supported
+*****************************************************************************************/
+bool txTemplateBuildMerged(TxTemplate* tpl, const TemplateAccount* accounts, size_t accountCount,
+                           const uint8_t* discriminator, const TemplateAccount* extraAccounts,
+                           size_t extraCount, const uint8_t* extraDiscriminator, const uint8_t* programId) {
+  if (accountCount == 0 || accountCount > TX_TEMPLATE_MAX_ACCOUNTS || extraCount > TX_TEMPLATE_MAX_ACCOUNTS ||
+      !accounts[0].isSigner || !accounts[0].isWritable) {
+    return false;
+  }
+
+  // Unique message accounts, in order of first use
+  TemplateAccount keys[TX_TEMPLATE_MAX_ACCOUNTS];
+  size_t keyCount = 0;
+  for (size_t i = 0; i < accountCount + extraCount; i++) {
+    const TemplateAccount& account = i < accountCount ? accounts[i] : extraAccounts[i - accountCount];
+    size_t k = 0;
+    while (k < keyCount && memcmp(keys[k].pubkey, account.pubkey, SOLANA_PUBKEY_SIZE) != 0) {
+      k++;
+    }
+    if (k == keyCount) {
+      if (keyCount == TX_TEMPLATE_MAX_ACCOUNTS) {
+        return false;
+      }
+      keys[keyCount++] = account;
+    } else {
+      keys[k].isSigner = keys[k].isSigner || account.isSigner;
+      keys[k].isWritable = keys[k].isWritable || account.isWritable;
+    }
+  }
+
+  uint8_t numSigners = 0;
+  uint8_t numReadonlySigned = 0;
+  uint8_t numReadonlyUnsigned = 1;      // Program id
+  for (size_t i = 0; i < keyCount; i++) {
+    if (keys[i].isSigner) {
+      numSigners++;
+      numReadonlySigned += keys[i].isWritable ? 0 : 1;
+    } else {
+      numReadonlyUnsigned += keys[i].isWritable ? 0 : 1;
+    }
+  }
+  if (numSigners != 1) {
+    return false;
+  }
+
+  uint8_t* out = tpl->buffer;
+  size_t offset = TX_MESSAGE_OFFSET;
+  out[0] = 1;                           // Signature count
+  memset(out + TX_SIGNATURE_OFFSET, 0, SOLANA_SIGNATURE_SIZE);
+
+  // Message header
+  out[offset++] = numSigners;
+  out[offset++] = numReadonlySigned;
+  out[offset++] = numReadonlyUnsigned;
+
+  // Account keys, one category at a time, program id last
+  uint8_t keyIndex[TX_TEMPLATE_MAX_ACCOUNTS];
+  uint8_t nextIndex = 0;
+  offset += writeCompactU16(out + offset, keyCount + 1);
+  for (uint8_t category = 0; category < 4; category++) {
+    for (size_t i = 0; i < keyCount; i++) {
+      if (accountCategory(keys[i].isSigner, keys[i].isWritable) != category) {
+        continue;
+      }
+      memcpy(out + offset, keys[i].pubkey, SOLANA_PUBKEY_SIZE);
+      offset += SOLANA_PUBKEY_SIZE;
+      keyIndex[i] = nextIndex++;
+    }
+  }
+  memcpy(out + offset, programId, SOLANA_PUBKEY_SIZE);
+  offset += SOLANA_PUBKEY_SIZE;
+
+  // Blockhash placeholder
+  tpl->blockhashOffset = offset;
+  memset(out + offset, 0, SOLANA_PUBKEY_SIZE);
+  offset += SOLANA_PUBKEY_SIZE;
+  tpl->instructionsOffset = offset;
+
+  // Instruction prefixes: program index, account count, account indices
+  tpl->ixPrefixLength = writeInstructionPrefix(tpl->ixPrefix, nextIndex, accounts, accountCount,
+                                               keys, keyIndex, keyCount);
+  memcpy(tpl->discriminator, discriminator, ANCHOR_DISCRIMINATOR_SIZE);
+  tpl->extraPrefixLength = 0;
+  if (extraCount > 0) {
+    tpl->extraPrefixLength = writeInstructionPrefix(tpl->extraPrefix, nextIndex, extraAccounts, extraCount,
+                                                    keys, keyIndex, keyCount);
+    memcpy(tpl->extraDiscriminator, extraDiscriminator, ANCHOR_DISCRIMINATOR_SIZE);
+  }
+
+  // Start with a single instruction without arguments
+  return txTemplateSetInstructions(tpl, NULL, 0, 1);
+}
+
+/*****************************************************************************************
+* Function: Transaction Template Set Blockhash
+*
+* Description: Patches the recent blockhash (invalidates the signature)
+* Parameters: tpl - template
+*             blockhash - 32-byte decoded blockhash
+* Returns: None
+*****************************************************************************************/
+void txTemplateSetBlockhash(TxTemplate* tpl, const uint8_t* blockhash) {
+  memcpy(tpl->buffer + tpl->blockhashOffset, blockhash, SOLANA_PUBKEY_SIZE);
+}
+
+/*****************************************************************************************
+* Function: Transaction Template Set Instructions
+*
+* Description: Rewrites the instruction list as count instructions of the template's kind,
+*              instruction i carrying the discriminator followed by payload slice i, plus
+*              the extra instruction of a merged template
+* Parameters: tpl - template
+*             payloads - count * payloadLength bytes of serialized arguments (may be NULL
+*                        when payloadLength is 0)
+*             payloadLength - argument bytes per instruction
+*             count - number of instructions
+* Returns: bool - True if the transaction fits SOLANA_TX_SIZE_LIMIT, false otherwise
+*****************************************************************************************/
+bool txTemplateSetInstructions(TxTemplate* tpl, const uint8_t* payloads, size_t payloadLength, size_t count) {
+  size_t dataLength = ANCHOR_DISCRIMINATOR_SIZE + payloadLength;
+  size_t ixLength = tpl->ixPrefixLength + (dataLength < 0x80 ? 1 : (dataLength < 0x4000 ? 2 : 3)) + dataLength;
+  size_t extraLength = tpl->extraPrefixLength > 0 ? tpl->extraPrefixLength + 1 + ANCHOR_DISCRIMINATOR_SIZE : 0;
+  size_t totalCount = count + (extraLength > 0 ? 1 : 0);
+  size_t countLength = totalCount < 0x80 ? 1 : 2;
+  if (tpl->instructionsOffset + countLength + count * ixLength + extraLength > SOLANA_TX_SIZE_LIMIT) {
+    return false;
+  }
+
+  uint8_t* out = tpl->buffer;
+  size_t offset = tpl->instructionsOffset;
+  offset += writeCompactU16(out + offset, totalCount);
+  for (size_t i = 0; i < count; i++) {
+    memcpy(out + offset, tpl->ixPrefix, tpl->ixPrefixLength);
+    offset += tpl->ixPrefixLength;
+    offset += writeCompactU16(out + offset, dataLength);
+    memcpy(out + offset, tpl->discriminator, ANCHOR_DISCRIMINATOR_SIZE);
+    offset += ANCHOR_DISCRIMINATOR_SIZE;
+    if (payloadLength > 0) {
+      memcpy(out + offset, payloads + i * payloadLength, payloadLength);
+      offset += payloadLength;
+    }
+  }
+  if (extraLength > 0) {
+    memcpy(out + offset, tpl->extraPrefix, tpl->extraPrefixLength);
+    offset += tpl->extraPrefixLength;
+    offset += writeCompactU16(out + offset, ANCHOR_DISCRIMINATOR_SIZE);
+    memcpy(out + offset, tpl->extraDiscriminator, ANCHOR_DISCRIMINATOR_SIZE);
+    offset += ANCHOR_DISCRIMINATOR_SIZE;
+  }
+  tpl->length = offset;
+  return true;
+}
+
+/*****************************************************************************************
+* Function: Transaction Template Sign
+*
+* Description: Signs the serialized message with the resident fee payer key and stores the
+*              signature in place
+* Parameters: tpl - template
+* Returns: None
+*****************************************************************************************/
+void txTemplateSign(TxTemplate* tpl) {
+  signerSign(tpl->buffer + TX_SIGNATURE_OFFSET, tpl->buffer + TX_MESSAGE_OFFSET,
+             tpl->length - TX_MESSAGE_OFFSET);
+}
+
+/*****************************************************************************************
+* Function: Transaction Template Base64
+*
+* Description: Base64-encodes the signed transaction into a caller-provided buffer
+* Parameters: tpl - template
+*             output - destination, TX_BASE64_SIZE bytes is always enough
+*             outputSize - size of the destination
+* Returns: size_t - encoded length (without terminator), 0 if the buffer is too small
+*****************************************************************************************/
+size_t txTemplateBase64(const TxTemplate* tpl, char* output, size_t outputSize) {
+  size_t encodedLength = 0;
+  if (mbedtls_base64_encode((unsigned char*)output, outputSize, &encodedLength, tpl->buffer, tpl->length) != 0) {
+    return 0;
+  }
+  return encodedLength;
+}
+
+/*****************************************************************************************
+* Function: Base58 Decode Fixed
+*
+* Description: Decodes a base58 string into a fixed-size big-endian buffer without heap use
+* Parameters: input - null-terminated base58 string
+*             output - destination buffer
+*             outputLength - exact decoded length expected (e.g. 32 for keys and blockhashes)
+* Returns: bool - True if the input decodes to exactly outputLength bytes, false otherwise
+*****************************************************************************************/
+bool base58DecodeFixed(const char* input, uint8_t* output, size_t outputLength) {
+  memset(output, 0, outputLength);
+  size_t leadingOnes = 0;
+  while (input[leadingOnes] == '1') {
+    leadingOnes++;
+  }
+
+  for (const char* p = input; *p; p++) {
+    const char* digit = strchr(base58Alphabet, *p);
+    if (digit == NULL) {
+      return false;
+    }
+    uint32_t carry = digit - base58Alphabet;
+    for (size_t i = outputLength; i-- > 0;) {
+      carry += (uint32_t)output[i] * 58;
+      output[i] = carry & 0xff;
+      carry >>= 8;
+    }
+    if (carry != 0) {
+      return false;                     // Value does not fit
+    }
+  }
+
+  // Each leading '1' encodes one leading zero byte, anything else means a shorter value
+  size_t leadingZeros = 0;
+  while (leadingZeros < outputLength && output[leadingZeros] == 0) {
+    leadingZeros++;
+  }
+  return leadingZeros == leadingOnes;
+}
+
+/*****************************************************************************************
+* Function: Base58 Encode
+*
+* Description: Encodes a big-endian buffer (a key or signature) as base58 without heap use
+* Parameters: input - bytes to encode, at most SOLANA_SIGNATURE_SIZE
+*             inputLength - number of bytes
+*             output - destination, null-terminated
+*             outputSize - size of the destination
+* Returns: size_t - encoded length (without terminator), 0 if the buffer is too small
+*****************************************************************************************/
+size_t base58Encode(const uint8_t* input, size_t inputLength, char* output, size_t outputSize) {
+  uint8_t digits[BASE58_MAX_DIGITS];    // Little-endian base58 digits
+  size_t digitCount = 0;
+
+  if (inputLength > SOLANA_SIGNATURE_SIZE) {
+    return 0;
+  }
+  size_t leadingZeros = 0;
+  while (leadingZeros < inputLength && input[leadingZeros] == 0) {
+    leadingZeros++;
+  }
+  for (size_t i = leadingZeros; i < inputLength; i++) {
+    uint32_t carry = input[i];
+    for (size_t j = 0; j < digitCount; j++) {
+      carry += (uint32_t)digits[j] << 8;
+      digits[j] = carry % 58;
+      carry /= 58;
+    }
+    while (carry > 0) {
+      digits[digitCount++] = carry % 58;
+      carry /= 58;
+    }
+  }
+
+  size_t length = leadingZeros + digitCount;
+  if (length + 1 > outputSize) {
+    return 0;
+  }
+  memset(output, '1', leadingZeros);
+  for (size_t i = 0; i < digitCount; i++) {
+    output[leadingZeros + i] = base58Alphabet[digits[digitCount - 1 - i]];
+  }
+  output[length] = '\0';
+  return length;
+}
+
+/*****************************************************************************************
+* Function: Write Compact U16
+*
+* Description: Solana short_vec length encoding (7 bits per byte, canonical)
+* Parameters: output - destination (up to 3 bytes)
+*             value - value to encode
+* Returns: size_t - bytes written
+*****************************************************************************************/
+static size_t writeCompactU16(uint8_t* output, uint16_t value) {
+  size_t length = 0;
+  do {
+    uint8_t byte = value & 0x7f;
+    value >>= 7;
+    if (value) {
+      byte |= 0x80;
+    }
+    output[length++] = byte;
+  } while (value);
+  return length;
+}
+
+/*****************************************************************************************
+* Function: Account Category
+*
+* Description: Sort key of an account in the message account list
+* Parameters: isSigner, isWritable - account flags
+* Returns: uint8_t - 0 writable signer, 1 read-only signer, 2 writable, 3 read-only
+*****************************************************************************************/
+static uint8_t accountCategory(bool isSigner, bool isWritable) {
+  if (isSigner) {
+    return isWritable ? 0 : 1;
+  }
+  return isWritable ? 2 : 3;
+}
+
+/*****************************************************************************************
+* Function: Write Instruction Prefix
+*
+* Description: Writes program index, account count and message indices of an instruction
+* Parameters: prefix - destination (up to TX_TEMPLATE_MAX_ACCOUNTS + 2 bytes)
+*             programIndex - message index of the program id
+*             accounts - instruction accounts
+*             accountCount - number of instruction accounts
+*             keys - message accounts
+*             keyIndex - message index of each of keys
+*             keyCount - number of message accounts
+* Returns: size_t - prefix length
+*****************************************************************************************/
+static size_t writeInstructionPrefix(uint8_t* prefix, uint8_t programIndex, const TemplateAccount* accounts,
+                                     size_t accountCount, const TemplateAccount* keys,
+                                     const uint8_t* keyIndex, size_t keyCount) {
+  size_t length = 0;
+  prefix[length++] = programIndex;
+  prefix[length++] = accountCount;
+  for (size_t i = 0; i < accountCount; i++) {
+    for (size_t k = 0; k < keyCount; k++) {
+      if (memcmp(keys[k].pubkey, accounts[i].pubkey, SOLANA_PUBKEY_SIZE) == 0) {
+        prefix[length++] = keyIndex[k];
+        break;
+      }
+    }
+  }
+  return length;
+}
@@ -0,0 +1,131 @@
+/*****************************************************************************************
+ * Upload Schedule
+ *
+ * Slots are counted on millis(), so devices powered up together share the slot grid and
+ * the key-derived phase spreads them over it; devices booted at random times are spread
+ * anyway. The grid shifts once when millis() wraps (every 49.7 days), the rate limit
+ * still holds then as it is checked against the last accepted transaction.
+ *
+ * Called from the network task only, which owns the uploads.
+ *
+ *****************************************************************************************/
+
+#include "upload_schedule.h"
+#include "logger.h"
+
+/*****************************************************************************************
+* Global Variables
+*****************************************************************************************/
+static unsigned long phaseMs = 0;
+static unsigned long nextUploadTime = 0;
+static unsigned long lastSuccessTime = 0;
+static bool succeeded = false;          // lastSuccessTime is set
+static uint32_t failures = 0;           // Consecutive failed uploads
+
+static unsigned long slotStartFrom(unsigned long time);
+static unsigned long randomBelow(unsigned long range);
+
+/*****************************************************************************************
+* Function: Upload Schedule Begin
+*
+* Description: Derives the device's phase within the slot from its key and schedules the
+*              first upload at the next slot
+* Parameters: deviceKey - 32-byte device public key
+* Returns: None
+*****************************************************************************************/
+void uploadScheduleBegin(const uint8_t* deviceKey) {
+  // Keys are uniformly random, so their first bytes spread the phases evenly
+  uint32_t keyBits = (uint32_t)deviceKey[0] | ((uint32_t)deviceKey[1] << 8) |
+                     ((uint32_t)deviceKey[2] << 16) | ((uint32_t)deviceKey[3] << 24);
+  phaseMs = keyBits % UPLOAD_SLOT_MS;
+  succeeded = false;
+  failures = 0;
+  nextUploadTime = slotStartFrom(millis()) + randomBelow(UPLOAD_JITTER_MS);
+  LOG_INFO("Upload slot: %lu ms at phase %lu ms\n", (unsigned long)UPLOAD_SLOT_MS, phaseMs);
+}
+
+/*****************************************************************************************
+* Function: Upload Schedule Ms Until Due
+*
+* Description: Time until the next upload may be sent
+* Parameters: None
+* Returns: unsigned long - ms until the upload, 0 if it may be sent now
+*****************************************************************************************/
+unsigned long uploadScheduleMsUntilDue() {
+  long remaining = (long)(nextUploadTime - millis());
+  return remaining > 0 ? (unsigned long)remaining : 0;
+}
+
+/*****************************************************************************************
+* Function: Upload Schedule Sent
+*
+* Description: Schedules the next upload after one was sent: at the next slot of the
+*              device after an accepted transaction (as soon as the rate limit allows
+*              while a backlog is waiting), after a jittered exponential backoff after a
+*              failure. Neither comes sooner than the rate limit allows
+* Parameters: success - True if the transaction was accepted
+*             backlog - True if more readings are waiting than this upload took
+* Returns: None
+*****************************************************************************************/
+void uploadScheduleSent(bool success, bool backlog) {
+  unsigned long now = millis();
+  if (success) {
+    failures = 0;
+    lastSuccessTime = now;
+    succeeded = true;
+    // Half a slot ahead skips the slot this upload went out in. A backlog goes out at the
+    // rate limit floor set below
+    nextUploadTime = backlog ? now : slotStartFrom(now + UPLOAD_SLOT_MS / 2) + randomBelow(UPLOAD_JITTER_MS);
+  } else {
+    // Equal jitter: at least half of the backoff, so retries of a fleet still spread out
+    failures++;
+    unsigned long backoffMs = UPLOAD_BACKOFF_MIN_MS;
+    for (uint32_t i = 1; i < failures && backoffMs < UPLOAD_BACKOFF_MAX_MS; i++) {
+      backoffMs *= 2;
+    }
+    backoffMs = min(backoffMs, (unsigned long)UPLOAD_BACKOFF_MAX_MS);
+    nextUploadTime = now + backoffMs / 2 + randomBelow(backoffMs / 2);
+    LOG_INFO("Upload retry in %lu ms (failure %u)\n", nextUploadTime - now, (unsigned)failures);
+  }
+
+  if (succeeded) {
+    unsigned long earliest = lastSuccessTime + UPLOAD_RATE_LIMIT_MS + UPLOAD_RATE_MARGIN_MS;
+    if ((long)(earliest - nextUploadTime) > 0) {
+      nextUploadTime = earliest;
+    }
+  }
+}
+
+/*****************************************************************************************
+* Function: Upload Schedule Failures
+*
+* Description: Number of consecutive failed uploads
+* Parameters: None
+* Returns: uint32_t - failures since the last accepted transaction
+*****************************************************************************************/
+uint32_t uploadScheduleFailures() {
+  return failures;
+}
+
+/*****************************************************************************************
+* Function: Slot Start From
+*
+* Description: First start of one of the device's slots at or after a time
+* Parameters: time - millis() timestamp
+* Returns: unsigned long - slot start
+*****************************************************************************************/
+static unsigned long slotStartFrom(unsigned long time) {
+  unsigned long position = (time % UPLOAD_SLOT_MS + UPLOAD_SLOT_MS - phaseMs) % UPLOAD_SLOT_MS;
+  return position == 0 ? time : time + (UPLOAD_SLOT_MS - position);
+}
+
+/*****************************************************************************************
+* Function: Random Below
+*
+* Description: Uniform random delay from the hardware RNG
+* Parameters: range - exclusive upper bound
+* Returns: unsigned long - 0 to range - 1, 0 if range is 0
+*****************************************************************************************/
+static unsigned long randomBelow(unsigned long range) {
+  return range > 0 ? esp_random() % range : 0;
+}
@@ -0,0 +1,282 @@
+/*****************************************************************************************
+ * WiFi Manager
+ *
+ * Arduino's own auto-reconnect is disabled; disconnect events schedule a reconnect through
+ * a one-shot timer with exponential backoff instead, so a missing AP does not cause a
+ * reconnect storm. Events arrive on the Arduino event task and the timer fires on the
+ * timer task; neither blocks.
+ *
+ * The RTC copy survives deep sleep and software resets, the NVS copy power cycles. NVS is
+ * only written when the AP or lease changes.
+ *
+ *****************************************************************************************/
+
+#include "wifi_manager.h"
+#include <WiFi.h>
+#include <Preferences.h>
+#include "freertos/event_groups.h"
+#include "freertos/timers.h"
+#include "logger.h"
+
+/*****************************************************************************************
+* Global Variables
+*****************************************************************************************/
+#define WIFI_CACHE_MAGIC 0x57494649     // "WIFI"
+#define WIFI_LINK_BIT (1 << 0)
+
+struct WifiCache {
+  uint32_t magic;
+  uint8_t bssid[6];
+  uint8_t channel;
+  uint8_t reserved;
+  uint32_t ip;
+  uint32_t gateway;
+  uint32_t subnet;
+  uint32_t dns;
+};
+
+RTC_DATA_ATTR static WifiCache rtcCache;
+static WifiCache cache;
+static bool cacheValid = false;
+
+static const char* wifiSsid = NULL;
+static const char* wifiPassword = NULL;
+static EventGroupHandle_t linkEvents = NULL;
+static TimerHandle_t reconnectTimer = NULL;
+static volatile bool wanted = false;     // False while suspended by the power manager
+static uint8_t fastAttempts = 0;
+static unsigned long reconnectDelayMs = WIFI_RECONNECT_MIN_MS;
+static uint32_t disconnectCount = 0;
+
+static void connect();
+static void onWifiEvent(WiFiEvent_t event, WiFiEventInfo_t info);
+static void onReconnectTimer(TimerHandle_t timer);
+static void loadCache();
+static void storeCache();
+
+/*****************************************************************************************
+* Function: WiFi Begin
+*
+* Description: Registers the event handler and starts connecting (fast path if a cache
+*              entry exists). Returns immediately; use wifiWaitForLink() to wait
+* Parameters: ssid - network name
+*             password - network password
+* Returns: bool - True if the manager was started, false otherwise
+*****************************************************************************************/
+bool wifiBegin(const char* ssid, const char* password) {
+  wifiSsid = ssid;
+  wifiPassword = password;
+  linkEvents = xEventGroupCreate();
+  reconnectTimer = xTimerCreate("wifi", pdMS_TO_TICKS(WIFI_RECONNECT_MIN_MS), pdFALSE, NULL, onReconnectTimer);
+  if (linkEvents == NULL || reconnectTimer == NULL) {
+    LOG_ERROR("❌ Failed to create WiFi manager\n");
+    return false;
+  }
+
+  loadCache();
+  WiFi.persistent(false);               // Credentials come from credentials.h, not flash
+  WiFi.setAutoReconnect(false);
+  WiFi.onEvent(onWifiEvent, ARDUINO_EVENT_WIFI_STA_GOT_IP);
+  WiFi.onEvent(onWifiEvent, ARDUINO_EVENT_WIFI_STA_DISCONNECTED);
+  WiFi.onEvent(onWifiEvent, ARDUINO_EVENT_WIFI_STA_LOST_IP);
+  WiFi.mode(WIFI_STA);
+  wanted = true;
+  connect();
+  return true;
+}
+
+/*****************************************************************************************
+* Function: WiFi Wait For Link
+*
+* Description: Blocks until the station has an IP address or the timeout expires
+* Parameters: timeoutMs - maximum wait
+* Returns: bool - True if the link is up, false otherwise
+*****************************************************************************************/
+bool wifiWaitForLink(unsigned long timeoutMs) {
+  if (linkEvents == NULL) {
+    return false;
+  }
+  EventBits_t bits = xEventGroupWaitBits(linkEvents, WIFI_LINK_BIT, pdFALSE, pdTRUE, pdMS_TO_TICKS(timeoutMs));
+  return (bits & WIFI_LINK_BIT) != 0;
+}
+
+/*****************************************************************************************
+* Function: WiFi Link Up
+*
+* Description: Current link state, without waiting
+* Parameters: None
+* Returns: bool - True if the station has an IP address, false otherwise
+*****************************************************************************************/
+bool wifiLinkUp() {
+  return linkEvents != NULL && (xEventGroupGetBits(linkEvents) & WIFI_LINK_BIT) != 0;
+}
+
+/*****************************************************************************************
+* Function: WiFi Suspend / Resume
+*
+* Description: Switches the radio off without triggering reconnects / back on with a fast
+*              reconnect. Used by the power manager between uploads
+* Parameters: None
+* Returns: None
+*****************************************************************************************/
+void wifiSuspend() {
+  wanted = false;
+  xTimerStop(reconnectTimer, 0);
+  WiFi.mode(WIFI_OFF);
+  xEventGroupClearBits(linkEvents, WIFI_LINK_BIT);
+}
+
+void wifiResume() {
+  if (wanted) {
+    return;
+  }
+  wanted = true;
+  fastAttempts = 0;
+  reconnectDelayMs = WIFI_RECONNECT_MIN_MS;
+  WiFi.mode(WIFI_STA);
+  connect();
+}
+
+/*****************************************************************************************
+* Function: WiFi Disconnects
+*
+* Description: Unexpected disconnects since boot
+* Parameters: None
+* Returns: uint32_t - disconnect count
+*****************************************************************************************/
+uint32_t wifiDisconnects() {
+  return disconnectCount;
+}
+
+/*****************************************************************************************
+* Function: Connect
+*
+* Description: Starts an association: to the cached BSSID/channel (optionally with the
+*              cached lease as static IP) while fast attempts remain, otherwise a full scan
+*              with DHCP
+* Parameters: None
+* Returns: None
+*****************************************************************************************/
+static void connect() {
+  if (cacheValid && fastAttempts < WIFI_FAST_CONNECT_ATTEMPTS) {
+    fastAttempts++;
+#if WIFI_CACHE_STATIC_IP
+    WiFi.config(IPAddress(cache.ip), IPAddress(cache.gateway), IPAddress(cache.subnet), IPAddress(cache.dns));
+#endif
+    WiFi.begin(wifiSsid, wifiPassword, cache.channel, cache.bssid);
+  } else {
+    WiFi.config(INADDR_NONE, INADDR_NONE, INADDR_NONE);
+    WiFi.begin(wifiSsid, wifiPassword);
+  }
+}
+
+/*****************************************************************************************
+* Function: On WiFi Event
+*
+* Description: Tracks the link: caches the AP and lease on GOT_IP, schedules a reconnect
+*              with backoff on disconnect
+* Parameters: event - Arduino WiFi event
+*             info - event details
+* Returns: None
+*****************************************************************************************/
+static void onWifiEvent(WiFiEvent_t event, WiFiEventInfo_t info) {
+  switch (event) {
+    case ARDUINO_EVENT_WIFI_STA_GOT_IP:
+      fastAttempts = 0;
+      reconnectDelayMs = WIFI_RECONNECT_MIN_MS;
+      storeCache();
+      xEventGroupSetBits(linkEvents, WIFI_LINK_BIT);
+      break;
+
+    case ARDUINO_EVENT_WIFI_STA_DISCONNECTED:
+    case ARDUINO_EVENT_WIFI_STA_LOST_IP: {
+      bool wasUp = (xEventGroupClearBits(linkEvents, WIFI_LINK_BIT) & WIFI_LINK_BIT) != 0;
+      if (!wanted) {
+        break;
+      }
+      if (wasUp) {
+        disconnectCount++;
+        LOG_INFO("WiFi link lost (reason %u), reconnecting\n", info.wifi_sta_disconnected.reason);
+      }
+      // Give up on the cached AP once its attempts are used up; connect() then scans
+      if (fastAttempts >= WIFI_FAST_CONNECT_ATTEMPTS) {
+        cacheValid = false;
+      }
+      xTimerChangePeriod(reconnectTimer, pdMS_TO_TICKS(reconnectDelayMs), 0);
+      xTimerStart(reconnectTimer, 0);
+      reconnectDelayMs = min(reconnectDelayMs * 2, (unsigned long)WIFI_RECONNECT_MAX_MS);
+      break;
+    }
+
+    default:
+      break;
+  }
+}
+
+/*****************************************************************************************
+* Function: On Reconnect Timer
+*
+* Description: Starts the scheduled reconnect attempt
+* Parameters: timer - reconnect timer
+* Returns: None
+*****************************************************************************************/
+static void onReconnectTimer(TimerHandle_t timer) {
+  if (wanted && !wifiLinkUp()) {
+    connect();
+  }
+}
+
+/*****************************************************************************************
+* Function: Load Cache
+*
+* Description: Takes the connection cache from RTC memory, or from NVS after a power cycle
+* Parameters: None
+* Returns: None
+*****************************************************************************************/
+static void loadCache() {
+  if (rtcCache.magic == WIFI_CACHE_MAGIC) {
+    cache = rtcCache;
+    cacheValid = true;
+    return;
+  }
+  Preferences preferences;
+  if (preferences.begin("wifi", true)) {
+    cacheValid = preferences.getBytes("cache", &cache, sizeof(cache)) == sizeof(cache) &&
+                 cache.magic == WIFI_CACHE_MAGIC;
+    preferences.end();
+  }
+  if (cacheValid) {
+    rtcCache = cache;
+  }
+}
+
+/*****************************************************************************************
+* Function: Store Cache
+*
+* Description: Records the current AP and lease in RTC memory, and in NVS if they changed
+* Parameters: None
+* Returns: None
+*****************************************************************************************/
+static void storeCache() {
+  WifiCache current = {};
+  current.magic = WIFI_CACHE_MAGIC;
+  memcpy(current.bssid, WiFi.BSSID(), sizeof(current.bssid));
+  current.channel = WiFi.channel();
+  current.ip = WiFi.localIP();
+  current.gateway = WiFi.gatewayIP();
+  current.subnet = WiFi.subnetMask();
+  current.dns = WiFi.dnsIP();
+
+  bool changed = !cacheValid || memcmp(&current, &cache, sizeof(current)) != 0;
+  cache = current;
+  rtcCache = current;
+  cacheValid = true;
+  if (!changed) {
+    return;
+  }
+  Preferences preferences;
+  if (preferences.begin("wifi", false)) {
+    preferences.putBytes("cache", &cache, sizeof(cache));
+    preferences.end();
+  }
+}
@@ -0,0 +1,192 @@
+/*****************************************************************************************
+ * Benchmarks
+ *
+ * Host timings of the per-sample signal path and the per-upload encoders, printed so a
+ * change that slows them down shows before it is flashed: ns per sample for the filter
+ * and the whole pipeline, ns per beat for the window, and us per transaction payload for
+ * the log_heartbeat encoders and the RPC response lookup. Host numbers do not translate
+ * to the ESP32-S3, compare them against a run of the previous revision on the same host.
+ * Each benchmark also checks its output, so a fast but wrong result fails.
+ *
+ *****************************************************************************************/
+
+#include <unity.h>
+#include <chrono>
+#include <stdio.h>
+#include <string.h>
+#include "trace_replay.h"
+#include "signal_filter.h"
+#include "heart_rate_window.h"
+#include "heartbeat_codec.h"
+#include "heartbeat_payload.h"
+#include "json_scan.h"
+
+#define BENCH_MINUTES 10
+#define BENCH_SAMPLES (TRACE_READING_SAMPLES * BENCH_MINUTES)
+#define BENCH_REPEATS 5
+#define BENCH_READINGS 128
+#define BENCH_TX_READINGS_BYTES 983     // log_heartbeat_compact room in a 1232-byte transaction
+
+static uint16_t samples[BENCH_SAMPLES];
+static int32_t filtered[BENCH_SAMPLES];
+static HeartRateReading readings[BENCH_READINGS];
+static volatile uint32_t sink;          // Keeps results alive under optimization
+
+void setUp() {}
+void tearDown() {}
+
+static double elapsedNs(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+}
+
+static void report(const char* name, double value, const char* unit) {
+  char message[128];
+  snprintf(message, sizeof(message), "%-28s %10.1f %s", name, value, unit);
+  TEST_MESSAGE(message);
+}
+
+static void test_filter_ns_per_sample() {
+  TracePulse pulse = { 72, 40, 0.3f, 3, 30, 100, 1 };
+  traceSynthesize(pulse, samples, BENCH_SAMPLES);
+  double best = 0;
+  for (int r = 0; r < BENCH_REPEATS; r++) {
+    filterReset();
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < BENCH_SAMPLES; i += TRACE_BLOCK_SAMPLES) {
+      filterProcessBlock(0, samples + i, TRACE_BLOCK_SAMPLES, filtered + i);
+    }
+    double ns = elapsedNs(start) / BENCH_SAMPLES;
+    best = (r == 0 || ns < best) ? ns : best;
+  }
+  sink = filtered[BENCH_SAMPLES - 1];
+  report("filter", best, "ns/sample");
+}
+
+static void test_pipeline_ns_per_sample() {
+  TracePulse pulse = { 72, 40, 0.3f, 3, 30, 100, 2 };
+  uint32_t trueBeats = traceSynthesize(pulse, samples, BENCH_SAMPLES);
+  HeartRateReading minutes[BENCH_MINUTES];
+  TraceResult result;
+  double best = 0;
+  for (int r = 0; r < BENCH_REPEATS; r++) {
+    auto start = std::chrono::steady_clock::now();
+    traceReplay(samples, BENCH_SAMPLES, &result, minutes, BENCH_MINUTES);
+    double ns = elapsedNs(start) / BENCH_SAMPLES;
+    best = (r == 0 || ns < best) ? ns : best;
+  }
+  report("filter + detect + quality", best, "ns/sample");
+  report("beats detected", 100.0 * result.beats / trueBeats, "%");
+  TEST_ASSERT_FLOAT_WITHIN(1.5f, 72, minutes[BENCH_MINUTES - 1].heartRate);
+  TEST_ASSERT_GREATER_OR_EQUAL_UINT(trueBeats * 98 / 100, result.beats);
+}
+
+static void test_window_ns_per_beat() {
+  const size_t beats = 100000;
+  windowReset();
+  auto start = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < beats; i++) {
+    windowAddBeat(800 + (i % 7) * 10);
+  }
+  double ns = elapsedNs(start) / beats;
+  HeartRateSummary summary;
+  windowSummarize(100, &summary);
+  report("window add beat", ns, "ns/beat");
+  TEST_ASSERT_EQUAL_UINT16(UINT16_MAX, summary.beatCount);
+  TEST_ASSERT_EQUAL_UINT8(70, summary.minBpm);
+  TEST_ASSERT_EQUAL_UINT8(75, summary.maxBpm);
+}
+
+static void fillReadings(unsigned long nowMs) {
+  for (size_t i = 0; i < BENCH_READINGS; i++) {
+    readings[i].heartRate = 60 + (i * 7) % 90 + 0.4f;
+    readings[i].timestampMs = nowMs - (BENCH_READINGS - i) * 60000UL;
+    readings[i].summary = { (uint16_t)(70 + i % 20), (uint16_t)(300 + i), 40, (uint16_t)(i % 60),
+                            (uint8_t)(55 + (i * 7) % 90), (uint8_t)(70 + (i * 7) % 90), (uint8_t)(50 + i % 50) };
+  }
+}
+
+static void test_payload_us_per_transaction() {
+  const unsigned long nowMs = 36000000;
+  const int iterations = 10000;
+  fillReadings(nowMs);
+
+  static uint8_t single[BENCH_READINGS * HEARTBEAT_SINGLE_SIZE];
+  size_t length = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < iterations; i++) {
+    length = heartbeatPayloadSingle(readings, BENCH_READINGS, single);
+  }
+  report("single encode", elapsedNs(start) / iterations / 1000, "us/tx");
+  TEST_ASSERT_EQUAL_size_t(HEARTBEAT_SINGLE_SIZE, length);  // Size of each instruction's payload
+
+  static uint8_t payload[HEARTBEAT_COMPACT_PREFIX_SIZE + BENCH_TX_READINGS_BYTES];
+  uint8_t flags = HEARTBEAT_CODEC_FLAG_QUALITY | HEARTBEAT_CODEC_FLAG_SUMMARY;
+  size_t count = heartbeatCodecFit(readings, BENCH_READINGS, flags, BENCH_TX_READINGS_BYTES);
+
+  start = std::chrono::steady_clock::now();
+  for (int i = 0; i < iterations; i++) {
+    length = heartbeatPayloadCompact(readings, count, nowMs, flags, payload, sizeof(payload));
+  }
+  report("compact encode", elapsedNs(start) / iterations / 1000, "us/tx");
+  TEST_ASSERT_GREATER_THAN_size_t(0, length);
+
+  HeartRateReading decoded[BENCH_READINGS];
+  size_t decodedCount = 0;
+  uint8_t decodedFlags = 0;
+  bool ok = false;
+  start = std::chrono::steady_clock::now();
+  for (int i = 0; i < iterations; i++) {
+    ok = heartbeatCodecDecode(payload + HEARTBEAT_COMPACT_PREFIX_SIZE, length - HEARTBEAT_COMPACT_PREFIX_SIZE,
+                              nowMs, decoded, BENCH_READINGS, &decodedCount, &decodedFlags);
+  }
+  report("compact decode", elapsedNs(start) / iterations / 1000, "us/tx");
+  TEST_ASSERT_TRUE(ok);
+  TEST_ASSERT_EQUAL_size_t(count, decodedCount);
+
+  static uint8_t packed[HEARTBEAT_PACKED_SIZE(BENCH_READINGS)];
+  start = std::chrono::steady_clock::now();
+  for (int i = 0; i < iterations; i++) {
+    length = heartbeatPayloadPacked(readings, BENCH_READINGS, nowMs, packed);
+  }
+  report("packed encode", elapsedNs(start) / iterations / 1000, "us/tx");
+  TEST_ASSERT_EQUAL_size_t(HEARTBEAT_PACKED_SIZE(BENCH_READINGS), length);
+
+  char message[96];
+  snprintf(message, sizeof(message), "compact tx holds %u readings in %u bytes", (unsigned)count, (unsigned)BENCH_TX_READINGS_BYTES);
+  TEST_MESSAGE(message);
+}
+
+static void test_json_lookup_us() {
+  // getSignatureStatuses for a full pipeline window, the largest response parsed per poll
+  static char response[2048];
+  int length = snprintf(response, sizeof(response), "{\"jsonrpc\":\"2.0\",\"result\":{\"context\":{\"apiVersion\":\"1.18.22\",\"slot\":291234567},\"value\":[");
+  for (int i = 0; i < 4; i++) {
+    length += snprintf(response + length, sizeof(response) - length,
+                       "%s{\"confirmationStatus\":\"confirmed\",\"confirmations\":%d,\"err\":%s,\"slot\":29123450%d,"
+                       "\"status\":{\"Ok\":null}}", i > 0 ? "," : "", i,
+                       i == 3 ? "{\"InstructionError\":[0,{\"Custom\":6000}]}" : "null", i);
+  }
+  snprintf(response + length, sizeof(response) - length, "]},\"id\":1}");
+
+  const int iterations = 100000;
+  uint64_t code = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < iterations; i++) {
+    JsonValue custom;
+    if (jsonFind(response, "result.value.3.err.InstructionError.1.Custom", &custom)) {
+      jsonGetUint64(custom, &code);
+    }
+  }
+  report("json lookup (last status)", elapsedNs(start) / iterations / 1000, "us");
+  TEST_ASSERT_EQUAL_UINT32(6000, code);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_filter_ns_per_sample);
+  RUN_TEST(test_pipeline_ns_per_sample);
+  RUN_TEST(test_window_ns_per_beat);
+  RUN_TEST(test_payload_us_per_transaction);
+  RUN_TEST(test_json_lookup_us);
+  return UNITY_END();
+}
@@ -0,0 +1,175 @@
+/*****************************************************************************************
+ * Heartbeat Codec Tests
+ *
+ * Round trip of the log_heartbeat_compact encoding for every flag combination, batch
+ * sizing at the transaction limit, and the decoder's rejection of malformed payloads.
+ *
+ *****************************************************************************************/
+
+#include <unity.h>
+#include <string.h>
+#include "heartbeat_codec.h"
+
+#define TEST_READINGS 600
+#define TEST_TX_READINGS_BYTES 983      // log_heartbeat_compact room in a 1232-byte transaction
+#define TEST_FLAG_COMBINATIONS 8
+#define TEST_NOW_MS 36000000UL
+
+static HeartRateReading readings[TEST_READINGS];
+static HeartRateReading decoded[TEST_READINGS];
+static uint8_t encoded[8192];
+
+void setUp() {}
+void tearDown() {}
+
+// Readings a minute apart with millisecond jitter, the oldest few from an earlier boot
+static void fillReadings(unsigned long nowMs) {
+  for (size_t i = 0; i < TEST_READINGS; i++) {
+    HeartRateReading& reading = readings[i];
+    reading.heartRate = 60 + (i * 7) % 90 + 0.37f;
+    reading.timestampMs = i < 5 ? READING_TIMESTAMP_UNKNOWN
+                                : (uint32_t)(nowMs - (TEST_READINGS - i) * 60000UL - (i % 3) * 20);
+    reading.summary = { (uint16_t)(60 + i), (uint16_t)(i * 13), (uint16_t)(20 + i % 50), (uint16_t)(i % 60),
+                        (uint8_t)(reading.heartRate - 5), (uint8_t)(reading.heartRate + 9), (uint8_t)(i % 100) };
+  }
+}
+
+static void assertRoundTrip(size_t count, unsigned long nowMs, uint8_t flags) {
+  size_t length = heartbeatCodecEncode(readings, count, nowMs, flags, encoded, sizeof(encoded));
+  TEST_ASSERT_GREATER_THAN_size_t(0, length);
+
+  size_t decodedCount = 0;
+  uint8_t decodedFlags = 0;
+  TEST_ASSERT_TRUE(heartbeatCodecDecode(encoded, length, nowMs, decoded, TEST_READINGS, &decodedCount, &decodedFlags));
+  TEST_ASSERT_EQUAL_size_t(count, decodedCount);
+  TEST_ASSERT_EQUAL_UINT8(flags, decodedFlags);
+
+  for (size_t i = 0; i < count; i++) {
+    const HeartRateReading& in = readings[i];
+    const HeartRateReading& out = decoded[i];
+    if (flags & HEARTBEAT_CODEC_FLAG_FINE_RATE) {
+      TEST_ASSERT_FLOAT_WITHIN(0.051f, in.heartRate, out.heartRate);
+    } else {
+      TEST_ASSERT_EQUAL_FLOAT((int)(in.heartRate + 0.5f), out.heartRate);
+    }
+
+    if (in.timestampMs == READING_TIMESTAMP_UNKNOWN) {
+      TEST_ASSERT_EQUAL_UINT32(READING_TIMESTAMP_UNKNOWN, out.timestampMs);
+    } else {
+      TEST_ASSERT_LESS_THAN_UINT(1000, (uint32_t)(out.timestampMs - in.timestampMs));  // To the second, never earlier
+    }
+
+    if (flags & HEARTBEAT_CODEC_FLAG_SUMMARY) {
+      TEST_ASSERT_EQUAL_UINT16(in.summary.beatCount, out.summary.beatCount);
+      TEST_ASSERT_EQUAL_UINT16(in.summary.stdDevCentiBpm, out.summary.stdDevCentiBpm);
+      TEST_ASSERT_EQUAL_UINT16(in.summary.rmssdMs, out.summary.rmssdMs);
+      TEST_ASSERT_EQUAL_UINT16(in.summary.highSeconds, out.summary.highSeconds);
+      TEST_ASSERT_EQUAL_UINT8(in.summary.minBpm, out.summary.minBpm);
+      TEST_ASSERT_EQUAL_UINT8(in.summary.maxBpm, out.summary.maxBpm);
+    } else {
+      TEST_ASSERT_EQUAL_UINT16(0, out.summary.beatCount);
+    }
+
+    bool good = in.summary.quality >= HEARTBEAT_CODEC_GOOD_QUALITY;
+    uint8_t quality = (flags & HEARTBEAT_CODEC_FLAG_QUALITY) && good ? HEARTBEAT_CODEC_GOOD_QUALITY : 0;
+    TEST_ASSERT_EQUAL_UINT8(quality, out.summary.quality);
+  }
+}
+
+static void test_round_trip_every_flag_combination() {
+  fillReadings(TEST_NOW_MS);
+  for (uint8_t flags = 0; flags < TEST_FLAG_COMBINATIONS; flags++) {
+    assertRoundTrip(TEST_READINGS, TEST_NOW_MS + 999, flags);
+    assertRoundTrip(1, TEST_NOW_MS, flags);
+    assertRoundTrip(0, TEST_NOW_MS, flags);
+  }
+}
+
+static void test_round_trip_across_millis_wrap() {
+  const unsigned long nowMs = 30000;    // Most readings were taken before millis() wrapped
+  fillReadings(nowMs);
+  TEST_ASSERT_GREATER_THAN_UINT(nowMs, readings[TEST_READINGS / 2].timestampMs);
+  for (uint8_t flags = 0; flags < TEST_FLAG_COMBINATIONS; flags++) {
+    assertRoundTrip(TEST_READINGS, nowMs, flags);
+  }
+}
+
+static void test_fit_truncates_at_transaction_limit() {
+  fillReadings(TEST_NOW_MS);
+  for (uint8_t flags = 0; flags < TEST_FLAG_COMBINATIONS; flags++) {
+    size_t fit = heartbeatCodecFit(readings, TEST_READINGS, flags, TEST_TX_READINGS_BYTES);
+    TEST_ASSERT_GREATER_THAN_size_t(0, fit);
+    TEST_ASSERT_LESS_THAN_UINT(TEST_READINGS, fit);
+
+    // Fits now and when resent as late as the clock allows (largest first time code)
+    unsigned long firstTimed = readings[5].timestampMs;
+    unsigned long latest[] = { TEST_NOW_MS, (uint32_t)(firstTimed + UINT32_MAX) };
+    for (unsigned long nowMs : latest) {
+      size_t length = heartbeatCodecEncode(readings, fit, nowMs, flags, encoded, TEST_TX_READINGS_BYTES);
+      TEST_ASSERT_GREATER_THAN_size_t(0, length);
+      TEST_ASSERT_LESS_OR_EQUAL_size_t(TEST_TX_READINGS_BYTES, length);
+    }
+
+    // One more reading overflows, short of the bytes reserved for the first time code
+    size_t longer = heartbeatCodecEncode(readings, fit + 1, TEST_NOW_MS, flags, encoded, sizeof(encoded));
+    TEST_ASSERT_GREATER_THAN_size_t(TEST_TX_READINGS_BYTES - 4, longer);  // Reserve is 5, the code at least 1
+    TEST_ASSERT_EQUAL_size_t(fit, heartbeatCodecFit(readings, fit, flags, TEST_TX_READINGS_BYTES));
+  }
+}
+
+static void test_fit_holds_for_every_capacity() {
+  fillReadings(TEST_NOW_MS);
+  uint8_t flags = HEARTBEAT_CODEC_FLAG_QUALITY | HEARTBEAT_CODEC_FLAG_SUMMARY;
+  size_t previous = 0;
+  for (size_t capacity = 0; capacity <= 256; capacity++) {
+    size_t fit = heartbeatCodecFit(readings, TEST_READINGS, flags, capacity);
+    TEST_ASSERT_GREATER_OR_EQUAL_UINT(previous, fit);
+    if (fit > 0) {
+      TEST_ASSERT_GREATER_THAN_size_t(0, heartbeatCodecEncode(readings, fit, TEST_NOW_MS, flags, encoded, capacity));
+    }
+    previous = fit;
+  }
+  TEST_ASSERT_EQUAL_size_t(0, heartbeatCodecFit(readings, TEST_READINGS, flags, HEARTBEAT_CODEC_HEADER_SIZE));
+  TEST_ASSERT_EQUAL_size_t(0, heartbeatCodecEncode(readings, 10, TEST_NOW_MS, flags, encoded, 10));
+}
+
+static void test_decoder_rejects_malformed_input() {
+  fillReadings(TEST_NOW_MS);
+  size_t decodedCount;
+  uint8_t decodedFlags;
+  for (uint8_t flags = 0; flags < TEST_FLAG_COMBINATIONS; flags++) {
+    size_t length = heartbeatCodecEncode(readings, 20, TEST_NOW_MS, flags, encoded, sizeof(encoded));
+    TEST_ASSERT_GREATER_THAN_size_t(0, length);
+
+    for (size_t prefix = 0; prefix < length; prefix++) {
+      TEST_ASSERT_FALSE(heartbeatCodecDecode(encoded, prefix, TEST_NOW_MS, decoded, TEST_READINGS,
+                                             &decodedCount, &decodedFlags));
+    }
+    encoded[length] = 0;                // Trailing byte
+    TEST_ASSERT_FALSE(heartbeatCodecDecode(encoded, length + 1, TEST_NOW_MS, decoded, TEST_READINGS,
+                                           &decodedCount, &decodedFlags));
+    TEST_ASSERT_FALSE(heartbeatCodecDecode(encoded, length, TEST_NOW_MS, decoded, 19, &decodedCount, &decodedFlags));
+
+    const uint8_t versions[] = { 0, HEARTBEAT_CODEC_VERSION + 1, 0xFF };
+    for (uint8_t version : versions) {
+      encoded[0] = version;
+      TEST_ASSERT_FALSE(heartbeatCodecDecode(encoded, length, TEST_NOW_MS, decoded, TEST_READINGS,
+                                             &decodedCount, &decodedFlags));
+    }
+  }
+
+  // Count varint that never terminates
+  const uint8_t unterminated[] = { HEARTBEAT_CODEC_VERSION, 0, 0x80, 0x80, 0x80, 0x80, 0x80, 0x01 };
+  TEST_ASSERT_FALSE(heartbeatCodecDecode(unterminated, sizeof(unterminated), TEST_NOW_MS, decoded, TEST_READINGS,
+                                         &decodedCount, &decodedFlags));
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_round_trip_every_flag_combination);
+  RUN_TEST(test_round_trip_across_millis_wrap);
+  RUN_TEST(test_fit_truncates_at_transaction_limit);
+  RUN_TEST(test_fit_holds_for_every_capacity);
+  RUN_TEST(test_decoder_rejects_malformed_input);
+  return UNITY_END();
+}
@@ -0,0 +1,103 @@
+/*****************************************************************************************
+ * Trace Replay Tests
+ *
+ * Replays every recording in TRACE_DIR through the signal pipeline and prints its
+ * readings: capture dumps (*.cap) and text traces (*.txt, one raw ADC value per line). A
+ * sidecar <name>.bpm with the reference rate of the recording (e.g. from a pulse
+ * oximeter) turns it into a check: the mean of the readings that would be uploaded must
+ * be within TRACE_TOLERANCE_BPM of it. See test/README for recording.
+ *
+ *****************************************************************************************/
+
+#include <unity.h>
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "trace_replay.h"
+#include "signal_quality.h"
+
+#ifndef TRACE_DIR
+#define TRACE_DIR "test/traces"
+#endif
+#define TRACE_TOLERANCE_BPM 3.0f
+#define TRACE_MAX_MINUTES 60
+#define TRACE_MAX_SAMPLES (TRACE_READING_SAMPLES * TRACE_MAX_MINUTES)
+
+static uint16_t samples[TRACE_MAX_SAMPLES];
+static HeartRateReading readings[TRACE_MAX_MINUTES];
+
+void setUp() {}
+void tearDown() {}
+
+static bool readReference(const char* tracePath, float* bpm) {
+  char path[512];
+  snprintf(path, sizeof(path), "%.*s.bpm", (int)(strlen(tracePath) - 4), tracePath);
+  FILE* file = fopen(path, "r");
+  if (file == NULL) {
+    return false;
+  }
+  bool read = fscanf(file, "%f", bpm) == 1;
+  fclose(file);
+  return read;
+}
+
+static void test_recorded_traces() {
+  const char* directory = getenv("TRACE_DIR") != NULL ? getenv("TRACE_DIR") : TRACE_DIR;
+  DIR* dir = opendir(directory);
+  if (dir == NULL) {
+    TEST_IGNORE_MESSAGE("No trace directory (set TRACE_DIR)");
+  }
+
+  int replayed = 0;
+  struct dirent* entry;
+  while ((entry = readdir(dir)) != NULL) {
+    size_t nameLength = strlen(entry->d_name);
+    const char* extension = nameLength < 5 ? "" : entry->d_name + nameLength - 4;
+    bool capture = strcmp(extension, ".cap") == 0;
+    if (!capture && strcmp(extension, ".txt") != 0) {
+      continue;
+    }
+    char path[512];
+    snprintf(path, sizeof(path), "%s/%s", directory, entry->d_name);
+    RecordedTrace trace = { samples, TRACE_MAX_SAMPLES, 0, 0, 0 };
+    TEST_ASSERT_TRUE_MESSAGE(capture ? traceLoadCapture(path, &trace) : traceLoadText(path, &trace), path);
+
+    TraceResult result;
+    traceReplay(trace.samples, trace.count, &result, readings, TRACE_MAX_MINUTES);
+    size_t readingCount = result.readingCount < TRACE_MAX_MINUTES ? result.readingCount : TRACE_MAX_MINUTES;
+    printf("%s: %u samples, %u beats", entry->d_name, (unsigned)trace.count, (unsigned)result.beats);
+    printf(capture ? ", %u frames, %u gaps\n" : "\n", (unsigned)trace.frames, (unsigned)trace.gaps);
+
+    float sum = 0;
+    int uploaded = 0;
+    for (size_t i = 0; i < readingCount; i++) {
+      const HeartRateSummary& summary = readings[i].summary;
+      bool upload = summary.quality >= SIGNAL_QUALITY_MIN;
+      printf("  minute %u: %.1f BPM (%u-%u), %u beats, RMSSD %ums, quality %u%s\n", (unsigned)i + 1,
+             readings[i].heartRate, summary.minBpm, summary.maxBpm, summary.beatCount, summary.rmssdMs,
+             summary.quality, upload ? "" : " (not uploaded)");
+      if (upload) {
+        sum += readings[i].heartRate;
+        uploaded++;
+      }
+    }
+
+    float reference;
+    if (readReference(path, &reference)) {
+      TEST_ASSERT_TRUE_MESSAGE(uploaded > 0, path);
+      TEST_ASSERT_FLOAT_WITHIN_MESSAGE(TRACE_TOLERANCE_BPM, reference, sum / uploaded, path);
+    }
+    replayed++;
+  }
+  closedir(dir);
+  if (replayed == 0) {
+    TEST_IGNORE_MESSAGE("No recorded traces (*.cap, *.txt) in TRACE_DIR");
+  }
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_recorded_traces);
+  return UNITY_END();
+}
@@ -0,0 +1,190 @@
+/*****************************************************************************************
+ * Signal Pipeline Tests
+ *
+ * Beat detection accuracy of the filter, detector, signal quality and upload window on
+ * synthesized KY-039 traces with a known rate and beat count, and the capture and
+ * recording loaders of the trace replay harness.
+ *
+ *****************************************************************************************/
+
+#include <unity.h>
+#include <stdio.h>
+#include "trace_replay.h"
+#include "capture_format.h"
+#include "signal_quality.h"
+
+#define TEST_WINDOWS 5
+#define TEST_SAMPLES (TRACE_READING_SAMPLES * TEST_WINDOWS)
+#define TEST_CAPTURE_PATH "test_capture.cap"
+#define TEST_RECORDING_PATH "test_recording.txt"
+
+static uint16_t samples[TEST_SAMPLES];
+static HeartRateReading readings[TEST_WINDOWS];
+static TraceResult result;
+static uint32_t trueBeats;
+
+void setUp() {}
+void tearDown() {}
+
+// Typical KY-039 signal: 40 counts of pulse on 30 counts of mains hum and 100 of wander
+static TracePulse pulseAt(float bpm, uint32_t seed) {
+  TracePulse pulse = { bpm, 40, 0, 3, 30, 100, seed };
+  return pulse;
+}
+
+static void replay(const TracePulse& pulse) {
+  trueBeats = traceSynthesize(pulse, samples, TEST_SAMPLES);
+  traceReplay(samples, TEST_SAMPLES, &result, readings, TEST_WINDOWS);
+  TEST_ASSERT_EQUAL_size_t(TEST_WINDOWS, result.readingCount);
+}
+
+static void assertReadingsWithin(float tolerance, float bpm) {
+  for (size_t i = 0; i < TEST_WINDOWS; i++) {
+    TEST_ASSERT_FLOAT_WITHIN(tolerance, bpm, readings[i].heartRate);
+  }
+}
+
+static void test_resting_rate_is_uploaded() {
+  replay(pulseAt(72, 1));
+  assertReadingsWithin(1.5f, 72);
+  for (size_t i = 0; i < TEST_WINDOWS; i++) {
+    TEST_ASSERT_GREATER_OR_EQUAL_UINT8(SIGNAL_QUALITY_MIN, readings[i].summary.quality);
+  }
+  TEST_ASSERT_GREATER_OR_EQUAL_UINT(trueBeats * 98 / 100, result.beats);
+  TEST_ASSERT_LESS_OR_EQUAL_UINT(trueBeats, result.beats);
+}
+
+static void test_dicrotic_notch_is_not_a_beat() {
+  TracePulse pulse = pulseAt(72, 2);
+  pulse.notch = 0.4f;
+  replay(pulse);
+  assertReadingsWithin(1.5f, 72);
+  TEST_ASSERT_LESS_OR_EQUAL_UINT(trueBeats, result.beats);
+}
+
+static void test_slow_and_fast_rates() {
+  replay(pulseAt(50, 3));
+  assertReadingsWithin(2, 50);
+  replay(pulseAt(110, 4));
+  assertReadingsWithin(2, 110);
+  replay(pulseAt(150, 5));
+  assertReadingsWithin(2, 150);
+}
+
+static void test_window_summary() {
+  replay(pulseAt(110, 6));
+  for (size_t i = 1; i < TEST_WINDOWS; i++) {
+    const HeartRateSummary& summary = readings[i].summary;
+    TEST_ASSERT_UINT_WITHIN(8, 110, summary.beatCount);
+    TEST_ASSERT_TRUE(summary.minBpm <= readings[i].heartRate && readings[i].heartRate <= summary.maxBpm);
+    TEST_ASSERT_UINT_WITHIN(5, 60, summary.highSeconds);   // The whole window is above 100 BPM
+  }
+}
+
+static void test_no_pulse_is_not_uploaded() {
+  TracePulse pulse = pulseAt(72, 7);
+  pulse.amplitude = 0;
+  replay(pulse);
+  TEST_ASSERT_EQUAL_UINT(0, result.beats);
+  for (size_t i = 0; i < TEST_WINDOWS; i++) {
+    TEST_ASSERT_EQUAL_UINT8(0, readings[i].summary.quality);
+  }
+}
+
+static void test_weak_or_noisy_signal_scores_lower() {
+  TracePulse weak = pulseAt(72, 8);
+  weak.amplitude = 8;
+  weak.noise = 1;
+  replay(weak);
+  for (size_t i = 0; i < TEST_WINDOWS; i++) {
+    TEST_ASSERT_LESS_THAN_UINT8(SIGNAL_QUALITY_MIN, readings[i].summary.quality);
+  }
+
+  replay(pulseAt(72, 9));
+  uint8_t cleanQuality = readings[TEST_WINDOWS - 1].summary.quality;
+  TracePulse noisy = pulseAt(72, 9);
+  noisy.noise = 40;
+  replay(noisy);
+  TEST_ASSERT_LESS_THAN_UINT8(cleanQuality, readings[TEST_WINDOWS - 1].summary.quality);
+}
+
+static void writeCapture(const uint16_t* raw, size_t count, bool usb, uint32_t dropFrame) {
+  FILE* file = fopen(TEST_CAPTURE_PATH, "wb");
+  TEST_ASSERT_NOT_NULL(file);
+  if (usb) {
+    fputs("Capture started\n", file);
+  }
+  uint32_t sequence = 0;
+  for (size_t start = 0; start < count; start += CAPTURE_MAX_SAMPLES, sequence++) {
+    uint16_t frameCount = count - start < CAPTURE_MAX_SAMPLES ? count - start : CAPTURE_MAX_SAMPLES;
+    if (sequence == dropFrame) {
+      continue;
+    }
+    CaptureHeader header = { CAPTURE_VERSION, 0, frameCount, sequence, (uint32_t)start };
+    uint16_t length = sizeof(header) + frameCount * (sizeof(uint16_t) + sizeof(int32_t));
+    if (usb) {
+      const uint8_t record[] = { CAPTURE_RECORD_SYNC, CAPTURE_TAG, (uint8_t)(length & 0xFF), (uint8_t)(length >> 8) };
+      fwrite(record, 1, sizeof(record), file);
+    }
+    fwrite(&header, 1, sizeof(header), file);
+    fwrite(raw + start, sizeof(uint16_t), frameCount, file);
+    int32_t filtered[CAPTURE_MAX_SAMPLES] = {};
+    fwrite(filtered, sizeof(int32_t), frameCount, file);
+    if (usb && sequence % 100 == 0) {
+      fputs("BPM: 72.0\n", file);
+    }
+  }
+  fclose(file);
+}
+
+static void test_capture_dump_loads_raw_samples() {
+  static uint16_t loaded[TRACE_READING_SAMPLES];
+  traceSynthesize(pulseAt(72, 10), samples, TRACE_READING_SAMPLES);
+  for (int usb = 0; usb < 2; usb++) {
+    writeCapture(samples, TRACE_READING_SAMPLES, usb, UINT32_MAX);
+    RecordedTrace trace = { loaded, TRACE_READING_SAMPLES, 0, 0, 0 };
+    TEST_ASSERT_TRUE(traceLoadCapture(TEST_CAPTURE_PATH, &trace));
+    TEST_ASSERT_EQUAL_size_t(TRACE_READING_SAMPLES, trace.count);
+    TEST_ASSERT_EQUAL_UINT(0, trace.gaps);
+    TEST_ASSERT_EQUAL_MEMORY(samples, loaded, TRACE_READING_SAMPLES * sizeof(uint16_t));
+  }
+
+  // A dropped frame shows up as a gap
+  writeCapture(samples, TRACE_READING_SAMPLES, true, 10);
+  RecordedTrace trace = { loaded, TRACE_READING_SAMPLES, 0, 0, 0 };
+  TEST_ASSERT_TRUE(traceLoadCapture(TEST_CAPTURE_PATH, &trace));
+  TEST_ASSERT_EQUAL_size_t(TRACE_READING_SAMPLES - CAPTURE_MAX_SAMPLES, trace.count);
+  TEST_ASSERT_EQUAL_UINT(1, trace.gaps);
+  remove(TEST_CAPTURE_PATH);
+}
+
+static void test_text_recording_loads_raw_samples() {
+  static uint16_t loaded[TRACE_READING_SAMPLES];
+  traceSynthesize(pulseAt(72, 10), samples, TRACE_READING_SAMPLES);
+  FILE* file = fopen(TEST_RECORDING_PATH, "w");
+  TEST_ASSERT_NOT_NULL(file);
+  fputs("raw\n", file);
+  for (size_t i = 0; i < TRACE_READING_SAMPLES; i++) {
+    fprintf(file, i % 1000 == 0 ? "  %u\nBPM: 72.0\n" : "%u\n", samples[i]);
+  }
+  fclose(file);
+
+  RecordedTrace trace = { loaded, TRACE_READING_SAMPLES, 0, 0, 0 };
+  TEST_ASSERT_TRUE(traceLoadText(TEST_RECORDING_PATH, &trace));
+  TEST_ASSERT_EQUAL_size_t(TRACE_READING_SAMPLES, trace.count);
+  TEST_ASSERT_EQUAL_MEMORY(samples, loaded, TRACE_READING_SAMPLES * sizeof(uint16_t));
+  remove(TEST_RECORDING_PATH);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_resting_rate_is_uploaded);
+  RUN_TEST(test_dicrotic_notch_is_not_a_beat);
+  RUN_TEST(test_slow_and_fast_rates);
+  RUN_TEST(test_window_summary);
+  RUN_TEST(test_no_pulse_is_not_uploaded);
+  RUN_TEST(test_weak_or_noisy_signal_scores_lower);
+  RUN_TEST(test_capture_dump_loads_raw_samples);
+  RUN_TEST(test_text_recording_loads_raw_samples);
+  return UNITY_END();
+}